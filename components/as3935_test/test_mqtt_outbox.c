@@ -0,0 +1,89 @@
+/* Unity tests for the flash-backed MQTT offline queue; need the mqttq partition */
+#include "unity.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mqtt_outbox.h"
+
+static char payload[EVENT_PIPELINE_PAYLOAD_MAX];
+static int next_pushed = 0;
+static int next_popped = 0;
+
+/* one full-size record per message so a sector holds only a few */
+static void push_flushed(void)
+{
+    memset(payload, 'p', sizeof(payload) - 1);
+    payload[sizeof(payload) - 1] = '\0';
+    int n = snprintf(payload, sizeof(payload), "%06d", next_pushed++);
+    payload[n] = 'p';
+    TEST_ASSERT_EQUAL(ESP_OK, mqtt_outbox_push("x", false, payload));
+    TEST_ASSERT_EQUAL(ESP_OK, mqtt_outbox_flush());
+}
+
+static void pop_expected(void)
+{
+    mqtt_outbox_msg_t msg;
+    TEST_ASSERT_EQUAL(ESP_OK, mqtt_outbox_peek(&msg));
+    TEST_ASSERT_EQUAL(next_popped, atoi(msg.payload));
+    next_popped++;
+    mqtt_outbox_pop();
+}
+
+static uint32_t sector_erases(void)
+{
+    mqtt_outbox_stats_t stats;
+    mqtt_outbox_get_stats(&stats);
+    return stats.sector_erases;
+}
+
+void test_wrap_onto_drained_sector_keeps_backlog(void)
+{
+    mqtt_outbox_stats_t stats;
+    mqtt_outbox_init();
+    mqtt_outbox_get_stats(&stats);
+    if (stats.flash_sectors == 0) TEST_IGNORE_MESSAGE("no mqttq partition");
+
+    mqtt_outbox_msg_t msg;
+    while (mqtt_outbox_peek(&msg) == ESP_OK) mqtt_outbox_pop();
+
+    /* line the head up with the start of a sector H */
+    uint32_t erases = sector_erases();
+    do {
+        push_flushed();
+    } while (sector_erases() == erases);
+    next_popped = next_pushed - 1;
+    while (mqtt_outbox_pending() > 1) mqtt_outbox_pop();
+
+    /* fill H to find how many records a sector takes, then every other sector */
+    erases = sector_erases();
+    int per_sector = 1;
+    for (;;) {
+        push_flushed();
+        if (sector_erases() != erases) break;
+        per_sector++;
+    }
+    for (int i = 1; i < (int)(stats.flash_sectors - 1) * per_sector; i++) {
+        push_flushed();
+    }
+    mqtt_outbox_get_stats(&stats);
+    const uint32_t dropped = stats.dropped;
+    TEST_ASSERT_EQUAL(stats.flash_sectors * per_sector, mqtt_outbox_pending());
+
+    /* drain H; the reader stays at its end until the next seek */
+    for (int i = 0; i < per_sector; i++) pop_expected();
+
+    /* the head wraps onto H, the reader must move on rather than lose the backlog */
+    push_flushed();
+    mqtt_outbox_get_stats(&stats);
+    TEST_ASSERT_EQUAL(dropped, stats.dropped);
+    TEST_ASSERT_EQUAL((stats.flash_sectors - 1) * per_sector + 1, mqtt_outbox_pending());
+    while (next_popped < next_pushed) pop_expected();
+    TEST_ASSERT_EQUAL(0, mqtt_outbox_pending());
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_wrap_onto_drained_sector_keeps_backlog);
+    return UNITY_END();
+}
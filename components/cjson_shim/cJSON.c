@@ -40,6 +40,7 @@ int cJSON_IsString(const cJSON *item) { return item && item->type == cJSON_Strin
 int cJSON_IsBool(const cJSON *item) { return item && (item->type == cJSON_False || item->type == cJSON_True); }
 int cJSON_IsTrue(const cJSON *item) { return item && item->type == cJSON_True; }
 int cJSON_IsFalse(const cJSON *item) { return item && item->type == cJSON_False; }
+int cJSON_IsNull(const cJSON *item) { return item && item->type == cJSON_NULL; }
 
 const cJSON *cJSON_GetObjectItemCaseSensitive(const cJSON * const object, const char * const string) {
     if (!object || !string) return NULL;
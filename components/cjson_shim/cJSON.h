@@ -36,6 +36,7 @@ int cJSON_IsString(const cJSON *item);
 int cJSON_IsBool(const cJSON *item);
 int cJSON_IsTrue(const cJSON *item);
 int cJSON_IsFalse(const cJSON *item);
+int cJSON_IsNull(const cJSON *item);
 const cJSON *cJSON_GetObjectItemCaseSensitive(const cJSON * const object, const char * const string);
 
 #define cJSON_ArrayForEach(element, array) for(element = (array != NULL ? (array)->child : NULL); element != NULL; element = element->next)
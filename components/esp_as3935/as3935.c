@@ -41,13 +41,16 @@
 #include <driver/gpio.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <esp_timer.h>
 
 /**
  * @brief AS3935 definitions
 */
 /* AS3935 localized constants */
 #define AS3935_IRQ_FLAG_DEFAULT         (0)
-#define AS3935_MUTEX_WAIT_TIME          (50)  // ticks
+#define AS3935_BUS_PRIORITY_IRQ         I2C_ARBITER_PRIO_IRQ      //!< interrupt readout bus class
+#define AS3935_BUS_PRIORITY_CONTROL     I2C_ARBITER_PRIO_CONTROL  //!< configuration access bus class
+#define AS3935_BUS_PRIORITY_DIAG        I2C_ARBITER_PRIO_DIAG     //!< diagnostic and background verify bus class
 #define AS3935_EVENT_LOOP_POOL_DELAY_MS (50)  // milliseconds
 #define AS3935_EVENT_LOOP_POST_DELAY_MS (100) // milliseconds
 #define AS3935_EVENT_LOOP_QUEUE_SIZE    (16)
@@ -61,7 +64,6 @@
  * macro definitions
 */
 #define ESP_ARG_CHECK(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
-#define ENSURE_TRUE(ACTION) do { BaseType_t __res = (ACTION); assert(__res == pdTRUE); (void)__res; } while (0)
 
 /**
  * @brief AS3935 device structure definition.
@@ -69,8 +71,17 @@
 typedef struct as3935_device_s {
     as3935_config_t             config;         /*!< as3935 configuration */
     i2c_master_dev_handle_t     i2c_handle;     /*!< as3935 I2C device handle */
+    portMUX_TYPE                shadow_lock;    /*!< as3935 register shadow lock */
+    as3935_register_shadow_t    shadow;         /*!< as3935 register shadow */
 } as3935_device_t;
 
+/**
+ * @brief AS3935 irq-to-readout latency histogram bucket upper bounds in microseconds.
+ */
+static const uint32_t as3935_latency_bucket_le_us[AS3935_LATENCY_BUCKETS] = {
+    2250, 2500, 3000, 4000, 5000, 7500, 10000, 20000, UINT32_MAX
+};
+
 /**
  * @brief AS3935 monitor event base definition.
  */
@@ -87,22 +98,71 @@ static const char *TAG = "as3935";
  * functions and subroutines
 */
 
+/**
+ * @brief Stores register contents read from or written to the device in the
+ * register shadow.  Addresses outside 0x00..0x08 are ignored.
+ * 
+ * @param device AS3935 device descriptor.
+ * @param reg_addr First register address.
+ * @param data Register contents.
+ * @param size Number of consecutive registers.
+ */
+static inline void as3935_shadow_store(as3935_device_t *const device, const uint8_t reg_addr, const uint8_t *data, const uint8_t size) {
+    const int64_t now_us = esp_timer_get_time();
+    bool changed = false;
+
+    taskENTER_CRITICAL(&device->shadow_lock);
+    for (uint8_t i = 0; i < size && reg_addr + i < AS3935_REG_BLOCK_SIZE; i++) {
+        const uint8_t  reg = reg_addr + i;
+        const uint16_t bit = (uint16_t)(1u << reg);
+        if (!(device->shadow.valid_mask & bit) || device->shadow.registers[reg] != data[i]) {
+            changed = true;
+        }
+        device->shadow.registers[reg] = data[i];
+        device->shadow.synced_us[reg] = now_us;
+        device->shadow.valid_mask    |= bit;
+    }
+    if (changed) {
+        device->shadow.generation++;
+    }
+    taskEXIT_CRITICAL(&device->shadow_lock);
+}
+
+/**
+ * @brief Marks registers as unknown in the register shadow, e.g. after a failed
+ * write or a preset to defaults.
+ * 
+ * @param device AS3935 device descriptor.
+ * @param mask Register bit mask, bit n for register n.
+ */
+static inline void as3935_shadow_invalidate(as3935_device_t *const device, const uint16_t mask) {
+    taskENTER_CRITICAL(&device->shadow_lock);
+    if (device->shadow.valid_mask & mask) {
+        device->shadow.valid_mask &= (uint16_t)~mask;
+        device->shadow.generation++;
+    }
+    taskEXIT_CRITICAL(&device->shadow_lock);
+}
+
 /**
  * @brief AS3935 I2C HAL read from register address transaction.  This is a write and then read process.
  * 
  * @param device AS3935 device descriptor.
+ * @param priority I2C bus arbiter priority class of the transaction.
  * @param reg_addr AS3935 register address to read from.
  * @param buffer Buffer to store results from read transaction.
  * @param size Length of buffer to store results from read transaction.
  * @return esp_err_t ESP_OK on success.
  */
-static inline esp_err_t as3935_i2c_read_from(as3935_device_t *const device, const uint8_t reg_addr, uint8_t *buffer, const uint8_t size) {
+static inline esp_err_t as3935_i2c_read_from(as3935_device_t *const device, const i2c_arbiter_priority_t priority, const uint8_t reg_addr, uint8_t *buffer, const uint8_t size) {
     const bit8_uint8_buffer_t tx = { reg_addr };
 
     /* validate arguments */
     ESP_ARG_CHECK( device );
 
-    ESP_RETURN_ON_ERROR( i2c_master_transmit_receive(device->i2c_handle, tx, BIT8_UINT8_BUFFER_SIZE, buffer, size, I2C_XFR_TIMEOUT_MS), TAG, "as3935_i2c_read_from failed" );
+    ESP_RETURN_ON_ERROR( i2c_arbiter_transmit_receive(device->config.i2c_arbiter, priority, device->i2c_handle, tx, BIT8_UINT8_BUFFER_SIZE, buffer, size, I2C_XFR_TIMEOUT_MS), TAG, "as3935_i2c_read_from failed" );
+
+    as3935_shadow_store(device, reg_addr, buffer, size);
 
     return ESP_OK;
 }
@@ -112,18 +172,21 @@ static inline esp_err_t as3935_i2c_read_from(as3935_device_t *const device, cons
  * @brief AS3935 I2C HAL read byte from register address transaction.
  * 
  * @param device AS3935 device descriptor.
+ * @param priority I2C bus arbiter priority class of the transaction.
  * @param reg_addr AS3935 register address to read from.
  * @param byte AS3935 read transaction return byte.
  * @return esp_err_t ESP_OK on success.
  */
-static inline esp_err_t as3935_i2c_read_byte_from(as3935_device_t *const device, const uint8_t reg_addr, uint8_t *const byte) {
+static inline esp_err_t as3935_i2c_read_byte_from(as3935_device_t *const device, const i2c_arbiter_priority_t priority, const uint8_t reg_addr, uint8_t *const byte) {
     const bit8_uint8_buffer_t tx = { reg_addr };
     bit8_uint8_buffer_t rx = { 0 };
 
     /* validate arguments */
     ESP_ARG_CHECK( device );
 
-    ESP_RETURN_ON_ERROR( i2c_master_transmit_receive(device->i2c_handle, tx, BIT8_UINT8_BUFFER_SIZE, rx, BIT8_UINT8_BUFFER_SIZE, I2C_XFR_TIMEOUT_MS), TAG, "as3935_i2c_read_byte_from failed" );
+    ESP_RETURN_ON_ERROR( i2c_arbiter_transmit_receive(device->config.i2c_arbiter, priority, device->i2c_handle, tx, BIT8_UINT8_BUFFER_SIZE, rx, BIT8_UINT8_BUFFER_SIZE, I2C_XFR_TIMEOUT_MS), TAG, "as3935_i2c_read_byte_from failed" );
+
+    as3935_shadow_store(device, reg_addr, rx, BIT8_UINT8_BUFFER_SIZE);
 
     /* set output parameter */
     *byte = rx[0];
@@ -131,23 +194,72 @@ static inline esp_err_t as3935_i2c_read_byte_from(as3935_device_t *const device,
     return ESP_OK;
 }
 
+/**
+ * @brief AS3935 I2C HAL burst write to consecutive registers starting at register
+ * address, one transaction.  The register pointer auto-increments on writes.
+ * 
+ * @param device AS3935 device descriptor.
+ * @param priority I2C bus arbiter priority class of the transaction.
+ * @param reg_addr AS3935 first register address to write to.
+ * @param buffer Register contents to write.
+ * @param size Number of registers to write.
+ * @return esp_err_t ESP_OK on success.
+ */
+static inline esp_err_t as3935_i2c_write_to(as3935_device_t *const device, const i2c_arbiter_priority_t priority, const uint8_t reg_addr, const uint8_t *buffer, const uint8_t size) {
+    uint8_t tx[AS3935_REG_BLOCK_SIZE + 1];
+
+    /* validate arguments */
+    ESP_ARG_CHECK( device && buffer && size > 0 && size <= AS3935_REG_BLOCK_SIZE && reg_addr + size <= AS3935_REG_BLOCK_SIZE );
+
+    tx[0] = reg_addr;
+    memcpy(&tx[1], buffer, size);
+
+    /* attempt i2c write transaction */
+    esp_err_t ret = i2c_arbiter_transmit(device->config.i2c_arbiter, priority, device->i2c_handle, tx, size + 1, I2C_XFR_TIMEOUT_MS);
+    if (ret != ESP_OK) {
+        /* any part of the burst may or may not have landed */
+        as3935_shadow_invalidate(device, (uint16_t)(((1u << size) - 1u) << reg_addr));
+        ESP_LOGE(TAG, "as3935_i2c_write_to failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    as3935_shadow_store(device, reg_addr, buffer, size);
+
+    return ESP_OK;
+}
+
 /**
  * @brief AS3935 I2C HAL write byte to register address transaction.
  * 
  * @param device AS3935 device descriptor.
+ * @param priority I2C bus arbiter priority class of the transaction.
  * @param reg_addr AS3935 register address to write to.
  * @param byte AS3935 write transaction input byte.
  * @return esp_err_t ESP_OK on success.
  */
-static inline esp_err_t as3935_i2c_write_byte_to(as3935_device_t *const device, const uint8_t reg_addr, const uint8_t byte) {
+static inline esp_err_t as3935_i2c_write_byte_to(as3935_device_t *const device, const i2c_arbiter_priority_t priority, const uint8_t reg_addr, const uint8_t byte) {
     const bit16_uint8_buffer_t tx = { reg_addr, byte };
 
     /* validate arguments */
     ESP_ARG_CHECK( device );
 
     /* attempt i2c write transaction */
-    ESP_RETURN_ON_ERROR( i2c_master_transmit(device->i2c_handle, tx, BIT16_UINT8_BUFFER_SIZE, I2C_XFR_TIMEOUT_MS), TAG, "i2c_master_transmit, i2c write failed" );
-                        
+    esp_err_t ret = i2c_arbiter_transmit(device->config.i2c_arbiter, priority, device->i2c_handle, tx, BIT16_UINT8_BUFFER_SIZE, I2C_XFR_TIMEOUT_MS);
+    if (ret != ESP_OK) {
+        /* the write may or may not have landed */
+        if (reg_addr < AS3935_REG_BLOCK_SIZE) {
+            as3935_shadow_invalidate(device, (uint16_t)(1u << reg_addr));
+        }
+        ESP_LOGE(TAG, "as3935_i2c_write_byte_to failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (reg_addr == AS3935_CMD_PRESET_DEFAULT) {
+        as3935_shadow_invalidate(device, UINT16_C(0x01ff));
+    } else {
+        as3935_shadow_store(device, reg_addr, &tx[1], BIT8_UINT8_BUFFER_SIZE);
+    }
+
     return ESP_OK;
 }
 
@@ -196,82 +308,208 @@ static inline uint8_t as3935_convert_distance_km(as3935_lightning_distances_t di
     }
 }
 
-static inline void IRAM_ATTR as3935_monitor_gpio_isr_handler( void *pvParameters ) {
+/**
+ * @brief Decodes the 21-bit lightning energy from registers 0x04..0x06.
+ * 
+ * @param data Register 0x04, 0x05 and 0x06 contents, in that order.
+ * @return uint32_t Lightning energy.
+ */
+static inline uint32_t as3935_decode_lightning_energy(const uint8_t *data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)(data[2] & 0b11111) << 16);
+}
+
+/**
+ * @brief Decodes the lightning distance from register 0x07.
+ * 
+ * @param reg AS3935 register 0x07 contents.
+ * @return as3935_lightning_distances_t Lightning distance.
+ */
+static inline as3935_lightning_distances_t as3935_decode_lightning_distance(const uint8_t reg) {
+    const as3935_0x07_register_t reg_0x07 = { .reg = reg };
+
+    return reg_0x07.bits.lightning_distance;
+}
+
+static void IRAM_ATTR as3935_monitor_gpio_isr_handler( void *pvParameters ) {
     as3935_monitor_context_t *as3935_monitor_context = (as3935_monitor_context_t *)pvParameters;
-    xQueueSendFromISR(as3935_monitor_context->event_queue_handle, &as3935_monitor_context->irq_io_num, NULL);
+    const int64_t timestamp_us = esp_timer_get_time();
+    const uint32_t head = as3935_monitor_context->irq_head;
+    BaseType_t task_woken = pdFALSE;
+
+    /* stamp first, everything else is latency */
+    as3935_monitor_context->irq_count++;
+    if (head - __atomic_load_n(&as3935_monitor_context->irq_tail, __ATOMIC_ACQUIRE) >= AS3935_IRQ_RING_SIZE) {
+        as3935_monitor_context->irq_overruns++;
+    } else {
+        as3935_monitor_context->irq_stamps[head & (AS3935_IRQ_RING_SIZE - 1)] = timestamp_us;
+        __atomic_store_n(&as3935_monitor_context->irq_head, head + 1, __ATOMIC_RELEASE);
+    }
+
+    /* wake the monitor task, repeated notifications collapse into one bit */
+    xTaskNotifyFromISR(as3935_monitor_context->task_monitor_handle, AS3935_NOTIFY_IRQ_BIT, eSetBits, &task_woken);
+    portYIELD_FROM_ISR(task_woken);
+}
+
+/**
+ * @brief Pops the oldest interrupt timestamp from the isr ring.
+ * 
+ * @param as3935_monitor_context AS3935 monitor context.
+ * @param timestamp_us Interrupt timestamp output.
+ * @return true when a timestamp was available.
+ */
+static inline bool as3935_monitor_pop_irq_stamp(as3935_monitor_context_t *as3935_monitor_context, int64_t *const timestamp_us) {
+    const uint32_t tail = as3935_monitor_context->irq_tail;
+
+    if (__atomic_load_n(&as3935_monitor_context->irq_head, __ATOMIC_ACQUIRE) == tail) {
+        return false;
+    }
+
+    *timestamp_us = as3935_monitor_context->irq_stamps[tail & (AS3935_IRQ_RING_SIZE - 1)];
+    __atomic_store_n(&as3935_monitor_context->irq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+static void as3935_monitor_readout_timer_cb( void *arg ) {
+    as3935_monitor_context_t *as3935_monitor_context = (as3935_monitor_context_t *)arg;
+
+    xTaskNotify(as3935_monitor_context->task_monitor_handle, AS3935_NOTIFY_DEADLINE_BIT, eSetBits);
+}
+
+/**
+ * @brief Schedules the interrupt register readout AS3935_INTERRUPT_DELAY_MS
+ * after the oldest pending isr timestamp.  Interrupts already queued behind it
+ * are merged, the sensor only latches the most recent interrupt source.
+ * 
+ * @param as3935_monitor_context AS3935 monitor context.
+ * @return true when the deadline has already passed and the readout is due now.
+ */
+static inline bool as3935_monitor_schedule_readout(as3935_monitor_context_t *as3935_monitor_context) {
+    int64_t timestamp_us, merged_us;
+
+    if (!as3935_monitor_pop_irq_stamp(as3935_monitor_context, &timestamp_us)) {
+        return false;
+    }
+    while (as3935_monitor_pop_irq_stamp(as3935_monitor_context, &merged_us)) {
+        as3935_monitor_context->irq_merged++;
+    }
+
+    as3935_monitor_context->pending_stamp_us = timestamp_us;
+    as3935_monitor_context->readout_armed    = true;
+
+    const int64_t delay_us = timestamp_us + (AS3935_INTERRUPT_DELAY_MS * 1000) - esp_timer_get_time();
+    if (delay_us <= 0 || esp_timer_start_once(as3935_monitor_context->readout_timer, (uint64_t)delay_us) != ESP_OK) {
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Reads the interrupt block for the scheduled readout, records the
+ * irq-to-readout latency and dispatches the event.
+ * 
+ * @param as3935_monitor_context AS3935 monitor context.
+ */
+static inline void as3935_monitor_readout(as3935_monitor_context_t *as3935_monitor_context) {
+    as3935_monitor_base_t *event = &as3935_monitor_context->base;
+    int64_t timestamp_us;
+
+    as3935_monitor_context->readout_armed = false;
+
+    /* interrupts that arrived during the wait are served by this readout */
+    while (as3935_monitor_pop_irq_stamp(as3935_monitor_context, &timestamp_us)) {
+        as3935_monitor_context->irq_merged++;
+    }
+
+    /* one burst read of 0x00..0x08: interrupt source, energy, distance and configuration */
+    if(as3935_get_event_block(as3935_monitor_context->as3935_handle, event) != ESP_OK) {
+        ESP_LOGE(TAG, "as3935 device read event registers (0x00..0x08) failed");
+        return;
+    }
+    event->irq_timestamp_us = as3935_monitor_context->pending_stamp_us;
+
+    /* record irq-to-readout latency */
+    const int64_t latency_us = esp_timer_get_time() - event->irq_timestamp_us;
+    const uint32_t latency = (latency_us > (int64_t)UINT32_MAX) ? UINT32_MAX : (uint32_t)latency_us;
+    for (uint8_t i = 0; i < AS3935_LATENCY_BUCKETS; i++) {
+        if (latency <= as3935_latency_bucket_le_us[i]) {
+            as3935_monitor_context->latency_hist[i]++;
+            break;
+        }
+    }
+    if (latency > as3935_monitor_context->latency_max_us) {
+        as3935_monitor_context->latency_max_us = latency;
+    }
+    as3935_monitor_context->readouts++;
+
+    int32_t event_id;
+    switch(event->irq_state) {
+        case AS3935_INT_NOISE:
+        case AS3935_INT_DISTURBER:
+        case AS3935_INT_LIGHTNING:
+        case AS3935_INT_NONE:
+            event_id = event->irq_state;
+            break;
+        default:
+            event_id = 200;
+            break;
+    }
+
+    /* direct handlers get the record in place, no copy and no event loop */
+    as3935_monitor_direct_entry_t direct_handlers[AS3935_DIRECT_HANDLERS_MAX];
+    taskENTER_CRITICAL(&as3935_monitor_context->handlers_lock);
+    memcpy(direct_handlers, as3935_monitor_context->direct_handlers, sizeof(direct_handlers));
+    const bool post_event = as3935_monitor_context->event_handler_count > 0;
+    taskEXIT_CRITICAL(&as3935_monitor_context->handlers_lock);
+
+    for (uint8_t i = 0; i < AS3935_DIRECT_HANDLERS_MAX; i++) {
+        if (direct_handlers[i].handler) {
+            direct_handlers[i].handler(direct_handlers[i].args, event_id, event);
+        }
+    }
+
+    /* send signal to notify that one interrupt statement has been met */
+    if (post_event) {
+        esp_event_post_to(as3935_monitor_context->event_loop_handle, ESP_AS3935_EVENT, event_id,
+                          event, sizeof(as3935_monitor_base_t), pdMS_TO_TICKS(AS3935_EVENT_LOOP_POST_DELAY_MS));
+    }
 }
 
 static inline void as3935_monitor_task_entry( void *pvParameters ) {
     as3935_monitor_context_t *as3935_monitor_context = (as3935_monitor_context_t *)pvParameters;
-    uint32_t io_num;
+    uint32_t notify_bits;
 
     for (;;) {
-        if (xQueueReceive(as3935_monitor_context->event_queue_handle, &io_num, portMAX_DELAY)) {
-            
-            /* wait at least 2ms before reading the interrupt register */
-            vTaskDelay(pdMS_TO_TICKS(AS3935_INTERRUPT_DELAY_MS));
-            
-            /* ensure i2c master bus mutex is available before reading as3935 registers */
-            ENSURE_TRUE( xSemaphoreTake(as3935_monitor_context->i2c_mutex_handle, AS3935_MUTEX_WAIT_TIME) );
-            
-            as3935_interrupt_states_t irq_state;
-            if(as3935_get_interrupt_state(as3935_monitor_context->as3935_handle, &irq_state) != 0) {
-                ESP_LOGE(TAG, "as3935 device read interrupt state (register 0x03) failed");
-            } else {
-                if(irq_state == AS3935_INT_NOISE) {
-                    /* set parent device fields to defaults */
-                    as3935_monitor_context->base.lightning_distance = AS3935_L_DISTANCE_OO_RANGE;
-                    as3935_monitor_context->base.lightning_energy   = 0;
-
-                    /* send signal to notify that one unknown statement has been met */
-                    esp_event_post_to(as3935_monitor_context->event_loop_handle, ESP_AS3935_EVENT, AS3935_INT_NOISE,
-                                  &(as3935_monitor_context->base), sizeof(as3935_monitor_base_t), pdMS_TO_TICKS(AS3935_EVENT_LOOP_POST_DELAY_MS));
-                } else if(irq_state == AS3935_INT_DISTURBER) {
-                    /* set parent device fields to defaults */
-                    as3935_monitor_context->base.lightning_distance = AS3935_L_DISTANCE_OO_RANGE;
-                    as3935_monitor_context->base.lightning_energy   = 0;
-
-                    /* send signal to notify that one unknown statement has been met */
-                    esp_event_post_to(as3935_monitor_context->event_loop_handle, ESP_AS3935_EVENT, AS3935_INT_DISTURBER,
-                                  &(as3935_monitor_context->base), sizeof(as3935_monitor_base_t), pdMS_TO_TICKS(AS3935_EVENT_LOOP_POST_DELAY_MS));
-                } else if(irq_state == AS3935_INT_LIGHTNING) {
-                    uint32_t lightning_energy;
-                    as3935_lightning_distances_t lightning_distance;
-
-                    if(as3935_get_lightning_event(as3935_monitor_context->as3935_handle, &lightning_distance, &lightning_energy) != 0) {
-                        ESP_LOGE(TAG, "as3935 device read lightning distance and energy failed");
-                    } else {
-                        /* set parent device fields to defaults */
-                        as3935_monitor_context->base.lightning_distance = lightning_distance;
-                        as3935_monitor_context->base.lightning_energy   = lightning_energy;
-
-                        /* send signal to notify that one unknown statement has been met */
-                        esp_event_post_to(as3935_monitor_context->event_loop_handle, ESP_AS3935_EVENT, AS3935_INT_LIGHTNING,
-                                  &(as3935_monitor_context->base), sizeof(as3935_monitor_base_t), pdMS_TO_TICKS(AS3935_EVENT_LOOP_POST_DELAY_MS));
-                    }
-                } else if(irq_state == AS3935_INT_NONE) {
-                    /* set parent device fields to defaults */
-                    as3935_monitor_context->base.lightning_distance = AS3935_L_DISTANCE_OO_RANGE;
-                    as3935_monitor_context->base.lightning_energy   = 0;
-
-                    /* send signal to notify that one unknown statement has been met */
-                    esp_event_post_to(as3935_monitor_context->event_loop_handle, ESP_AS3935_EVENT, AS3935_INT_NONE,
-                                  &(as3935_monitor_context->base), sizeof(as3935_monitor_base_t), pdMS_TO_TICKS(AS3935_EVENT_LOOP_POST_DELAY_MS));
-                } else {
-                    /* set parent device fields to defaults */
-                    as3935_monitor_context->base.lightning_distance = AS3935_L_DISTANCE_OO_RANGE;
-                    as3935_monitor_context->base.lightning_energy   = 0;
-
-                    /* send signal to notify that one unknown statement has been met */
-                    esp_event_post_to(as3935_monitor_context->event_loop_handle, ESP_AS3935_EVENT, 200,
-                                  &(as3935_monitor_context->base), sizeof(as3935_monitor_base_t), pdMS_TO_TICKS(AS3935_EVENT_LOOP_POST_DELAY_MS));
-                }
+        if (xTaskNotifyWait(0, UINT32_MAX, &notify_bits, pdMS_TO_TICKS(AS3935_SHADOW_VERIFY_PERIOD_MS)) != pdTRUE) {
+            /* idle: verify the register shadow unless an interrupt is pending */
+            if (gpio_get_level(as3935_monitor_context->irq_io_num) == 0 &&
+                as3935_verify_register_shadow(as3935_monitor_context->as3935_handle) != ESP_OK) {
+                ESP_LOGW(TAG, "as3935 register shadow verify failed");
+            }
+            continue;
+        }
+
+        bool readout_due = (notify_bits & AS3935_NOTIFY_DEADLINE_BIT) && as3935_monitor_context->readout_armed;
+
+        /* schedule a readout for new interrupts, or fold them into the one already scheduled */
+        if ((notify_bits & AS3935_NOTIFY_IRQ_BIT) && !as3935_monitor_context->readout_armed) {
+            readout_due = as3935_monitor_schedule_readout(as3935_monitor_context);
+        }
+
+        if (readout_due) {
+            as3935_monitor_readout(as3935_monitor_context);
+
+            /* interrupts stamped during the readout get their own deadline */
+            if (as3935_monitor_schedule_readout(as3935_monitor_context)) {
+                xTaskNotify(as3935_monitor_context->task_monitor_handle, AS3935_NOTIFY_DEADLINE_BIT, eSetBits);
+            }
+
+            /* drive the event loop when esp_event handlers are registered */
+            if (as3935_monitor_context->event_handler_count > 0) {
+                esp_event_loop_run(as3935_monitor_context->event_loop_handle, pdMS_TO_TICKS(AS3935_EVENT_LOOP_POOL_DELAY_MS));
             }
-            /* ensure i2c master bus mutex is released */
-            ENSURE_TRUE( xSemaphoreGive(as3935_monitor_context->i2c_mutex_handle) );
         }
-        /* drive the event loop */
-        esp_event_loop_run(as3935_monitor_context->event_loop_handle, pdMS_TO_TICKS(AS3935_EVENT_LOOP_POOL_DELAY_MS));
     }
     vTaskDelete( NULL );
 }
@@ -299,15 +537,9 @@ esp_err_t as3935_monitor_init(i2c_master_bus_handle_t master_handle, const as393
         goto err_device;
     }
 
-    /* create i2c mutex handle */
-    as3935_monitor_context->i2c_mutex_handle = xSemaphoreCreateMutex();
-    if(as3935_monitor_context->i2c_mutex_handle == NULL) {
-        ESP_LOGE(TAG, "create i2c mutex failed");
-        goto err_emutex;
-    }
-
     /* copy config to as3935 state object */
     as3935_monitor_context->irq_io_num = as3935_config->irq_io_num;
+    portMUX_INITIALIZE(&as3935_monitor_context->handlers_lock);
 
     /* create event loop handle */
     esp_event_loop_args_t loop_args = {
@@ -319,11 +551,16 @@ esp_err_t as3935_monitor_init(i2c_master_bus_handle_t master_handle, const as393
         goto err_eloop;
     }
 
-    /* create a event queue to handle gpio event from isr */
-    as3935_monitor_context->event_queue_handle = xQueueCreate(10, sizeof(uint32_t));
-    if (!as3935_monitor_context->event_queue_handle) {
-        ESP_LOGE(TAG, "create event queue handle failed");
-        goto err_equeue;
+    /* create deferred readout timer, fires AS3935_INTERRUPT_DELAY_MS after the isr timestamp */
+    const esp_timer_create_args_t timer_args = {
+        .callback        = as3935_monitor_readout_timer_cb,
+        .arg             = as3935_monitor_context,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name            = "as3935_readout"
+    };
+    if (esp_timer_create(&timer_args, &as3935_monitor_context->readout_timer) != ESP_OK) {
+        ESP_LOGE(TAG, "create readout timer failed");
+        goto err_timer;
     }
 
     /* create i2c as3935 handle */
@@ -359,12 +596,10 @@ esp_err_t as3935_monitor_init(i2c_master_bus_handle_t master_handle, const as393
         vTaskDelete(as3935_monitor_context->task_monitor_handle);
     err_i2c_as3935_init:
         as3935_remove(as3935_monitor_context->as3935_handle);
-    err_equeue:
-        vQueueDelete(as3935_monitor_context->event_queue_handle);
+    err_timer:
+        esp_timer_delete(as3935_monitor_context->readout_timer);
     err_eloop:
         esp_event_loop_delete(as3935_monitor_context->event_loop_handle);
-    err_emutex:
-        vSemaphoreDelete(as3935_monitor_context->i2c_mutex_handle);
     err_device:
         free(as3935_monitor_context);
         return ESP_ERR_INVALID_STATE;
@@ -374,38 +609,143 @@ esp_err_t as3935_monitor_deinit(as3935_monitor_handle_t monitor_handle) {
     as3935_monitor_context_t *as3935_monitor_context = (as3935_monitor_context_t *)monitor_handle;
 
     /* free-up resources */
+    if (as3935_monitor_context->isr_installed) {
+        gpio_isr_handler_remove(as3935_monitor_context->irq_io_num);
+    }
     vTaskDelete(as3935_monitor_context->task_monitor_handle);
+    esp_timer_stop(as3935_monitor_context->readout_timer);
+    esp_timer_delete(as3935_monitor_context->readout_timer);
     esp_event_loop_delete(as3935_monitor_context->event_loop_handle);
-    vQueueDelete(as3935_monitor_context->event_queue_handle);
-    vSemaphoreDelete(as3935_monitor_context->i2c_mutex_handle);
     esp_err_t err = as3935_remove(as3935_monitor_context->as3935_handle);
     free(as3935_monitor_context);
 
     return err;
 }
 
+/**
+ * @brief Hooks the monitor isr on the interrupt pin when the first handler of
+ * either kind is registered, and unhooks it when the last one is removed.
+ * Must be called with handlers_lock not held.
+ * 
+ * @param as3935_monitor_context AS3935 monitor context.
+ * @return esp_err_t ESP_OK on success.
+ */
+static inline esp_err_t as3935_monitor_update_isr(as3935_monitor_context_t *as3935_monitor_context) {
+    taskENTER_CRITICAL(&as3935_monitor_context->handlers_lock);
+    const bool wanted = (as3935_monitor_context->event_handler_count + as3935_monitor_context->direct_handler_count) > 0;
+    taskEXIT_CRITICAL(&as3935_monitor_context->handlers_lock);
+
+    if (wanted && !as3935_monitor_context->isr_installed) {
+        /* install as3935 monitor gpio isr service, already installed is fine */
+        esp_err_t ret = gpio_install_isr_service(AS3935_IRQ_FLAG_DEFAULT);
+        ESP_RETURN_ON_FALSE( ret == ESP_OK || ret == ESP_ERR_INVALID_STATE, ret, TAG, "gpio isr service install failed" );
+
+        /* hook as3935 monitor isr handler for specific gpio pin and as3935 state object */
+        ESP_RETURN_ON_ERROR( gpio_isr_handler_add(as3935_monitor_context->irq_io_num, as3935_monitor_gpio_isr_handler, (void *)as3935_monitor_context), TAG, "gpio isr handler add failed" );
+        as3935_monitor_context->isr_installed = true;
+    } else if (!wanted && as3935_monitor_context->isr_installed) {
+        /* remove isr handler for gpio number */
+        gpio_isr_handler_remove(as3935_monitor_context->irq_io_num);
+        as3935_monitor_context->isr_installed = false;
+    }
+
+    return ESP_OK;
+}
+
 esp_err_t as3935_monitor_add_handler(as3935_monitor_handle_t monitor_handle, esp_event_handler_t event_handler, void *handler_args) {
     as3935_monitor_context_t *as3935_monitor_context = (as3935_monitor_context_t *)monitor_handle;
 
-    /* install as3935 monitor gpio isr service */
-    gpio_install_isr_service(AS3935_IRQ_FLAG_DEFAULT);
-
-    /* hook as3935 monitor isr handler for specific gpio pin and as3935 state object */
-    gpio_isr_handler_add(as3935_monitor_context->irq_io_num, as3935_monitor_gpio_isr_handler, (void *)as3935_monitor_context);
+    ESP_ARG_CHECK( as3935_monitor_context && event_handler );
 
     /* hook esp event handler for caller */
-    return esp_event_handler_register_with(as3935_monitor_context->event_loop_handle, ESP_AS3935_EVENT, ESP_EVENT_ANY_ID,
-                                           event_handler, handler_args);
+    ESP_RETURN_ON_ERROR( esp_event_handler_register_with(as3935_monitor_context->event_loop_handle, ESP_AS3935_EVENT, ESP_EVENT_ANY_ID,
+                                                         event_handler, handler_args), TAG, "event handler register failed" );
+
+    taskENTER_CRITICAL(&as3935_monitor_context->handlers_lock);
+    as3935_monitor_context->event_handler_count++;
+    taskEXIT_CRITICAL(&as3935_monitor_context->handlers_lock);
+
+    return as3935_monitor_update_isr(as3935_monitor_context);
 }
 
 esp_err_t as3935_monitor_remove_handler(as3935_monitor_handle_t monitor_handle, esp_event_handler_t event_handler) {
     as3935_monitor_context_t *as3935_monitor_context = (as3935_monitor_context_t *)monitor_handle;
 
-    /* remove isr handler for gpio number */
-    gpio_isr_handler_remove(as3935_monitor_context->irq_io_num);
+    ESP_ARG_CHECK( as3935_monitor_context && event_handler );
 
     /* remove esp event handler from caller */
-    return esp_event_handler_unregister_with(as3935_monitor_context->event_loop_handle, ESP_AS3935_EVENT, ESP_EVENT_ANY_ID, event_handler);
+    ESP_RETURN_ON_ERROR( esp_event_handler_unregister_with(as3935_monitor_context->event_loop_handle, ESP_AS3935_EVENT, ESP_EVENT_ANY_ID, event_handler),
+                         TAG, "event handler unregister failed" );
+
+    taskENTER_CRITICAL(&as3935_monitor_context->handlers_lock);
+    if (as3935_monitor_context->event_handler_count > 0) {
+        as3935_monitor_context->event_handler_count--;
+    }
+    taskEXIT_CRITICAL(&as3935_monitor_context->handlers_lock);
+
+    return as3935_monitor_update_isr(as3935_monitor_context);
+}
+
+esp_err_t as3935_monitor_add_direct_handler(as3935_monitor_handle_t monitor_handle, as3935_monitor_direct_handler_t handler, void *handler_args) {
+    as3935_monitor_context_t *as3935_monitor_context = (as3935_monitor_context_t *)monitor_handle;
+    esp_err_t ret = ESP_ERR_NO_MEM;
+
+    ESP_ARG_CHECK( as3935_monitor_context && handler );
+
+    taskENTER_CRITICAL(&as3935_monitor_context->handlers_lock);
+    for (uint8_t i = 0; i < AS3935_DIRECT_HANDLERS_MAX; i++) {
+        if (as3935_monitor_context->direct_handlers[i].handler == NULL) {
+            as3935_monitor_context->direct_handlers[i].args    = handler_args;
+            as3935_monitor_context->direct_handlers[i].handler = handler;
+            as3935_monitor_context->direct_handler_count++;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&as3935_monitor_context->handlers_lock);
+
+    ESP_RETURN_ON_ERROR( ret, TAG, "no free direct handler slot" );
+
+    return as3935_monitor_update_isr(as3935_monitor_context);
+}
+
+esp_err_t as3935_monitor_remove_direct_handler(as3935_monitor_handle_t monitor_handle, as3935_monitor_direct_handler_t handler) {
+    as3935_monitor_context_t *as3935_monitor_context = (as3935_monitor_context_t *)monitor_handle;
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+
+    ESP_ARG_CHECK( as3935_monitor_context && handler );
+
+    taskENTER_CRITICAL(&as3935_monitor_context->handlers_lock);
+    for (uint8_t i = 0; i < AS3935_DIRECT_HANDLERS_MAX; i++) {
+        if (as3935_monitor_context->direct_handlers[i].handler == handler) {
+            as3935_monitor_context->direct_handlers[i].handler = NULL;
+            as3935_monitor_context->direct_handlers[i].args    = NULL;
+            as3935_monitor_context->direct_handler_count--;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&as3935_monitor_context->handlers_lock);
+
+    ESP_RETURN_ON_ERROR( ret, TAG, "direct handler not registered" );
+
+    return as3935_monitor_update_isr(as3935_monitor_context);
+}
+
+esp_err_t as3935_monitor_get_irq_stats(as3935_monitor_handle_t monitor_handle, as3935_monitor_irq_stats_t *const stats) {
+    as3935_monitor_context_t *as3935_monitor_context = (as3935_monitor_context_t *)monitor_handle;
+
+    ESP_ARG_CHECK( as3935_monitor_context && stats );
+
+    stats->irq_count      = as3935_monitor_context->irq_count;
+    stats->irq_overruns   = as3935_monitor_context->irq_overruns;
+    stats->irq_merged     = as3935_monitor_context->irq_merged;
+    stats->readouts       = as3935_monitor_context->readouts;
+    stats->latency_max_us = as3935_monitor_context->latency_max_us;
+    memcpy(stats->latency_bucket_le_us, as3935_latency_bucket_le_us, sizeof(stats->latency_bucket_le_us));
+    memcpy(stats->latency_hist, as3935_monitor_context->latency_hist, sizeof(stats->latency_hist));
+
+    return ESP_OK;
 }
 
 esp_err_t as3935_get_0x00_register(as3935_handle_t handle, as3935_0x00_register_t *const reg) {
@@ -413,7 +753,7 @@ esp_err_t as3935_get_0x00_register(as3935_handle_t handle, as3935_0x00_register_
 
     ESP_ARG_CHECK( dev );
 
-    ESP_ERROR_CHECK( as3935_i2c_read_byte_from(dev, AS3935_REG_00, &reg->reg) );
+    ESP_ERROR_CHECK( as3935_i2c_read_byte_from(dev, AS3935_BUS_PRIORITY_CONTROL, AS3935_REG_00, &reg->reg) );
 
     return ESP_OK;
 }
@@ -426,7 +766,7 @@ esp_err_t as3935_set_0x00_register(as3935_handle_t handle, const as3935_0x00_reg
     as3935_0x00_register_t reg_0x00 = { .reg = reg.reg };
     reg_0x00.bits.reserved = 0;
 
-    ESP_ERROR_CHECK( as3935_i2c_write_byte_to(dev, AS3935_REG_00, reg_0x00.reg) );
+    ESP_ERROR_CHECK( as3935_i2c_write_byte_to(dev, AS3935_BUS_PRIORITY_CONTROL, AS3935_REG_00, reg_0x00.reg) );
 
     return ESP_OK;
 }
@@ -436,7 +776,7 @@ esp_err_t as3935_get_0x01_register(as3935_handle_t handle, as3935_0x01_register_
 
     ESP_ARG_CHECK( dev );
 
-    ESP_ERROR_CHECK( as3935_i2c_read_byte_from(dev, AS3935_REG_01, &reg->reg) );
+    ESP_ERROR_CHECK( as3935_i2c_read_byte_from(dev, AS3935_BUS_PRIORITY_CONTROL, AS3935_REG_01, &reg->reg) );
 
     return ESP_OK;
 }
@@ -449,7 +789,7 @@ esp_err_t as3935_set_0x01_register(as3935_handle_t handle, const as3935_0x01_reg
     as3935_0x01_register_t reg_0x01 = { .reg = reg.reg };
     reg_0x01.bits.reserved = 0;
 
-    ESP_ERROR_CHECK( as3935_i2c_write_byte_to(dev, AS3935_REG_01, reg_0x01.reg) );
+    ESP_ERROR_CHECK( as3935_i2c_write_byte_to(dev, AS3935_BUS_PRIORITY_CONTROL, AS3935_REG_01, reg_0x01.reg) );
 
     return ESP_OK;
 }
@@ -459,7 +799,7 @@ esp_err_t as3935_get_0x02_register(as3935_handle_t handle, as3935_0x02_register_
 
     ESP_ARG_CHECK( dev );
 
-    ESP_ERROR_CHECK( as3935_i2c_read_byte_from(dev, AS3935_REG_02, &reg->reg) );
+    ESP_ERROR_CHECK( as3935_i2c_read_byte_from(dev, AS3935_BUS_PRIORITY_CONTROL, AS3935_REG_02, &reg->reg) );
 
     return ESP_OK;
 }
@@ -472,7 +812,7 @@ esp_err_t as3935_set_0x02_register(as3935_handle_t handle, const as3935_0x02_reg
     as3935_0x02_register_t reg_0x02 = { .reg = reg.reg };
     reg_0x02.bits.reserved = 0;
 
-    ESP_ERROR_CHECK( as3935_i2c_write_byte_to(dev, AS3935_REG_02, reg_0x02.reg) );
+    ESP_ERROR_CHECK( as3935_i2c_write_byte_to(dev, AS3935_BUS_PRIORITY_CONTROL, AS3935_REG_02, reg_0x02.reg) );
 
     return ESP_OK;
 }
@@ -488,7 +828,7 @@ esp_err_t as3935_get_0x03_register(as3935_handle_t handle, as3935_0x03_register_
     // retry to overcome unexpected nack
     do {
         /* attempt i2c read transaction */
-        ret = as3935_i2c_read_byte_from(dev, AS3935_REG_03, &reg->reg);
+        ret = as3935_i2c_read_byte_from(dev, AS3935_BUS_PRIORITY_CONTROL, AS3935_REG_03, &reg->reg);
 
         /* delay before next retry attempt */
         vTaskDelay(pdMS_TO_TICKS(1));
@@ -508,7 +848,7 @@ esp_err_t as3935_set_0x03_register(as3935_handle_t handle, const as3935_0x03_reg
     as3935_0x03_register_t reg_0x03 = { .reg = reg.reg };
     reg_0x03.bits.reserved = 0;
 
-    ESP_ERROR_CHECK( as3935_i2c_write_byte_to(dev, AS3935_REG_03, reg_0x03.reg) );
+    ESP_ERROR_CHECK( as3935_i2c_write_byte_to(dev, AS3935_BUS_PRIORITY_CONTROL, AS3935_REG_03, reg_0x03.reg) );
 
     return ESP_OK;
 }
@@ -518,7 +858,7 @@ esp_err_t as3935_get_0x08_register(as3935_handle_t handle, as3935_0x08_register_
 
     ESP_ARG_CHECK( dev );
 
-    ESP_ERROR_CHECK( as3935_i2c_read_byte_from(dev, AS3935_REG_08, &reg->reg) );
+    ESP_ERROR_CHECK( as3935_i2c_read_byte_from(dev, AS3935_BUS_PRIORITY_CONTROL, AS3935_REG_08, &reg->reg) );
 
     return ESP_OK;
 }
@@ -531,7 +871,7 @@ esp_err_t as3935_set_0x08_register(as3935_handle_t handle, const as3935_0x08_reg
     as3935_0x08_register_t reg_0x08 = { .reg = reg.reg };
     reg_0x08.bits.reserved = 0;
 
-    ESP_ERROR_CHECK( as3935_i2c_write_byte_to(dev, AS3935_REG_08, reg_0x08.reg) );
+    ESP_ERROR_CHECK( as3935_i2c_write_byte_to(dev, AS3935_BUS_PRIORITY_CONTROL, AS3935_REG_08, reg_0x08.reg) );
 
     return ESP_OK;
 }
@@ -582,6 +922,7 @@ esp_err_t as3935_init(i2c_master_bus_handle_t master_handle, const as3935_config
 
     /* copy configuration */
     dev->config = *as3935_config;
+    portMUX_INITIALIZE(&dev->shadow_lock);
 
     /* set i2c device configuration */
     const i2c_device_config_t i2c_dev_conf = {
@@ -598,6 +939,12 @@ esp_err_t as3935_init(i2c_master_bus_handle_t master_handle, const as3935_config
     /* set up */
     ESP_ERROR_CHECK( as3935_setup((as3935_handle_t)dev) );
 
+    /* prime the register shadow, this also acknowledges any stale interrupt */
+    uint8_t registers[AS3935_REG_BLOCK_SIZE];
+    if (as3935_i2c_read_from(dev, AS3935_BUS_PRIORITY_CONTROL, AS3935_REG_00, registers, AS3935_REG_BLOCK_SIZE) != ESP_OK) {
+        ESP_LOGW(TAG, "as3935 register shadow priming failed, shadow fills on first access");
+    }
+
     /* set device handle */
     *as3935_handle = (as3935_handle_t)dev;
 
@@ -630,7 +977,7 @@ esp_err_t as3935_reset_to_defaults(as3935_handle_t handle) {
 
     ESP_ARG_CHECK( dev );
 
-    ESP_ERROR_CHECK( as3935_i2c_write_byte_to(dev, AS3935_CMD_PRESET_DEFAULT, AS3935_REG_RST) );
+    ESP_ERROR_CHECK( as3935_i2c_write_byte_to(dev, AS3935_BUS_PRIORITY_CONTROL, AS3935_CMD_PRESET_DEFAULT, AS3935_REG_RST) );
 
     return ESP_OK;
 }
@@ -641,7 +988,7 @@ esp_err_t as3935_calibrate_rco(as3935_handle_t handle) {
     ESP_ARG_CHECK( dev );
 
     ESP_ERROR_CHECK( as3935_disable_power(handle) );
-    ESP_ERROR_CHECK( as3935_i2c_write_byte_to(dev, AS3935_CMD_CALIB_RCO, AS3935_REG_RST) );
+    ESP_ERROR_CHECK( as3935_i2c_write_byte_to(dev, AS3935_BUS_PRIORITY_CONTROL, AS3935_CMD_CALIB_RCO, AS3935_REG_RST) );
 
     ESP_ERROR_CHECK( as3935_set_display_oscillator_on_irq(handle, AS3935_OSCILLATOR_SYSTEM_RC, true));
     vTaskDelay(pdMS_TO_TICKS(AS3935_CALIBRATION_DELAY_MS));
@@ -1018,7 +1365,7 @@ esp_err_t as3935_get_lightning_distance(as3935_handle_t handle, as3935_lightning
 
     ESP_ARG_CHECK( handle );
 
-    ESP_ERROR_CHECK( as3935_i2c_read_byte_from(handle, AS3935_REG_07, &reg_0x07.reg) );
+    ESP_ERROR_CHECK( as3935_i2c_read_byte_from(handle, AS3935_BUS_PRIORITY_CONTROL, AS3935_REG_07, &reg_0x07.reg) );
 
     *distance = reg_0x07.bits.lightning_distance;
 
@@ -1040,7 +1387,7 @@ esp_err_t as3935_get_lightning_energy(as3935_handle_t handle, uint32_t *const en
 
     ESP_ARG_CHECK( handle );
 
-    ESP_ERROR_CHECK( as3935_i2c_read_from(handle, AS3935_REG_04, data, BIT24_UINT8_BUFFER_SIZE) );
+    ESP_ERROR_CHECK( as3935_i2c_read_from(handle, AS3935_BUS_PRIORITY_CONTROL, AS3935_REG_04, data, BIT24_UINT8_BUFFER_SIZE) );
 
     data[2] &= 0b11111;
 
@@ -1053,15 +1400,116 @@ esp_err_t as3935_get_lightning_energy(as3935_handle_t handle, uint32_t *const en
 }
 
 esp_err_t as3935_get_lightning_event(as3935_handle_t handle, as3935_lightning_distances_t *const distance, uint32_t *const energy) {
-    ESP_ARG_CHECK( handle );
+    uint8_t data[4];    /* 0x04..0x06 energy, 0x07 distance */
+
+    ESP_ARG_CHECK( handle && distance && energy );
+
+    ESP_ERROR_CHECK( as3935_i2c_read_from(handle, AS3935_BUS_PRIORITY_CONTROL, AS3935_REG_04, data, sizeof(data)) );
+
+    *energy   = as3935_decode_lightning_energy(data);
+    *distance = as3935_decode_lightning_distance(data[3]);
+
+    return ESP_OK;
+}
+
+esp_err_t as3935_get_event_block(as3935_handle_t handle, as3935_monitor_base_t *const event) {
+    as3935_0x03_register_t reg_0x03;
+
+    ESP_ARG_CHECK( handle && event );
+
+    ESP_RETURN_ON_ERROR( as3935_i2c_read_from(handle, AS3935_BUS_PRIORITY_IRQ, AS3935_REG_00, event->registers, AS3935_REG_BLOCK_SIZE), TAG, "read event registers failed" );
+
+    reg_0x03.reg     = event->registers[AS3935_REG_03];
+    event->irq_state = reg_0x03.bits.irq_state;
+
+    if(event->irq_state == AS3935_INT_LIGHTNING) {
+        event->lightning_energy   = as3935_decode_lightning_energy(&event->registers[AS3935_REG_04]);
+        event->lightning_distance = as3935_decode_lightning_distance(event->registers[AS3935_REG_07]);
+    } else {
+        /* set parent device fields to defaults */
+        event->lightning_energy   = 0;
+        event->lightning_distance = AS3935_L_DISTANCE_OO_RANGE;
+    }
+
+    return ESP_OK;
+}
 
-    ESP_ERROR_CHECK( as3935_get_lightning_distance(handle, distance) );
+esp_err_t as3935_get_register_shadow(as3935_handle_t handle, as3935_register_shadow_t *const shadow) {
+    as3935_device_t* dev = (as3935_device_t*)handle;
+
+    ESP_ARG_CHECK( dev && shadow );
+
+    taskENTER_CRITICAL(&dev->shadow_lock);
+    *shadow = dev->shadow;
+    taskEXIT_CRITICAL(&dev->shadow_lock);
+
+    /* evaluate staleness and decode event registers outside the lock */
+    const int64_t now_us = esp_timer_get_time();
+    shadow->stale_mask = (uint16_t)(~shadow->valid_mask & UINT16_C(0x01ff));
+    for (uint8_t reg = 0; reg < AS3935_REG_BLOCK_SIZE; reg++) {
+        const uint16_t bit = (uint16_t)(1u << reg);
+        if ((AS3935_SHADOW_VERIFY_MASK & bit) && (now_us - shadow->synced_us[reg]) > (int64_t)AS3935_SHADOW_STALE_MS * 1000) {
+            shadow->stale_mask |= bit;
+        }
+    }
+    shadow->lightning_energy   = as3935_decode_lightning_energy(&shadow->registers[AS3935_REG_04]);
+    shadow->lightning_distance = as3935_decode_lightning_distance(shadow->registers[AS3935_REG_07]);
+
+    return ESP_OK;
+}
+
+esp_err_t as3935_verify_register_shadow(as3935_handle_t handle) {
+    as3935_device_t* dev = (as3935_device_t*)handle;
+    uint8_t expected[AS3935_REG_BLOCK_SIZE];
+    uint16_t valid_mask;
+    uint8_t data[4];    /* 0x00..0x02, 0x08 */
+
+    ESP_ARG_CHECK( dev );
 
-    ESP_ERROR_CHECK( as3935_get_lightning_energy(handle, energy) );
+    taskENTER_CRITICAL(&dev->shadow_lock);
+    memcpy(expected, dev->shadow.registers, sizeof(expected));
+    valid_mask = dev->shadow.valid_mask;
+    taskEXIT_CRITICAL(&dev->shadow_lock);
+
+    /* reads refresh the shadow through the i2c hal */
+    ESP_RETURN_ON_ERROR( as3935_i2c_read_from(dev, AS3935_BUS_PRIORITY_DIAG, AS3935_REG_00, data, 3), TAG, "verify registers 0x00..0x02 failed" );
+    ESP_RETURN_ON_ERROR( as3935_i2c_read_byte_from(dev, AS3935_BUS_PRIORITY_DIAG, AS3935_REG_08, &data[3]), TAG, "verify register 0x08 failed" );
+
+    const uint8_t regs[4] = { AS3935_REG_00, AS3935_REG_01, AS3935_REG_02, AS3935_REG_08 };
+    uint32_t mismatches = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        if ((valid_mask & (1u << regs[i])) && expected[regs[i]] != data[i]) {
+            ESP_LOGW(TAG, "register 0x%02x changed behind the driver: shadow 0x%02x, device 0x%02x", regs[i], expected[regs[i]], data[i]);
+            mismatches++;
+        }
+    }
+
+    taskENTER_CRITICAL(&dev->shadow_lock);
+    dev->shadow.verify_count++;
+    dev->shadow.verify_mismatches += mismatches;
+    taskEXIT_CRITICAL(&dev->shadow_lock);
 
     return ESP_OK;
 }
 
+esp_err_t as3935_read_register(as3935_handle_t handle, const uint8_t reg_addr, uint8_t *const value) {
+    ESP_ARG_CHECK( handle && value );
+
+    return as3935_i2c_read_byte_from(handle, AS3935_BUS_PRIORITY_DIAG, reg_addr, value);
+}
+
+esp_err_t as3935_write_register(as3935_handle_t handle, const uint8_t reg_addr, const uint8_t value) {
+    ESP_ARG_CHECK( handle );
+
+    return as3935_i2c_write_byte_to(handle, AS3935_BUS_PRIORITY_DIAG, reg_addr, value);
+}
+
+esp_err_t as3935_write_registers(as3935_handle_t handle, const uint8_t reg_addr, const uint8_t *values, const uint8_t count) {
+    ESP_ARG_CHECK( handle && values );
+
+    return as3935_i2c_write_to(handle, AS3935_BUS_PRIORITY_CONTROL, reg_addr, values, count);
+}
+
 esp_err_t as3935_remove(as3935_handle_t handle) {
     as3935_device_t* device = (as3935_device_t*)handle;
 
@@ -41,8 +41,10 @@
 #include <esp_event.h>
 #include <esp_err.h>
 #include <driver/i2c_master.h>
+#include <i2c_arbiter.h>
 #include <type_utils.h>
 #include <driver/gpio.h>
+#include <esp_timer.h>
 #include "as3935_version.h"
 
 #ifdef __cplusplus
@@ -70,6 +72,7 @@ extern "C" {
 #define AS3935_REG_06                UINT8_C(0x06)   //!< as3935 I2C register to access energy of lightning (MMSBYTE)
 #define AS3935_REG_07                UINT8_C(0x07)   //!< as3935 I2C register to access distance estimation of lightning
 #define AS3935_REG_08                UINT8_C(0x08)   //!< as3935 I2C register to access internal tuning caps and display (LCO, SRCO, TRCO) on IRQ pin
+#define AS3935_REG_BLOCK_SIZE        (9)             //!< as3935 registers 0x00..0x08 read in one burst transaction
 #define AS3935_REG_RST               UINT8_C(0x96)   //!< as3935 I2C register to either calibrate or reset registers to default
 /* AS3935 command */
 #define AS3935_CMD_PRESET_DEFAULT    UINT8_C(0x3c)   //!< as3935 I2C command to set all registers in default mode
@@ -81,6 +84,14 @@ extern "C" {
 #define AS3935_INTERRUPT_DELAY_MS    (2)            //!< as3935 I2C interrupt delay in milliseconds
 #define AS3935_CALIBRATION_DELAY_MS  (2)            //!< as3935 I2C calibration delay in milliseconds for RC oscillators
 #define AS3935_TX_RX_DELAY_MS           UINT16_C(10)
+#define AS3935_IRQ_RING_SIZE            (8)         //!< as3935 interrupt timestamp ring depth, power of two
+#define AS3935_NOTIFY_IRQ_BIT           (1UL << 0)  //!< as3935 monitor task notification bit set by the interrupt handler
+#define AS3935_NOTIFY_DEADLINE_BIT      (1UL << 1)  //!< as3935 monitor task notification bit set by the readout timer
+#define AS3935_DIRECT_HANDLERS_MAX      (4)         //!< as3935 monitor direct handler slots
+#define AS3935_LATENCY_BUCKETS          (9)         //!< as3935 irq-to-readout latency histogram bucket count
+#define AS3935_SHADOW_VERIFY_PERIOD_MS  (60000)     //!< as3935 register shadow background verify period in milliseconds
+#define AS3935_SHADOW_STALE_MS          (3 * AS3935_SHADOW_VERIFY_PERIOD_MS) //!< as3935 register shadow entry age after which it is reported stale
+#define AS3935_SHADOW_VERIFY_MASK       UINT16_C(0x0107) //!< as3935 registers covered by the background verify (0x00..0x02, 0x08)
 
 /**
  * @brief declare of AS3935 monitor event base.
@@ -355,9 +366,27 @@ typedef struct as3935_config_s {
     bool                                calibrate_rco;              /*!< as3935 rco is calibrated when true */
     bool                                disturber_detection_enabled;/*!< as3935 disturber detection is enabled when true */
     as3935_noise_levels_t               noise_level_threshold;      /*!< as3935 noise level threshold */
+    i2c_arbiter_handle_t                i2c_arbiter;                /*!< i2c bus arbiter shared with other bus users, NULL for direct bus access */
 } as3935_config_t;
 
 
+/**
+ * @brief AS3935 register shadow structure definition.  A RAM copy of registers
+ * 0x00..0x08 kept current by every register write and read the driver issues,
+ * including the interrupt burst read, and by a periodic background verify.
+ */
+typedef struct as3935_register_shadow_s {
+    uint8_t                         registers[AS3935_REG_BLOCK_SIZE];   /*!< last known contents of registers 0x00..0x08 */
+    int64_t                         synced_us[AS3935_REG_BLOCK_SIZE];   /*!< esp_timer time each register was last read or written, 0 when never */
+    uint16_t                        valid_mask;                         /*!< bit n set when register n holds a value read from or written to the device */
+    uint16_t                        stale_mask;                         /*!< bit n set when register n is invalid, or is verified and older than AS3935_SHADOW_STALE_MS */
+    uint32_t                        generation;                         /*!< incremented whenever a register value or its validity changes */
+    uint32_t                        verify_count;                       /*!< background verify passes completed */
+    uint32_t                        verify_mismatches;                  /*!< registers found to differ from the shadow during verify */
+    uint32_t                        lightning_energy;                   /*!< lightning energy decoded from registers 0x04..0x06 */
+    as3935_lightning_distances_t    lightning_distance;                 /*!< lightning distance decoded from register 0x07 */
+} as3935_register_shadow_t;
+
 /**
  * @brief AS3935 opaque handle structure definition.
 */
@@ -369,10 +398,45 @@ typedef gpio_isr_t as3935_isr_t;
  * @brief AS3935 device event object structure.
  */
 typedef struct as3935_monitor_base_s {
-    as3935_lightning_distances_t    lightning_distance;
-    uint32_t                        lightning_energy; 
+    as3935_lightning_distances_t    lightning_distance;                 /*!< lightning distance, out of range unless irq_state is lightning */
+    uint32_t                        lightning_energy;                   /*!< lightning energy, zero unless irq_state is lightning */
+    as3935_interrupt_states_t       irq_state;                          /*!< interrupt source decoded from register 0x03 */
+    uint8_t                         registers[AS3935_REG_BLOCK_SIZE];   /*!< registers 0x00..0x08 captured by the interrupt burst read */
+    int64_t                         irq_timestamp_us;                   /*!< esp_timer time the interrupt line rose, captured in the isr */
 } as3935_monitor_base_t;
 
+/**
+ * @brief AS3935 monitor interrupt statistics structure.
+ */
+typedef struct as3935_monitor_irq_stats_s {
+    uint32_t                        irq_count;                          /*!< interrupts timestamped by the isr */
+    uint32_t                        irq_overruns;                       /*!< interrupts dropped because the timestamp ring was full */
+    uint32_t                        irq_merged;                         /*!< interrupts folded into an already scheduled readout */
+    uint32_t                        readouts;                           /*!< interrupt register readouts performed */
+    uint32_t                        latency_max_us;                     /*!< longest irq-to-readout latency */
+    uint32_t                        latency_bucket_le_us[AS3935_LATENCY_BUCKETS]; /*!< histogram bucket upper bounds, UINT32_MAX for the last */
+    uint32_t                        latency_hist[AS3935_LATENCY_BUCKETS];         /*!< irq-to-readout latency histogram */
+} as3935_monitor_irq_stats_t;
+
+/**
+ * @brief AS3935 monitor direct handler, invoked synchronously from the monitor
+ * task with the event record.  The record is only valid for the duration of
+ * the call; copy what must be kept and return quickly.
+ * 
+ * @param handler_args handler specific arguments given at registration.
+ * @param event_id AS3935 interrupt state, or 200 for an unknown source.
+ * @param event AS3935 event record.
+ */
+typedef void (*as3935_monitor_direct_handler_t)(void *handler_args, int32_t event_id, const as3935_monitor_base_t *event);
+
+/**
+ * @brief AS3935 monitor direct handler registration.
+ */
+typedef struct as3935_monitor_direct_entry_s {
+    as3935_monitor_direct_handler_t handler;    /*!< direct handler, NULL when the slot is free */
+    void                           *args;       /*!< direct handler arguments */
+} as3935_monitor_direct_entry_t;
+
 /**
  * @brief esp AS3935 device state machine structure.
 */
@@ -380,10 +444,25 @@ typedef struct as3935_monitor_context_s {
     uint32_t                irq_io_num;          /*!< as3935 interrupt pin to mcu */
     as3935_monitor_base_t   base;                /*!< as3935 device parent class */     
     esp_event_loop_handle_t event_loop_handle;   /*!< as3935 event loop handle */
-    QueueHandle_t           event_queue_handle;  /*!< as3935 event queue handle */ 
     TaskHandle_t            task_monitor_handle; /*!< as3935 task monitor handle */ 
     as3935_handle_t         as3935_handle;       /*!< as3935 handle */
-    SemaphoreHandle_t       i2c_mutex_handle;    /*!< I2C master bus mutex handle */
+    int64_t                 irq_stamps[AS3935_IRQ_RING_SIZE]; /*!< isr timestamp ring, single producer (isr) single consumer (task) */
+    volatile uint32_t       irq_head;            /*!< isr timestamp ring write index, written by the isr only */
+    volatile uint32_t       irq_tail;            /*!< isr timestamp ring read index, written by the task only */
+    volatile uint32_t       irq_count;           /*!< interrupts seen by the isr */
+    volatile uint32_t       irq_overruns;        /*!< interrupts dropped on a full ring */
+    esp_timer_handle_t      readout_timer;       /*!< one-shot timer firing AS3935_INTERRUPT_DELAY_MS after the isr timestamp */
+    bool                    readout_armed;       /*!< a readout is scheduled for pending_stamp_us */
+    int64_t                 pending_stamp_us;    /*!< isr timestamp of the interrupt the scheduled readout serves */
+    uint32_t                irq_merged;          /*!< interrupts folded into a scheduled readout */
+    uint32_t                readouts;            /*!< interrupt register readouts performed */
+    uint32_t                latency_max_us;      /*!< longest irq-to-readout latency */
+    uint32_t                latency_hist[AS3935_LATENCY_BUCKETS]; /*!< irq-to-readout latency histogram */
+    portMUX_TYPE            handlers_lock;       /*!< protects handler registrations */
+    as3935_monitor_direct_entry_t direct_handlers[AS3935_DIRECT_HANDLERS_MAX]; /*!< direct handler slots */
+    uint8_t                 event_handler_count; /*!< esp_event handlers registered, events are posted only when non-zero */
+    uint8_t                 direct_handler_count;/*!< direct handlers registered */
+    bool                    isr_installed;       /*!< gpio isr handler is hooked */
 } as3935_monitor_context_t;
 
 
@@ -432,6 +511,41 @@ esp_err_t as3935_monitor_add_handler(as3935_monitor_handle_t monitor_handle, esp
  */
 esp_err_t as3935_monitor_remove_handler(as3935_monitor_handle_t monitor_handle, esp_event_handler_t event_handler);
 
+/**
+ * @brief adds a direct handler for AS3935 monitor.  Direct handlers are called
+ * synchronously from the monitor task with a const pointer to the event record,
+ * without the copy and scheduling of the esp_event loop.  Both kinds of handler
+ * may be registered at the same time.
+ * 
+ * @param[in] monitor_handle AS3935 monitor handle.
+ * @param[in] handler direct handler.
+ * @param[in] handler_args handler specific arguments.
+ * @return esp_err_t
+ *  - ESP_OK on success.
+ *  - ESP_ERR_NO_MEM when all AS3935_DIRECT_HANDLERS_MAX slots are in use.
+ */
+esp_err_t as3935_monitor_add_direct_handler(as3935_monitor_handle_t monitor_handle, as3935_monitor_direct_handler_t handler, void *handler_args);
+
+/**
+ * @brief removes a direct handler for AS3935 monitor.
+ * 
+ * @param[in] monitor_handle AS3935 monitor handle.
+ * @param[in] handler direct handler.
+ * @return esp_err_t
+ *  - ESP_OK on success.
+ *  - ESP_ERR_NOT_FOUND when the handler is not registered.
+ */
+esp_err_t as3935_monitor_remove_direct_handler(as3935_monitor_handle_t monitor_handle, as3935_monitor_direct_handler_t handler);
+
+/**
+ * @brief gets AS3935 monitor interrupt statistics.
+ * 
+ * @param[in] monitor_handle AS3935 monitor handle.
+ * @param[out] stats interrupt statistics.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t as3935_monitor_get_irq_stats(as3935_monitor_handle_t monitor_handle, as3935_monitor_irq_stats_t *const stats);
+
 /**
  * @brief gets 0x00 register from AS3935.
  * 
@@ -592,6 +706,72 @@ esp_err_t as3935_get_lightning_distance(as3935_handle_t handle, as3935_lightning
 esp_err_t as3935_get_lightning_distance_km(as3935_handle_t handle, uint8_t *const distance);
 esp_err_t as3935_get_lightning_event(as3935_handle_t handle, as3935_lightning_distances_t *const distance, uint32_t *const energy);
 
+/**
+ * @brief gets registers 0x00..0x08 of AS3935 in a single burst transaction
+ * and decodes the interrupt state, lightning distance and energy.  Reading
+ * register 0x03 clears the interrupt, so this is meant for the interrupt path
+ * and is issued at interrupt bus priority.  Errors are returned, not asserted.
+ * 
+ * @param[in] handle AS3935 device handle.
+ * @param[out] event interrupt state, lightning distance, energy and raw registers.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t as3935_get_event_block(as3935_handle_t handle, as3935_monitor_base_t *const event);
+
+/**
+ * @brief gets a snapshot of the AS3935 register shadow.  No bus traffic.
+ * 
+ * @param[in] handle AS3935 device handle.
+ * @param[out] shadow register shadow snapshot with stale_mask evaluated at call time.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t as3935_get_register_shadow(as3935_handle_t handle, as3935_register_shadow_t *const shadow);
+
+/**
+ * @brief re-reads the registers in AS3935_SHADOW_VERIFY_MASK and refreshes the
+ * shadow, counting registers that no longer match.  Register 0x03 is left out
+ * because reading it acknowledges a pending interrupt.
+ * 
+ * @param[in] handle AS3935 device handle.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t as3935_verify_register_shadow(as3935_handle_t handle);
+
+/**
+ * @brief reads one AS3935 register at diagnostic bus priority and updates the
+ * shadow.  Errors are returned, not asserted, so it is safe for HTTP handlers.
+ * 
+ * @param[in] handle AS3935 device handle.
+ * @param[in] reg_addr register address.
+ * @param[out] value register contents.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t as3935_read_register(as3935_handle_t handle, const uint8_t reg_addr, uint8_t *const value);
+
+/**
+ * @brief writes one AS3935 register at diagnostic bus priority and updates the
+ * shadow.  Errors are returned, not asserted, so it is safe for HTTP handlers.
+ * 
+ * @param[in] handle AS3935 device handle.
+ * @param[in] reg_addr register address.
+ * @param[in] value register contents.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t as3935_write_register(as3935_handle_t handle, const uint8_t reg_addr, const uint8_t value);
+
+/**
+ * @brief writes consecutive AS3935 registers within 0x00..0x08 in a single burst
+ * transaction at control bus priority and updates the shadow.  Use it to apply
+ * several configuration fields in one bus pass.
+ * 
+ * @param[in] handle AS3935 device handle.
+ * @param[in] reg_addr first register address.
+ * @param[in] values register contents, one byte per register.
+ * @param[in] count number of registers to write.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t as3935_write_registers(as3935_handle_t handle, const uint8_t reg_addr, const uint8_t *values, const uint8_t count);
+
 /**
  * @brief Removes an AS3935 device from I2C master bus.
  *
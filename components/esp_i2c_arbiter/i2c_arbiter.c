@@ -0,0 +1,273 @@
+/**
+ * @file i2c_arbiter.c
+ * @brief Single-owner I2C master bus arbiter with prioritized access
+ *
+ * The bus is a token: whoever holds it may run transactions, everyone else
+ * parks on a waiter record that lives on their own stack.  Waiters are kept in
+ * one FIFO per priority class and release hands the token directly to the head
+ * of the highest non-empty class, so there is no thundering herd and no
+ * priority inversion between classes.
+ */
+
+#include "include/i2c_arbiter.h"
+#include <string.h>
+#include <stdlib.h>
+#include <esp_log.h>
+#include <esp_check.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#define ESP_ARG_CHECK(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+/**
+ * @brief I2C arbiter waiter record, allocated on the waiting task's stack.
+ */
+typedef struct i2c_arbiter_waiter_s {
+    struct i2c_arbiter_waiter_s *next;          /*!< next waiter of the same class */
+    SemaphoreHandle_t           grant;          /*!< given when the bus is handed over */
+    StaticSemaphore_t           grant_buffer;   /*!< storage for grant semaphore */
+    bool                        granted;        /*!< set under lock on hand over */
+} i2c_arbiter_waiter_t;
+
+/**
+ * @brief I2C arbiter structure definition.
+ */
+struct i2c_arbiter_s {
+    i2c_master_bus_handle_t bus_handle;                 /*!< owned i2c master bus */
+    portMUX_TYPE            lock;                       /*!< protects owner flag, queues and stats */
+    bool                    busy;                       /*!< bus token is held */
+    i2c_arbiter_waiter_t   *head[I2C_ARBITER_PRIO_MAX]; /*!< per-class waiter fifo head */
+    i2c_arbiter_waiter_t   *tail[I2C_ARBITER_PRIO_MAX]; /*!< per-class waiter fifo tail */
+    i2c_arbiter_stats_t     stats[I2C_ARBITER_PRIO_MAX];/*!< per-class statistics */
+};
+
+static const char *TAG = "i2c_arbiter";
+
+static inline void i2c_arbiter_account_grant(i2c_arbiter_handle_t handle, const i2c_arbiter_priority_t priority, const int64_t wait_us, const bool contended) {
+    i2c_arbiter_stats_t *stats = &handle->stats[priority];
+
+    stats->transactions++;
+    if (contended) {
+        stats->contended++;
+    }
+    stats->wait_total_us += (uint64_t)wait_us;
+    if (wait_us > stats->wait_max_us) {
+        stats->wait_max_us = (uint32_t)wait_us;
+    }
+}
+
+static inline void i2c_arbiter_unlink_waiter(i2c_arbiter_handle_t handle, const i2c_arbiter_priority_t priority, i2c_arbiter_waiter_t *waiter) {
+    i2c_arbiter_waiter_t *prev = NULL;
+
+    for (i2c_arbiter_waiter_t *it = handle->head[priority]; it; prev = it, it = it->next) {
+        if (it != waiter) continue;
+        if (prev) {
+            prev->next = it->next;
+        } else {
+            handle->head[priority] = it->next;
+        }
+        if (handle->tail[priority] == it) {
+            handle->tail[priority] = prev;
+        }
+        return;
+    }
+}
+
+esp_err_t i2c_arbiter_new(const i2c_master_bus_config_t *bus_config, i2c_arbiter_handle_t *ret_handle) {
+    ESP_ARG_CHECK( bus_config && ret_handle );
+
+    i2c_arbiter_handle_t handle = calloc(1, sizeof(struct i2c_arbiter_s));
+    ESP_RETURN_ON_FALSE( handle, ESP_ERR_NO_MEM, TAG, "no memory for i2c arbiter" );
+
+    esp_err_t ret = i2c_new_master_bus(bus_config, &handle->bus_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "i2c_new_master_bus failed: %s", esp_err_to_name(ret));
+        free(handle);
+        return ret;
+    }
+
+    portMUX_INITIALIZE(&handle->lock);
+    *ret_handle = handle;
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_arbiter_del(i2c_arbiter_handle_t handle) {
+    ESP_ARG_CHECK( handle );
+
+    ESP_RETURN_ON_FALSE( !handle->busy, ESP_ERR_INVALID_STATE, TAG, "i2c arbiter is still in use" );
+    ESP_RETURN_ON_ERROR( i2c_del_master_bus(handle->bus_handle), TAG, "i2c_del_master_bus failed" );
+    free(handle);
+
+    return ESP_OK;
+}
+
+i2c_master_bus_handle_t i2c_arbiter_get_bus(i2c_arbiter_handle_t handle) {
+    return handle ? handle->bus_handle : NULL;
+}
+
+esp_err_t i2c_arbiter_acquire(i2c_arbiter_handle_t handle, const i2c_arbiter_priority_t priority, const uint32_t timeout_ms) {
+    ESP_ARG_CHECK( handle && priority < I2C_ARBITER_PRIO_MAX );
+
+    const int64_t start_us = esp_timer_get_time();
+
+    /* uncontended fast path: take the token and go */
+    taskENTER_CRITICAL(&handle->lock);
+    if (!handle->busy) {
+        handle->busy = true;
+        i2c_arbiter_account_grant(handle, priority, 0, false);
+        taskEXIT_CRITICAL(&handle->lock);
+        return ESP_OK;
+    }
+    taskEXIT_CRITICAL(&handle->lock);
+
+    /* slow path: queue behind the current owner */
+    i2c_arbiter_waiter_t waiter = { 0 };
+    waiter.grant = xSemaphoreCreateBinaryStatic(&waiter.grant_buffer);
+
+    taskENTER_CRITICAL(&handle->lock);
+    if (!handle->busy) {
+        /* released while the waiter was being set up */
+        handle->busy = true;
+        i2c_arbiter_account_grant(handle, priority, esp_timer_get_time() - start_us, false);
+        taskEXIT_CRITICAL(&handle->lock);
+        vSemaphoreDelete(waiter.grant);
+        return ESP_OK;
+    }
+    if (handle->tail[priority]) {
+        handle->tail[priority]->next = &waiter;
+    } else {
+        handle->head[priority] = &waiter;
+    }
+    handle->tail[priority] = &waiter;
+    taskEXIT_CRITICAL(&handle->lock);
+
+    esp_err_t ret = ESP_OK;
+    if (xSemaphoreTake(waiter.grant, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        taskENTER_CRITICAL(&handle->lock);
+        const bool granted = waiter.granted;
+        if (!granted) {
+            i2c_arbiter_unlink_waiter(handle, priority, &waiter);
+            handle->stats[priority].timeouts++;
+        }
+        taskEXIT_CRITICAL(&handle->lock);
+
+        if (granted) {
+            /* lost the race against the hand over; the grant is already on its way */
+            xSemaphoreTake(waiter.grant, portMAX_DELAY);
+        } else {
+            ret = ESP_ERR_TIMEOUT;
+        }
+    }
+
+    if (ret == ESP_OK) {
+        taskENTER_CRITICAL(&handle->lock);
+        i2c_arbiter_account_grant(handle, priority, esp_timer_get_time() - start_us, true);
+        taskEXIT_CRITICAL(&handle->lock);
+    }
+
+    vSemaphoreDelete(waiter.grant);
+
+    return ret;
+}
+
+void i2c_arbiter_release(i2c_arbiter_handle_t handle) {
+    i2c_arbiter_waiter_t *next = NULL;
+
+    if (!handle) return;
+
+    taskENTER_CRITICAL(&handle->lock);
+    for (int prio = 0; prio < I2C_ARBITER_PRIO_MAX; prio++) {
+        if (handle->head[prio] == NULL) continue;
+        next = handle->head[prio];
+        handle->head[prio] = next->next;
+        if (handle->head[prio] == NULL) {
+            handle->tail[prio] = NULL;
+        }
+        next->granted = true;
+        break;
+    }
+    /* token stays busy when it is handed straight to a waiter */
+    if (next == NULL) {
+        handle->busy = false;
+    }
+    taskEXIT_CRITICAL(&handle->lock);
+
+    if (next) {
+        xSemaphoreGive(next->grant);
+    }
+}
+
+esp_err_t i2c_arbiter_transmit(i2c_arbiter_handle_t handle, const i2c_arbiter_priority_t priority, i2c_master_dev_handle_t device,
+                               const uint8_t *tx, const size_t tx_size, const int timeout_ms) {
+    ESP_ARG_CHECK( device && tx );
+
+    if (handle == NULL) {
+        return i2c_master_transmit(device, tx, tx_size, timeout_ms);
+    }
+
+    ESP_RETURN_ON_ERROR( i2c_arbiter_acquire(handle, priority, timeout_ms), TAG, "bus not granted to %s class", i2c_arbiter_priority_name(priority) );
+    esp_err_t ret = i2c_master_transmit(device, tx, tx_size, timeout_ms);
+    if (ret != ESP_OK) {
+        taskENTER_CRITICAL(&handle->lock);
+        handle->stats[priority].errors++;
+        taskEXIT_CRITICAL(&handle->lock);
+    }
+    i2c_arbiter_release(handle);
+
+    return ret;
+}
+
+esp_err_t i2c_arbiter_transmit_receive(i2c_arbiter_handle_t handle, const i2c_arbiter_priority_t priority, i2c_master_dev_handle_t device,
+                                       const uint8_t *tx, const size_t tx_size, uint8_t *rx, const size_t rx_size, const int timeout_ms) {
+    ESP_ARG_CHECK( device && tx && rx );
+
+    if (handle == NULL) {
+        return i2c_master_transmit_receive(device, tx, tx_size, rx, rx_size, timeout_ms);
+    }
+
+    ESP_RETURN_ON_ERROR( i2c_arbiter_acquire(handle, priority, timeout_ms), TAG, "bus not granted to %s class", i2c_arbiter_priority_name(priority) );
+    esp_err_t ret = i2c_master_transmit_receive(device, tx, tx_size, rx, rx_size, timeout_ms);
+    if (ret != ESP_OK) {
+        taskENTER_CRITICAL(&handle->lock);
+        handle->stats[priority].errors++;
+        taskEXIT_CRITICAL(&handle->lock);
+    }
+    i2c_arbiter_release(handle);
+
+    return ret;
+}
+
+esp_err_t i2c_arbiter_get_stats(i2c_arbiter_handle_t handle, const i2c_arbiter_priority_t priority, i2c_arbiter_stats_t *const stats) {
+    ESP_ARG_CHECK( handle && stats && priority < I2C_ARBITER_PRIO_MAX );
+
+    taskENTER_CRITICAL(&handle->lock);
+    *stats = handle->stats[priority];
+    taskEXIT_CRITICAL(&handle->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_arbiter_reset_stats(i2c_arbiter_handle_t handle) {
+    ESP_ARG_CHECK( handle );
+
+    taskENTER_CRITICAL(&handle->lock);
+    memset(handle->stats, 0, sizeof(handle->stats));
+    taskEXIT_CRITICAL(&handle->lock);
+
+    return ESP_OK;
+}
+
+const char *i2c_arbiter_priority_name(const i2c_arbiter_priority_t priority) {
+    switch (priority) {
+        case I2C_ARBITER_PRIO_IRQ:
+            return "irq";
+        case I2C_ARBITER_PRIO_CONTROL:
+            return "control";
+        case I2C_ARBITER_PRIO_DIAG:
+            return "diag";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,165 @@
+/**
+ * @file i2c_arbiter.h
+ * @brief Single-owner I2C master bus arbiter with prioritized access
+ *
+ * The arbiter owns the I2C master bus handle and serializes every transaction
+ * issued against it.  Callers tag each transaction with a priority class;
+ * when the bus is busy, waiters are granted access highest class first and in
+ * FIFO order within a class, so a burst of low priority traffic (HTTP status
+ * polls, diagnostics) can delay an interrupt readout by at most the one
+ * transaction that is already on the wire.
+ *
+ * Per-class wait statistics are kept so contention can be observed at runtime.
+ */
+
+#ifndef __I2C_ARBITER_H__
+#define __I2C_ARBITER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <esp_err.h>
+#include <driver/i2c_master.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_ARBITER_WAIT_TIMEOUT_MS     (1000)  //!< default time a caller may queue for the bus
+
+/**
+ * @brief I2C arbiter priority classes, highest first.
+ */
+typedef enum i2c_arbiter_priority_e {
+    I2C_ARBITER_PRIO_IRQ = 0,   /*!< interrupt readout, always served first */
+    I2C_ARBITER_PRIO_CONTROL,   /*!< sensor bring-up and configuration writes */
+    I2C_ARBITER_PRIO_DIAG,      /*!< HTTP status polls and diagnostics */
+    I2C_ARBITER_PRIO_MAX
+} i2c_arbiter_priority_t;
+
+/**
+ * @brief I2C arbiter per-class statistics.
+ */
+typedef struct i2c_arbiter_stats_s {
+    uint32_t    transactions;   /*!< bus grants issued to this class */
+    uint32_t    contended;      /*!< grants that had to queue behind another owner */
+    uint32_t    timeouts;       /*!< requests that gave up waiting for the bus */
+    uint32_t    errors;         /*!< transactions that failed on the wire */
+    uint32_t    wait_max_us;    /*!< longest queueing delay observed */
+    uint64_t    wait_total_us;  /*!< accumulated queueing delay */
+} i2c_arbiter_stats_t;
+
+/**
+ * @brief I2C arbiter opaque handle.
+ */
+typedef struct i2c_arbiter_s *i2c_arbiter_handle_t;
+
+/**
+ * @brief Creates the I2C master bus and an arbiter that owns it.
+ *
+ * @param[in] bus_config I2C master bus configuration.
+ * @param[out] ret_handle I2C arbiter handle.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t i2c_arbiter_new(const i2c_master_bus_config_t *bus_config, i2c_arbiter_handle_t *ret_handle);
+
+/**
+ * @brief Deletes the arbiter and the I2C master bus it owns.  All devices must
+ * have been removed from the bus beforehand.
+ *
+ * @param[in] handle I2C arbiter handle.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t i2c_arbiter_del(i2c_arbiter_handle_t handle);
+
+/**
+ * @brief Gets the I2C master bus handle owned by the arbiter, used to add
+ * devices and probe addresses.
+ *
+ * @param[in] handle I2C arbiter handle.
+ * @return i2c_master_bus_handle_t I2C master bus handle, NULL when handle is NULL.
+ */
+i2c_master_bus_handle_t i2c_arbiter_get_bus(i2c_arbiter_handle_t handle);
+
+/**
+ * @brief Acquires exclusive use of the bus for the caller.  Use this to group
+ * several transactions that must not be interleaved; single transactions should
+ * use i2c_arbiter_transmit() or i2c_arbiter_transmit_receive().
+ *
+ * @param[in] handle I2C arbiter handle.
+ * @param[in] priority Priority class of the caller.
+ * @param[in] timeout_ms Maximum time to wait for the bus in milliseconds.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_TIMEOUT when the bus was not granted in time.
+ */
+esp_err_t i2c_arbiter_acquire(i2c_arbiter_handle_t handle, const i2c_arbiter_priority_t priority, const uint32_t timeout_ms);
+
+/**
+ * @brief Releases the bus and hands it to the highest priority waiter.
+ *
+ * @param[in] handle I2C arbiter handle.
+ */
+void i2c_arbiter_release(i2c_arbiter_handle_t handle);
+
+/**
+ * @brief Performs a write transaction on the bus.  When handle is NULL the
+ * transaction goes straight to the I2C master driver.
+ *
+ * @param[in] handle I2C arbiter handle, may be NULL.
+ * @param[in] priority Priority class of the transaction.
+ * @param[in] device I2C device handle.
+ * @param[in] tx Data to write.
+ * @param[in] tx_size Length of data to write.
+ * @param[in] timeout_ms Bus wait and transfer timeout in milliseconds.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t i2c_arbiter_transmit(i2c_arbiter_handle_t handle, const i2c_arbiter_priority_t priority, i2c_master_dev_handle_t device,
+                               const uint8_t *tx, const size_t tx_size, const int timeout_ms);
+
+/**
+ * @brief Performs a write-then-read transaction on the bus.  When handle is
+ * NULL the transaction goes straight to the I2C master driver.
+ *
+ * @param[in] handle I2C arbiter handle, may be NULL.
+ * @param[in] priority Priority class of the transaction.
+ * @param[in] device I2C device handle.
+ * @param[in] tx Data to write.
+ * @param[in] tx_size Length of data to write.
+ * @param[out] rx Buffer to store read data.
+ * @param[in] rx_size Length of data to read.
+ * @param[in] timeout_ms Bus wait and transfer timeout in milliseconds.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t i2c_arbiter_transmit_receive(i2c_arbiter_handle_t handle, const i2c_arbiter_priority_t priority, i2c_master_dev_handle_t device,
+                                       const uint8_t *tx, const size_t tx_size, uint8_t *rx, const size_t rx_size, const int timeout_ms);
+
+/**
+ * @brief Gets a snapshot of the statistics of one priority class.
+ *
+ * @param[in] handle I2C arbiter handle.
+ * @param[in] priority Priority class.
+ * @param[out] stats Statistics snapshot.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t i2c_arbiter_get_stats(i2c_arbiter_handle_t handle, const i2c_arbiter_priority_t priority, i2c_arbiter_stats_t *const stats);
+
+/**
+ * @brief Clears the statistics of all priority classes.
+ *
+ * @param[in] handle I2C arbiter handle.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t i2c_arbiter_reset_stats(i2c_arbiter_handle_t handle);
+
+/**
+ * @brief Gets the name of a priority class, e.g. "irq".
+ *
+ * @param[in] priority Priority class.
+ * @return const char* Priority class name.
+ */
+const char *i2c_arbiter_priority_name(const i2c_arbiter_priority_t priority);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __I2C_ARBITER_H__
@@ -0,0 +1,454 @@
+/**
+ * @file alerts.c
+ * @brief Rule-based storm alerts evaluated on the device
+ */
+
+#include "alerts.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_http_server.h"
+#include "freertos/FreeRTOS.h"
+#include "cJSON.h"
+#include "http_helpers.h"
+#include "event_pipeline.h"
+#include "settings.h"
+#include "storm_tracker.h"
+
+static const char *TAG = "alerts";
+
+#define ALERTS_SETTINGS_NS      "as3935_cfg"
+#define ALERTS_SETTINGS_KEY     "alert_rules"
+
+typedef enum {
+    ALERTS_FIELD_DISTANCE = 0,
+    ALERTS_FIELD_RATE,
+    ALERTS_FIELD_STRIKES,
+    ALERTS_FIELD_TREND,
+    ALERTS_FIELD_CLEAR,
+    ALERTS_FIELD_MAX
+} alerts_field_t;
+
+typedef enum {
+    ALERTS_OP_LT = 0,
+    ALERTS_OP_LE,
+    ALERTS_OP_GT,
+    ALERTS_OP_GE,
+    ALERTS_OP_EQ,
+} alerts_op_t;
+
+static const char *const g_field_names[ALERTS_FIELD_MAX] = { "distance", "rate", "strikes", "trend", "clear" };
+
+// longest operators first so "<=" is not read as "<"
+static const struct {
+    const char *text;
+    alerts_op_t op;
+} g_ops[] = {
+    { "<=", ALERTS_OP_LE }, { ">=", ALERTS_OP_GE }, { "<", ALERTS_OP_LT }, { ">", ALERTS_OP_GT }, { "=", ALERTS_OP_EQ },
+};
+
+typedef struct {
+    uint8_t field;
+    uint8_t op;
+    float   value;
+} alerts_term_t;
+
+typedef struct {
+    char    name[ALERTS_NAME_MAX];
+    char    condition[ALERTS_CONDITION_MAX];
+    uint8_t first_term;     // index into the table's terms
+    uint8_t term_count;
+} alerts_rule_t;
+
+/**
+ * @brief Compiled rules; every rule's terms are contiguous in one flat array
+ */
+typedef struct {
+    alerts_rule_t rules[ALERTS_RULES_MAX];
+    alerts_term_t terms[ALERTS_TERMS_MAX];
+    uint8_t rule_count;
+    uint8_t term_count;
+} alerts_table_t;
+
+/**
+ * @brief Rule transition found under the lock and published after it
+ */
+typedef struct {
+    char name[ALERTS_NAME_MAX];
+    char condition[ALERTS_CONDITION_MAX];
+    bool raised;
+} alerts_change_t;
+
+static portMUX_TYPE g_lock = portMUX_INITIALIZER_UNLOCKED;  // table and rule state; evaluated from the formatter, esp_timer and settings tasks
+static alerts_table_t g_table;
+static bool g_active[ALERTS_RULES_MAX];
+static uint32_t g_raised[ALERTS_RULES_MAX];
+static bool g_from_settings = false;
+static const char *g_error = NULL;      // why the stored rules were rejected, static string
+static uint32_t g_evaluations = 0;
+static uint32_t g_published = 0;
+static uint32_t g_dropped = 0;
+static esp_timer_handle_t g_timer = NULL;
+static bool g_timer_running = false;
+
+static bool alerts_compile_term(const char *text, size_t len, alerts_term_t *term) {
+    size_t pos = 0;
+    while (pos < len && (islower((unsigned char)text[pos]) || text[pos] == '_')) pos++;
+
+    int field = -1;
+    for (int f = 0; f < ALERTS_FIELD_MAX; f++) {
+        if (strlen(g_field_names[f]) == pos && strncmp(text, g_field_names[f], pos) == 0) field = f;
+    }
+    if (field < 0) return false;
+
+    int op = -1;
+    for (size_t i = 0; i < sizeof(g_ops) / sizeof(g_ops[0]); i++) {
+        const size_t op_len = strlen(g_ops[i].text);
+        if (pos + op_len <= len && strncmp(text + pos, g_ops[i].text, op_len) == 0) {
+            op = g_ops[i].op;
+            pos += op_len;
+            break;
+        }
+    }
+    if (op < 0 || pos == len) return false;
+
+    char value[16];
+    if (len - pos >= sizeof(value)) return false;
+    memcpy(value, text + pos, len - pos);
+    value[len - pos] = '\0';
+
+    term->field = (uint8_t)field;
+    term->op = (uint8_t)op;
+    if (field == ALERTS_FIELD_TREND) {
+        if (op != ALERTS_OP_EQ) return false;
+        for (int t = STORM_TRACKER_TREND_UNKNOWN; t <= STORM_TRACKER_TREND_RECEDING; t++) {
+            if (strcmp(value, storm_tracker_trend_name((storm_tracker_trend_t)t)) == 0) {
+                term->value = (float)t;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    char *end = NULL;
+    term->value = strtof(value, &end);
+    return end && *end == '\0' && isfinite(term->value);
+}
+
+/**
+ * @brief Compiles rule text into table
+ * @return NULL on success, otherwise a static error message
+ */
+static const char *alerts_compile(const char *source, alerts_table_t *table) {
+    memset(table, 0, sizeof(*table));
+    if (strlen(source) >= ALERTS_SOURCE_MAX) return "rules too long";
+
+    // whitespace carries no meaning, drop it so the parser never sees any
+    char text[ALERTS_SOURCE_MAX];
+    size_t len = 0;
+    for (const char *c = source; *c; c++) {
+        if (!isspace((unsigned char)*c)) text[len++] = *c;
+    }
+    text[len] = '\0';
+
+    for (const char *rule = text; *rule; ) {
+        const char *end = strchr(rule, ';');
+        if (!end) end = rule + strlen(rule);
+        if (end == rule) {
+            rule++;
+            continue;
+        }
+        if (table->rule_count == ALERTS_RULES_MAX) return "too many rules";
+
+        const char *colon = memchr(rule, ':', end - rule);
+        if (!colon || colon == rule) return "rule needs name:condition";
+        if (colon - rule >= ALERTS_NAME_MAX) return "rule name too long";
+        for (const char *c = rule; c < colon; c++) {
+            // names go into JSON and topics unescaped
+            if (!isalnum((unsigned char)*c) && *c != '_' && *c != '-') return "rule name may only hold A-Z, a-z, 0-9, _ and -";
+        }
+        if (end - colon - 1 >= ALERTS_CONDITION_MAX) return "condition too long";
+
+        alerts_rule_t *r = &table->rules[table->rule_count];
+        memcpy(r->name, rule, colon - rule);
+        memcpy(r->condition, colon + 1, end - colon - 1);
+        r->first_term = table->term_count;
+
+        for (const char *term = colon + 1; term <= end; ) {
+            const char *term_end = memchr(term, '&', end - term);
+            if (!term_end) term_end = end;
+            if (table->term_count == ALERTS_TERMS_MAX) return "too many terms";
+            if (!alerts_compile_term(term, term_end - term, &table->terms[table->term_count])) {
+                return "bad condition, expected <field><op><value>";
+            }
+            table->term_count++;
+            r->term_count++;
+            term = term_end + 1;
+        }
+
+        table->rule_count++;
+        rule = *end ? end + 1 : end;
+    }
+
+    return NULL;
+}
+
+static bool alerts_compare(const alerts_term_t *term, float value) {
+    switch (term->op) {
+        case ALERTS_OP_LT:
+            return value < term->value;
+        case ALERTS_OP_LE:
+            return value <= term->value;
+        case ALERTS_OP_GT:
+            return value > term->value;
+        case ALERTS_OP_GE:
+            return value >= term->value;
+        default:
+            return value == term->value;
+    }
+}
+
+/**
+ * @brief Reads the rule setting and swaps in the compiled table; rule state starts over
+ */
+static void alerts_load(void) {
+    alerts_table_t *table = malloc(sizeof(*table));
+    if (!table) {
+        ESP_LOGE(TAG, "No memory to compile alert rules");
+        return;
+    }
+
+    const settings_snapshot_t *snap = settings_snapshot_acquire();
+    const char *source = settings_snapshot_get_str(snap, ALERTS_SETTINGS_NS, ALERTS_SETTINGS_KEY);
+    const bool from_settings = source != NULL;
+    const char *error = alerts_compile(from_settings ? source : ALERTS_DEFAULT_RULES, table);
+    settings_snapshot_release(snap);
+
+    if (error) {
+        ESP_LOGW(TAG, "Stored alert rules rejected (%s), using defaults", error);
+        alerts_compile(ALERTS_DEFAULT_RULES, table);
+    }
+
+    taskENTER_CRITICAL(&g_lock);
+    g_table = *table;
+    memset(g_active, 0, sizeof(g_active));
+    memset(g_raised, 0, sizeof(g_raised));
+    g_from_settings = from_settings && !error;
+    g_error = error;
+    taskEXIT_CRITICAL(&g_lock);
+
+    ESP_LOGI(TAG, "%u alert rules loaded from %s", table->rule_count, from_settings && !error ? "settings" : "defaults");
+    free(table);
+}
+
+static void alerts_rules_changed(const char *ns, const char *key, void *arg) {
+    alerts_load();
+    alerts_evaluate();
+}
+
+static void alerts_tick(void *arg) {
+    alerts_evaluate();
+}
+
+static void alerts_publish(const alerts_change_t *change, const storm_tracker_summary_t *storm, int64_t now_us) {
+    char min_km[8] = "null";
+    if (storm->ranged) snprintf(min_km, sizeof(min_km), "%u", storm->min_km);
+
+    char payload[384];
+    snprintf(payload, sizeof(payload),
+        "{\"event\":\"alert\",\"rule\":\"%s\",\"state\":\"%s\",\"condition\":\"%s\","
+        "\"storm\":\"%s\",\"trend\":\"%s\",\"strikes\":%lu,\"rate_per_min\":%.2f,\"min_km\":%s,"
+        "\"irq_timestamp_us\":%lld,\"epoch_us\":%lld}",
+        change->name, change->raised ? "raised" : "cleared", change->condition,
+        storm_tracker_state_name(storm->state), storm_tracker_trend_name(storm->trend),
+        (unsigned long)storm->strikes, storm->rate_per_min, min_km,
+        (long long)now_us, (long long)event_pipeline_timestamp_to_epoch_us(now_us));
+
+    const esp_err_t err = event_pipeline_publish("alert", "alert", payload, false);
+    taskENTER_CRITICAL(&g_lock);
+    if (err == ESP_OK) {
+        g_published++;
+    } else {
+        g_dropped++;
+    }
+    taskEXIT_CRITICAL(&g_lock);
+
+    ESP_LOGI(TAG, "Alert %s %s (%s)", change->name, change->raised ? "raised" : "cleared", change->condition);
+}
+
+void alerts_evaluate(void) {
+    if (!g_timer) return;
+
+    storm_tracker_summary_t storm;
+    storm_tracker_get_summary(&storm);
+    const int64_t now_us = esp_timer_get_time();
+
+    // every field once, then the flat term table only indexes into them
+    float values[ALERTS_FIELD_MAX] = { 0 };
+    uint32_t valid = (1u << ALERTS_FIELD_RATE) | (1u << ALERTS_FIELD_STRIKES) | (1u << ALERTS_FIELD_TREND);
+    values[ALERTS_FIELD_DISTANCE] = storm.min_km;
+    values[ALERTS_FIELD_RATE] = storm.rate_per_min;
+    values[ALERTS_FIELD_STRIKES] = (float)storm.strikes;
+    values[ALERTS_FIELD_TREND] = (float)storm.trend;
+    if (storm.ranged) valid |= 1u << ALERTS_FIELD_DISTANCE;
+    if (storm.last_strike_us) {
+        values[ALERTS_FIELD_CLEAR] = (float)((now_us - storm.last_strike_us) / 60000000.0);
+        valid |= 1u << ALERTS_FIELD_CLEAR;
+    }
+
+    alerts_change_t changes[ALERTS_RULES_MAX];
+    int change_count = 0;
+    bool clear_pending = false;     // a rule waits for time to pass since the last strike
+
+    taskENTER_CRITICAL(&g_lock);
+    g_evaluations++;
+    for (int i = 0; i < g_table.rule_count; i++) {
+        const alerts_rule_t *rule = &g_table.rules[i];
+        bool match = rule->term_count > 0;
+        bool uses_clear = false;
+        for (int t = rule->first_term; t < rule->first_term + rule->term_count; t++) {
+            const alerts_term_t *term = &g_table.terms[t];
+            uses_clear |= term->field == ALERTS_FIELD_CLEAR;
+            match = match && (valid & (1u << term->field)) && alerts_compare(term, values[term->field]);
+        }
+
+        if (!match && uses_clear) clear_pending = true;
+        if (match == g_active[i]) continue;
+
+        g_active[i] = match;
+        if (match) g_raised[i]++;
+        alerts_change_t *change = &changes[change_count++];
+        strlcpy(change->name, rule->name, sizeof(change->name));
+        strlcpy(change->condition, rule->condition, sizeof(change->condition));
+        change->raised = match;
+    }
+
+    // nothing but a new strike can change a rule once the window is empty and all clear rules fired
+    const bool run_timer = storm.strikes > 0 || (storm.last_strike_us && clear_pending);
+    const bool start_timer = run_timer && !g_timer_running;
+    const bool stop_timer = !run_timer && g_timer_running;
+    g_timer_running = run_timer;
+    taskEXIT_CRITICAL(&g_lock);
+
+    if (start_timer) esp_timer_start_periodic(g_timer, (uint64_t)ALERTS_TICK_MS * 1000);
+    if (stop_timer) esp_timer_stop(g_timer);
+
+    for (int i = 0; i < change_count; i++) {
+        alerts_publish(&changes[i], &storm, now_us);
+    }
+}
+
+esp_err_t alerts_init(void) {
+    if (g_timer) return ESP_OK;
+
+    const esp_timer_create_args_t args = {
+        .callback = alerts_tick,
+        .name = "alerts_tick",
+    };
+    esp_err_t err = esp_timer_create(&args, &g_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create alert timer: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    alerts_load();
+    return settings_subscribe(ALERTS_SETTINGS_NS, ALERTS_SETTINGS_KEY, alerts_rules_changed, NULL);
+}
+
+/**
+ * @brief GET /api/alerts - compiled rules with their current state
+ */
+esp_err_t alerts_get_handler(httpd_req_t *req) {
+    const size_t size = 320 + ALERTS_RULES_MAX * (ALERTS_NAME_MAX + ALERTS_CONDITION_MAX + 64);
+    char *response = malloc(size);
+    alerts_table_t *table = malloc(sizeof(*table));
+    if (!response || !table) {
+        free(response);
+        free(table);
+        return http_reply_json(req, "{\"status\":\"error\",\"msg\":\"malloc_failed\"}");
+    }
+
+    bool active[ALERTS_RULES_MAX];
+    uint32_t raised[ALERTS_RULES_MAX];
+    taskENTER_CRITICAL(&g_lock);
+    *table = g_table;
+    memcpy(active, g_active, sizeof(active));
+    memcpy(raised, g_raised, sizeof(raised));
+    const bool from_settings = g_from_settings;
+    const char *error = g_error;
+    const uint32_t evaluations = g_evaluations;
+    const uint32_t published = g_published;
+    const uint32_t dropped = g_dropped;
+    taskEXIT_CRITICAL(&g_lock);
+
+    int len = snprintf(response, size, "{\"status\":\"ok\",\"source\":\"%s\",\"error\":%s%s%s,\"rules\":[",
+                       from_settings ? "settings" : "default",
+                       error ? "\"" : "", error ? error : "null", error ? "\"" : "");
+    for (int i = 0; i < table->rule_count && len < (int)size; i++) {
+        len += snprintf(response + len, size - len,
+            "%s{\"name\":\"%s\",\"condition\":\"%s\",\"active\":%s,\"raised\":%lu}",
+            i ? "," : "", table->rules[i].name, table->rules[i].condition,
+            active[i] ? "true" : "false", (unsigned long)raised[i]);
+    }
+    if (len < (int)size) {
+        snprintf(response + len, size - len, "],\"evaluations\":%lu,\"published\":%lu,\"dropped\":%lu}",
+                 (unsigned long)evaluations, (unsigned long)published, (unsigned long)dropped);
+    }
+
+    esp_err_t err = http_reply_json(req, response);
+    free(response);
+    free(table);
+    return err;
+}
+
+/**
+ * @brief POST /api/alerts/rules - {"rules":"..."} validates and stores rule text, null restores the defaults
+ */
+esp_err_t alerts_rules_handler(httpd_req_t *req) {
+    int content_len = req->content_len;
+    if (content_len <= 0 || content_len > ALERTS_SOURCE_MAX + 64) { http_helpers_send_400(req); return ESP_FAIL; }
+    char *buf = malloc(content_len + 1);
+    if (!buf) return http_reply_json(req, "{\"status\":\"error\",\"msg\":\"malloc_failed\"}");
+    int ret = httpd_req_recv(req, buf, content_len);
+    if (ret <= 0) { free(buf); http_helpers_send_500(req); return ESP_FAIL; }
+    buf[ret] = '\0';
+
+    cJSON *root = cJSON_Parse(buf);
+    free(buf);
+    if (!root) return http_reply_json(req, "{\"status\":\"error\",\"msg\":\"invalid json\"}");
+
+    const cJSON *rules = cJSON_GetObjectItemCaseSensitive(root, "rules");
+    if (cJSON_IsNull(rules)) {
+        cJSON_Delete(root);
+        settings_erase_key(ALERTS_SETTINGS_NS, ALERTS_SETTINGS_KEY);
+        return http_reply_json(req, "{\"status\":\"ok\",\"source\":\"default\"}");
+    }
+    if (!cJSON_IsString(rules) || !rules->valuestring) {
+        cJSON_Delete(root);
+        return http_reply_json(req, "{\"status\":\"error\",\"msg\":\"rules must be a string or null\"}");
+    }
+
+    alerts_table_t *table = malloc(sizeof(*table));
+    if (!table) {
+        cJSON_Delete(root);
+        return http_reply_json(req, "{\"status\":\"error\",\"msg\":\"malloc_failed\"}");
+    }
+    const char *error = alerts_compile(rules->valuestring, table);
+    const unsigned int rule_count = table->rule_count;
+    free(table);
+
+    char response[128];
+    if (error) {
+        snprintf(response, sizeof(response), "{\"status\":\"error\",\"msg\":\"%s\"}", error);
+    } else if (settings_save_str(ALERTS_SETTINGS_NS, ALERTS_SETTINGS_KEY, rules->valuestring) != ESP_OK) {
+        snprintf(response, sizeof(response), "{\"status\":\"error\",\"msg\":\"save_failed\"}");
+    } else {
+        snprintf(response, sizeof(response), "{\"status\":\"ok\",\"source\":\"settings\",\"rules\":%u}", rule_count);
+    }
+    cJSON_Delete(root);
+    return http_reply_json(req, response);
+}
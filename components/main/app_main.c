@@ -12,6 +12,14 @@
 #include "settings.h"
 #include "app_mqtt.h"
 #include "events.h"
+#include "event_pipeline.h"
+#include "event_history.h"
+#include "event_log.h"
+#include "storm_tracker.h"
+#include "alerts.h"
+#include "event_histogram.h"
+#include "mqtt_outbox.h"
+#include "ha_discovery.h"
 #include "wifi_prov.h"
 #include "web_index.h"
 
@@ -84,6 +92,13 @@ static httpd_uri_t mqtt_clear_uri = {
     .user_ctx = NULL
 };
 
+static httpd_uri_t mqtt_queue_uri = {
+    .uri = "/api/mqtt/queue",
+    .method = HTTP_GET,
+    .handler = mqtt_outbox_stats_handler,
+    .user_ctx = NULL
+};
+
 
 static httpd_uri_t as3935_save_uri = {
     .uri = "/api/as3935/save",
@@ -198,6 +213,105 @@ static httpd_uri_t as3935_registers_all_uri = {
     .user_ctx = NULL
 };
 
+static httpd_uri_t as3935_bus_stats_uri = {
+    .uri = "/api/as3935/bus",
+    .method = HTTP_GET,
+    .handler = as3935_bus_stats_handler,
+    .user_ctx = NULL
+};
+
+static httpd_uri_t as3935_irq_stats_uri = {
+    .uri = "/api/as3935/irq",
+    .method = HTTP_GET,
+    .handler = as3935_irq_stats_handler,
+    .user_ctx = NULL
+};
+
+static httpd_uri_t settings_stats_uri = {
+    .uri = "/api/settings/stats",
+    .method = HTTP_GET,
+    .handler = settings_stats_handler,
+    .user_ctx = NULL
+};
+
+static httpd_uri_t events_clients_uri = {
+    .uri = "/api/events/clients",
+    .method = HTTP_GET,
+    .handler = events_clients_handler,
+    .user_ctx = NULL
+};
+
+static httpd_uri_t event_history_uri = {
+    .uri = "/api/events/history",
+    .method = HTTP_GET,
+    .handler = event_history_handler,
+    .user_ctx = NULL
+};
+
+static httpd_uri_t event_log_export_uri = {
+    .uri = "/api/events/log",
+    .method = HTTP_GET,
+    .handler = event_log_export_handler,
+    .user_ctx = NULL
+};
+
+static httpd_uri_t event_log_stats_uri = {
+    .uri = "/api/events/log/stats",
+    .method = HTTP_GET,
+    .handler = event_log_stats_handler,
+    .user_ctx = NULL
+};
+
+static httpd_uri_t event_histogram_uri = {
+    .uri = "/api/events/histogram",
+    .method = HTTP_GET,
+    .handler = event_histogram_handler,
+    .user_ctx = NULL
+};
+
+static httpd_uri_t storm_uri = {
+    .uri = "/api/storm",
+    .method = HTTP_GET,
+    .handler = storm_tracker_handler,
+    .user_ctx = NULL
+};
+
+static httpd_uri_t alerts_get_uri = {
+    .uri = "/api/alerts",
+    .method = HTTP_GET,
+    .handler = alerts_get_handler,
+    .user_ctx = NULL
+};
+
+static httpd_uri_t alerts_rules_uri = {
+    .uri = "/api/alerts/rules",
+    .method = HTTP_POST,
+    .handler = alerts_rules_handler,
+    .user_ctx = NULL
+};
+
+static httpd_uri_t event_pipeline_stats_uri = {
+    .uri = "/api/events/pipeline",
+    .method = HTTP_GET,
+    .handler = event_pipeline_stats_handler,
+    .user_ctx = NULL
+};
+
+// Whole advanced configuration in one request
+static httpd_uri_t as3935_settings_get_uri = {
+    .uri = "/api/as3935/settings",
+    .method = HTTP_GET,
+    .handler = as3935_settings_handler,
+    .user_ctx = NULL
+};
+
+static httpd_uri_t as3935_settings_put_uri = {
+    .uri = "/api/as3935/settings",
+    .method = HTTP_PUT,
+    .handler = as3935_settings_handler,
+    .user_ctx = NULL
+};
+
 // Advanced Settings Handlers - GET endpoints
 static httpd_uri_t as3935_afe_get_uri = {
     .uri = "/api/as3935/settings/afe",
@@ -293,9 +407,11 @@ static httpd_uri_t as3935_reboot_uri = {
 static httpd_handle_t start_webserver(void)
 {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.max_uri_handlers = 50;  // Increased for advanced settings endpoints
+    config.max_uri_handlers = 64;  // Increased for advanced settings and event endpoints
     config.stack_size = 8192;  // Increase stack size for HTTP handler tasks to avoid overflow with NVS operations
-    config.max_open_sockets = 1;  // Limit to 1 concurrent connection to prevent socket state corruption
+    // Each SSE client keeps its socket open; the split of the lwIP sockets is in events.h
+    _Static_assert(EVENTS_SOCKET_BUDGET <= CONFIG_LWIP_MAX_SOCKETS, "raise CONFIG_LWIP_MAX_SOCKETS or lower EVENTS_MAX_CLIENTS");
+    config.max_open_sockets = EVENTS_OPEN_SOCKETS;
     httpd_handle_t server = NULL;
     if (httpd_start(&server, &config) == ESP_OK) {
         httpd_register_uri_handler(server, &index_uri);
@@ -388,6 +504,16 @@ static void init_task(void *pvParameters)
         ESP_LOGI(TAG, "No MQTT URI configured in NVS");
     }
 
+    // init SSE broadcaster and the event pipeline before the sensor can raise events
+    events_init();
+    mqtt_outbox_init();  // RAM only without the mqttq partition
+    ESP_ERROR_CHECK(event_pipeline_init());
+    event_log_init();  // optional, needs the evlog partition
+    storm_tracker_init();
+    alerts_init();
+    event_histogram_init();
+    ha_discovery_init();  // after the storm tracker, it reads the initial storm state
+
     // Initialize AS3935 with config from NVS
     if (as3935_init_from_nvs()) {
         ESP_LOGI(TAG, "AS3935 initialized from saved config");
@@ -404,6 +530,7 @@ static void init_task(void *pvParameters)
         httpd_register_uri_handler(server, &mqtt_status_uri);
         httpd_register_uri_handler(server, &mqtt_test_uri);
         httpd_register_uri_handler(server, &mqtt_clear_uri);
+        httpd_register_uri_handler(server, &mqtt_queue_uri);
         httpd_register_uri_handler(server, &as3935_save_uri);
         httpd_register_uri_handler(server, &as3935_status_uri);
         httpd_register_uri_handler(server, &as3935_pins_save_uri);
@@ -419,8 +546,12 @@ static void init_task(void *pvParameters)
         httpd_register_uri_handler(server, &as3935_register_read_uri);
         httpd_register_uri_handler(server, &as3935_register_write_uri);
         httpd_register_uri_handler(server, &as3935_registers_all_uri);
+        httpd_register_uri_handler(server, &as3935_bus_stats_uri);
+        httpd_register_uri_handler(server, &as3935_irq_stats_uri);
         httpd_register_uri_handler(server, &as3935_post_uri);
-        // Advanced Settings - register both GET and POST
+        // Advanced Settings - whole configuration, then per-setting GET and POST
+        httpd_register_uri_handler(server, &as3935_settings_get_uri);
+        httpd_register_uri_handler(server, &as3935_settings_put_uri);
         httpd_register_uri_handler(server, &as3935_afe_get_uri);
         httpd_register_uri_handler(server, &as3935_afe_post_uri);
         httpd_register_uri_handler(server, &as3935_noise_level_get_uri);
@@ -436,14 +567,21 @@ static void init_task(void *pvParameters)
         httpd_register_uri_handler(server, &as3935_watchdog_get_uri);
         httpd_register_uri_handler(server, &as3935_watchdog_post_uri);
         httpd_register_uri_handler(server, &as3935_reboot_uri);
+        httpd_register_uri_handler(server, &settings_stats_uri);
         httpd_register_uri_handler(server, &sse_uri);
+        httpd_register_uri_handler(server, &event_pipeline_stats_uri);
+        httpd_register_uri_handler(server, &events_clients_uri);
+        httpd_register_uri_handler(server, &event_history_uri);
+        httpd_register_uri_handler(server, &event_log_export_uri);
+        httpd_register_uri_handler(server, &event_log_stats_uri);
+        httpd_register_uri_handler(server, &event_histogram_uri);
+        httpd_register_uri_handler(server, &storm_uri);
+        httpd_register_uri_handler(server, &alerts_get_uri);
+        httpd_register_uri_handler(server, &alerts_rules_uri);
         // register wildcard redirect for captive portal UX
         httpd_register_uri_handler(server, &captive_redirect_uri);
     }
 
-    // init SSE broadcaster
-    events_init();
-
     ESP_LOGI(TAG, "AS3935 Lightning Monitor started");
 
     // task is done, delete it
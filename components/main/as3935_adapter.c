@@ -18,12 +18,22 @@
 #include "esp_http_server.h"
 #include "http_helpers.h"
 #include "driver/i2c_master.h"
+#include "i2c_arbiter.h"
 #include <ctype.h>
+#include <sys/time.h>
+#include "esp_timer.h"
 #include "cJSON.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "app_mqtt.h"
 #include "events.h"
+#include "event_pipeline.h"
+#include "event_history.h"
+#include "event_log.h"
+#include "storm_tracker.h"
+#include "alerts.h"
+#include "event_histogram.h"
+#include "ha_discovery.h"
 #include "settings.h"
 
 // Include the REAL library header for all types and function declarations
@@ -41,9 +51,7 @@ static esp_err_t as3935_apply_advanced_settings(int afe, int noise_level, int sp
                                                  int min_strikes, bool disturber_enabled, int watchdog);
 
 // I2C and sensor state
-static i2c_master_bus_handle_t g_i2c_bus = NULL;
-static i2c_master_dev_handle_t g_i2c_device = NULL;  // Persistent I2C device handle for non-blocking reads
-static SemaphoreHandle_t g_i2c_mutex = NULL;  // Mutex for thread-safe I2C access
+static i2c_arbiter_handle_t g_i2c_arbiter = NULL;  // Owns the I2C bus, shared with the monitor task
 static as3935_handle_t g_sensor_handle = NULL;  // Library device handle
 static as3935_monitor_handle_t g_monitor_handle = NULL;  // Monitor handle for event loop
 static bool g_initialized = false;
@@ -73,114 +81,90 @@ static esp_err_t as3935_i2c_read_byte_nb(uint8_t reg_addr, uint8_t *value);
 static esp_err_t as3935_i2c_write_byte_nb(uint8_t reg_addr, uint8_t value);
 
 /**
- * @brief AS3935 event handler - processes lightning, disturber, and noise events
+ * @brief AS3935 event handler - hands lightning, disturber, and noise events to the event pipeline
  * 
- * This handler is called by the AS3935 monitor task when events occur.
- * It publishes register status to MQTT and broadcasts via SSE.
+ * This handler is called directly on the AS3935 monitor task when events occur.  It only
+ * appends the event to the history ring, wakes the flash log writer and copies a compact record into the pipeline ring; JSON formatting, MQTT publishing and
+ * the SSE broadcast run on the pipeline's own tasks so a slow broker or browser cannot
+ * delay the next interrupt readout.
  * Device availability is published to MQTT topic 'as3935/availability' as 'online' or 'offline' for OpenHAB/Home Assistant integration.
  */
-static void as3935_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data) {
-    ESP_LOGI(TAG, "[EVENT] AS3935 event received: event_id=%d", (int)event_id);
-    
-    // Cast event data to the monitor base structure
-    as3935_monitor_base_t *monitor_data = (as3935_monitor_base_t *)event_data;
-    
-    // Read current register values for status
-    uint8_t r0 = 0, r1 = 0, r3 = 0, r8 = 0;
-    as3935_i2c_read_byte_nb(0x00, &r0);
-    as3935_i2c_read_byte_nb(0x01, &r1);
-    as3935_i2c_read_byte_nb(0x03, &r3);
-    as3935_i2c_read_byte_nb(0x08, &r8);
-    
-    // Build JSON payload with event data and register status
-    char payload[768];
-    const char *event_type = "unknown";
-    const char *event_description = "Unknown event";
+static void as3935_event_handler(void *handler_args, int32_t event_id, const as3935_monitor_base_t *monitor_data) {
+    // Register status comes from the monitor's single burst read (0x00..0x08) - no bus access here.
+    // Re-reading 0x03 would also return a cleared interrupt source.
+    const event_pipeline_record_t record = {
+        .irq_timestamp_us = monitor_data->irq_timestamp_us,
+        .energy = monitor_data->lightning_energy,
+        .event_id = (uint8_t)event_id,
+        .distance_km = monitor_data->lightning_distance,
+        .r0 = monitor_data->registers[AS3935_REG_00],
+        .r1 = monitor_data->registers[AS3935_REG_01],
+        .r3 = monitor_data->registers[AS3935_REG_03],
+        .r8 = monitor_data->registers[AS3935_REG_08],
+    };
     
+    event_history_record_t history = {
+        .timestamp_us = monitor_data->irq_timestamp_us,
+        .energy = monitor_data->lightning_energy > EVENT_HISTORY_ENERGY_MAX ? EVENT_HISTORY_ENERGY_MAX : monitor_data->lightning_energy,
+        .distance_km = monitor_data->lightning_distance,
+        .r0 = record.r0,
+        .r1 = record.r1,
+        .r3 = record.r3,
+        .r8 = record.r8,
+    };
     switch (event_id) {
         case AS3935_INT_LIGHTNING:
-            event_type = "lightning";
-            event_description = "Lightning Strike Detected";
-            ESP_LOGI(TAG, "[EVENT] Lightning detected! Distance=%d km, Energy=%lu", 
-                     monitor_data->lightning_distance, (unsigned long)monitor_data->lightning_energy);
-            snprintf(payload, sizeof(payload),
-                "{\"event\":\"%s\",\"description\":\"%s\",\"distance_km\":%d,\"distance_description\":\"%s\","
-                "\"energy\":%lu,\"energy_description\":\"%s\","
-                "\"r0\":\"0x%02x\",\"r1\":\"0x%02x\",\"r3\":\"0x%02x\",\"r8\":\"0x%02x\","
-                "\"timestamp\":%u}",
-                event_type, event_description,
-                monitor_data->lightning_distance,
-                monitor_data->lightning_distance > 40 ? "Very Far (>40km)" : 
-                monitor_data->lightning_distance > 20 ? "Far (20-40km)" : 
-                monitor_data->lightning_distance > 10 ? "Moderate (10-20km)" : 
-                monitor_data->lightning_distance > 5 ? "Close (5-10km)" : 
-                "Very Close (<5km)",
-                (unsigned long)monitor_data->lightning_energy,
-                monitor_data->lightning_energy > 1000 ? "Very Strong (>1000)" : 
-                monitor_data->lightning_energy > 500 ? "Strong (500-1000)" : 
-                monitor_data->lightning_energy > 200 ? "Moderate (200-500)" : "Weak (<200)",
-                r0, r1, r3, r8, (unsigned int)esp_log_timestamp());
+            history.type = EVENT_HISTORY_LIGHTNING;
+            break;
+        case AS3935_INT_DISTURBER:
+            history.type = EVENT_HISTORY_DISTURBER;
+            break;
+        case AS3935_INT_NOISE:
+            history.type = EVENT_HISTORY_NOISE;
+            break;
+        default:
+            history.type = EVENT_HISTORY_UNKNOWN;
+            break;
+    }
+    event_history_append(&history);
+    event_log_notify();
+
+    if (event_pipeline_submit(&record) != ESP_OK) {
+        ESP_LOGW(TAG, "[EVENT] Pipeline full, event_id=%d dropped", (int)event_id);
+    }
+}
+
+/**
+ * @brief Pipeline record hook - logs the event, feeds the storm, alert and histogram
+ * statistics and calls the legacy callback off the monitor task
+ */
+static void as3935_pipeline_record_cb(const event_pipeline_record_t *record) {
+    switch (record->event_id) {
+        case AS3935_INT_LIGHTNING:
+            ESP_LOGI(TAG, "[EVENT] Lightning detected! Distance=%d km, Energy=%lu",
+                     record->distance_km, (unsigned long)record->energy);
             break;
-            
         case AS3935_INT_DISTURBER:
-            event_type = "disturber";
-            event_description = "Disturber Detected (non-lightning noise)";
             ESP_LOGI(TAG, "[EVENT] Disturber detected");
-            snprintf(payload, sizeof(payload),
-                "{\"event\":\"%s\",\"description\":\"%s\","
-                "\"r0\":\"0x%02x\",\"r1\":\"0x%02x\",\"r3\":\"0x%02x\",\"r8\":\"0x%02x\","
-                "\"timestamp\":%u}",
-                event_type, event_description, r0, r1, r3, r8, (unsigned int)esp_log_timestamp());
             break;
-            
         case AS3935_INT_NOISE:
-            event_type = "noise";
-            event_description = "Noise Level Too High";
             ESP_LOGI(TAG, "[EVENT] Noise level too high");
-            snprintf(payload, sizeof(payload),
-                "{\"event\":\"%s\",\"description\":\"%s\","
-                "\"r0\":\"0x%02x\",\"r1\":\"0x%02x\",\"r3\":\"0x%02x\",\"r8\":\"0x%02x\","
-                "\"timestamp\":%u}",
-                event_type, event_description, r0, r1, r3, r8, (unsigned int)esp_log_timestamp());
             break;
-            
         default:
-            event_description = "Unknown event type";
-            ESP_LOGI(TAG, "[EVENT] Unknown event type: %d", (int)event_id);
-            snprintf(payload, sizeof(payload),
-                "{\"event\":\"unknown\",\"description\":\"%s\",\"event_id\":%d,"
-                "\"r0\":\"0x%02x\",\"r1\":\"0x%02x\",\"r3\":\"0x%02x\",\"r8\":\"0x%02x\","
-                "\"timestamp\":%u}",
-                event_description, (int)event_id, r0, r1, r3, r8, (unsigned int)esp_log_timestamp());
+            ESP_LOGI(TAG, "[EVENT] Unknown event type: %d", (int)record->event_id);
             break;
     }
     
-    // Load MQTT topic from NVS
-    char topic[256] = "as3935/lightning";  // Default topic
-    settings_load_str("mqtt", "topic", topic, sizeof(topic));
-    
-    // Publish to MQTT if connected
-    if (mqtt_is_connected()) {
-        ESP_LOGI(TAG, "[EVENT] Publishing to MQTT topic '%s': %s", topic, payload);
-        esp_err_t err = mqtt_publish(topic, payload);
-        if (err != ESP_OK) {
-            ESP_LOGW(TAG, "[EVENT] MQTT publish failed: %s", esp_err_to_name(err));
-        }
-    } else {
-        ESP_LOGD(TAG, "[EVENT] MQTT not connected, skipping publish");
+    event_histogram_add(record);
+    if (record->event_id == AS3935_INT_LIGHTNING) {
+        storm_tracker_add_strike(record->irq_timestamp_us, record->distance_km);
+        alerts_evaluate();
     }
-    
-    // Broadcast via SSE for web UI
-    events_broadcast(event_type, payload);
-    ESP_LOGI(TAG, "[EVENT] SSE broadcast sent");
-    
-    // Call legacy callback if registered
-    if (g_event_callback) {
-        ESP_LOGD(TAG, "[EVENT] Calling legacy event callback");
-        // Only call for lightning events with valid data
-        if (event_id == AS3935_INT_LIGHTNING) {
-            g_event_callback(monitor_data->lightning_distance, monitor_data->lightning_energy, esp_log_timestamp());
-        }
+    ha_discovery_record(record);
+
+    // Call legacy callback if registered, only for lightning events with valid data
+    if (g_event_callback && record->event_id == AS3935_INT_LIGHTNING) {
+        g_event_callback(record->distance_km, (int)record->energy, (uint32_t)(record->irq_timestamp_us / 1000));
     }
 }
 
@@ -196,8 +180,8 @@ static void as3935_event_handler(void *handler_args, esp_event_base_t base, int3
  * @return ESP_OK on success, error code otherwise
  */
 static esp_err_t as3935_i2c_read_byte_nb(uint8_t reg_addr, uint8_t *value) {
-    if (!g_i2c_device) {
-        ESP_LOGE(TAG, "[I2C-NB] ERROR: I2C device not initialized");
+    if (!g_sensor_handle) {
+        ESP_LOGE(TAG, "[I2C-NB] ERROR: sensor not initialized");
         return ESP_ERR_INVALID_STATE;
     }
     
@@ -206,30 +190,9 @@ static esp_err_t as3935_i2c_read_byte_nb(uint8_t reg_addr, uint8_t *value) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    if (!g_i2c_mutex) {
-        ESP_LOGE(TAG, "[I2C-NB] ERROR: I2C mutex not initialized");
-        return ESP_ERR_INVALID_STATE;
-    }
-    
-    // Acquire mutex with 5 second timeout to prevent concurrent I2C access
-    // Using long timeout to ensure mutex is available even under load
-    if (xSemaphoreTake(g_i2c_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
-        ESP_LOGE(TAG, "[I2C-NB] ERROR: Failed to acquire I2C mutex (5s timeout)");
-        return ESP_ERR_TIMEOUT;
-    }
-    
-    uint8_t tx_buf = reg_addr;
-    uint8_t rx_buf = 0;
-    
-    // Single I2C transaction - no vTaskDelay, no retry, uses persistent device handle
-    esp_err_t ret = i2c_master_transmit_receive(g_i2c_device, &tx_buf, 1, &rx_buf, 1, 500);
-    
-    if (ret == ESP_OK) {
-        *value = rx_buf;
-    }
-    
-    // Release mutex
-    xSemaphoreGive(g_i2c_mutex);
+    // Single I2C transaction at diagnostic bus priority - no vTaskDelay, no retry.
+    // The library keeps its register shadow in sync with the value read.
+    esp_err_t ret = as3935_read_register(g_sensor_handle, reg_addr, value);
     
     // Log errors only
     if (ret != ESP_OK) {
@@ -250,29 +213,13 @@ static esp_err_t as3935_i2c_read_byte_nb(uint8_t reg_addr, uint8_t *value) {
  * @return ESP_OK on success, error code otherwise
  */
 static esp_err_t as3935_i2c_write_byte_nb(uint8_t reg_addr, uint8_t value) {
-    if (!g_i2c_device) {
-        ESP_LOGE(TAG, "[I2C-NB-WRITE] ERROR: I2C device not initialized");
-        return ESP_ERR_INVALID_STATE;
-    }
-    
-    if (!g_i2c_mutex) {
-        ESP_LOGE(TAG, "[I2C-NB-WRITE] ERROR: I2C mutex not initialized");
+    if (!g_sensor_handle) {
+        ESP_LOGE(TAG, "[I2C-NB-WRITE] ERROR: sensor not initialized");
         return ESP_ERR_INVALID_STATE;
     }
     
-    // Acquire mutex with 5 second timeout to prevent concurrent I2C access
-    if (xSemaphoreTake(g_i2c_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
-        ESP_LOGE(TAG, "[I2C-NB-WRITE] ERROR: Failed to acquire I2C mutex (5s timeout)");
-        return ESP_ERR_TIMEOUT;
-    }
-    
-    uint8_t tx_buf[2] = {reg_addr, value};
-    
-    // Single I2C transaction - no vTaskDelay, no retry, uses persistent device handle
-    esp_err_t ret = i2c_master_transmit(g_i2c_device, tx_buf, 2, 500);
-    
-    // Release mutex
-    xSemaphoreGive(g_i2c_mutex);
+    // Single I2C transaction at diagnostic bus priority, written through to the register shadow
+    esp_err_t ret = as3935_write_register(g_sensor_handle, reg_addr, value);
     
     // Log errors only
     if (ret != ESP_OK) {
@@ -282,6 +229,35 @@ static esp_err_t as3935_i2c_write_byte_nb(uint8_t reg_addr, uint8_t value) {
     return ret;
 }
 
+/**
+ * @brief Lightning distance enumerator to kilometers, 255 when out of range
+ * (same convention as as3935_get_lightning_distance_km)
+ */
+static inline uint8_t as3935_distance_to_km(as3935_lightning_distances_t distance) {
+    return (distance == AS3935_L_DISTANCE_OO_RANGE) ? 255 : (uint8_t)distance;
+}
+
+/**
+ * @brief Snapshot of the library register shadow for read-only HTTP handlers
+ * 
+ * Served from RAM with no I2C traffic. The shadow is kept current by every
+ * register write, every interrupt burst read and a periodic background verify.
+ * 
+ * @param shadow Snapshot output, zeroed when the sensor is not initialized
+ * @return true when the snapshot came from an initialized sensor
+ */
+static bool as3935_shadow_snapshot(as3935_register_shadow_t *shadow) {
+    memset(shadow, 0, sizeof(*shadow));
+    shadow->stale_mask = 0x01ff;
+    shadow->lightning_distance = AS3935_L_DISTANCE_OO_RANGE;
+    
+    if (!g_sensor_handle) {
+        return false;
+    }
+    
+    return as3935_get_register_shadow(g_sensor_handle, shadow) == ESP_OK;
+}
+
 /**
  * @brief Initialize AS3935 adapter with I2C bus configuration
  * Note: The sensor library will be initialized separately via the library's as3935_init function
@@ -295,8 +271,8 @@ bool as3935_adapter_bus_init(const as3935_adapter_config_t *cfg) {
     memcpy(&g_config, cfg, sizeof(as3935_adapter_config_t));
     esp_err_t ret;
     
-    // Create I2C master bus if not already created
-    if (!g_i2c_bus) {
+    // Create I2C master bus (owned by the bus arbiter) if not already created
+    if (!g_i2c_arbiter) {
         i2c_master_bus_config_t i2c_mst_config = {
             .clk_source = I2C_CLK_SRC_DEFAULT,
             .i2c_port = cfg->i2c_port,
@@ -305,7 +281,7 @@ bool as3935_adapter_bus_init(const as3935_adapter_config_t *cfg) {
             .glitch_ignore_cnt = 7,
         };
         
-        ret = i2c_new_master_bus(&i2c_mst_config, &g_i2c_bus);
+        ret = i2c_arbiter_new(&i2c_mst_config, &g_i2c_arbiter);
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "I2C bus creation failed: %s", esp_err_to_name(ret));
             return false;
@@ -313,36 +289,6 @@ bool as3935_adapter_bus_init(const as3935_adapter_config_t *cfg) {
         ESP_LOGI(TAG, "I2C bus created on port %d, sda=%d, scl=%d", cfg->i2c_port, cfg->sda_pin, cfg->scl_pin);
     }
     
-    // Create persistent I2C device handle for non-blocking reads
-    if (!g_i2c_device && g_i2c_bus) {
-        ESP_LOGI(TAG, "[INIT] Creating persistent I2C device handle for addr=0x%02x", cfg->i2c_addr);
-        i2c_device_config_t dev_cfg = {
-            .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-            .device_address = cfg->i2c_addr,
-            .scl_speed_hz = 100000,
-        };
-        
-        ret = i2c_master_bus_add_device(g_i2c_bus, &dev_cfg, &g_i2c_device);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "[INIT] FAILED to create persistent I2C device handle: %s", esp_err_to_name(ret));
-            // Continue anyway, non-blocking reads will fail gracefully
-        } else {
-            ESP_LOGI(TAG, "[INIT] SUCCESS: Persistent I2C device handle created, handle=%p", g_i2c_device);
-        }
-    } else {
-        ESP_LOGI(TAG, "[INIT] Device handle already exists or bus not ready: device=%p, bus=%p", g_i2c_device, g_i2c_bus);
-    }
-    
-    // Create I2C mutex for thread-safe access if not already created
-    if (!g_i2c_mutex) {
-        g_i2c_mutex = xSemaphoreCreateMutex();
-        if (!g_i2c_mutex) {
-            ESP_LOGE(TAG, "[INIT] FAILED to create I2C mutex");
-            return false;
-        }
-        ESP_LOGI(TAG, "[INIT] I2C mutex created for thread-safe I2C operations");
-    }
-    
     // Create cache mutex for thread-safe access to cached settings if not already created
     if (!g_cached_settings_mutex) {
         g_cached_settings_mutex = xSemaphoreCreateMutex();
@@ -369,7 +315,7 @@ bool as3935_adapter_bus_init(const as3935_adapter_config_t *cfg) {
  * This uses as3935_monitor_init which creates the interrupt monitoring task and event loop
  */
 esp_err_t as3935_init_sensor_handle(int i2c_addr, int irq_pin) {
-    if (!g_i2c_bus) {
+    if (!g_i2c_arbiter) {
         ESP_LOGE(TAG, "I2C bus not initialized. Call as3935_adapter_bus_init first.");
         return ESP_ERR_INVALID_STATE;
     }
@@ -394,12 +340,13 @@ esp_err_t as3935_init_sensor_handle(int i2c_addr, int irq_pin) {
         .calibrate_rco = true,
         .disturber_detection_enabled = true,
         .noise_level_threshold = 2,         // Noise level threshold
+        .i2c_arbiter = g_i2c_arbiter,       // Share the bus arbiter so IRQ readouts pre-empt HTTP traffic
     };
     
     // Use as3935_monitor_init instead of as3935_init to enable event monitoring
     // This creates the interrupt monitoring task and event loop that processes GPIO interrupts
     ESP_LOGI(TAG, "Initializing AS3935 monitor with event loop support...");
-    esp_err_t ret = as3935_monitor_init(g_i2c_bus, &lib_config, &g_monitor_handle);
+    esp_err_t ret = as3935_monitor_init(i2c_arbiter_get_bus(g_i2c_arbiter), &lib_config, &g_monitor_handle);
     
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "AS3935 monitor init failed: %s", esp_err_to_name(ret));
@@ -417,7 +364,8 @@ esp_err_t as3935_init_sensor_handle(int i2c_addr, int irq_pin) {
     
     // Register the event handler to receive lightning, disturber, and noise events
     ESP_LOGI(TAG, "Registering AS3935 event handler...");
-    ret = as3935_monitor_add_handler(g_monitor_handle, as3935_event_handler, NULL);
+    event_pipeline_set_record_cb(as3935_pipeline_record_cb);
+    ret = as3935_monitor_add_direct_handler(g_monitor_handle, as3935_event_handler, NULL);
     
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to register event handler: %s", esp_err_to_name(ret));
@@ -815,25 +763,13 @@ esp_err_t as3935_save_advanced_settings_nvs(
     int afe, int noise_level, int spike_rejection, 
     int min_strikes, bool disturber_enabled, int watchdog) {
     
-    nvs_handle_t handle;
-    esp_err_t err = nvs_open(NVS_NAMESPACE_AS3935_CFG, NVS_READWRITE, &handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to open NVS for advanced settings: %s", esp_err_to_name(err));
-        return err;
-    }
-    
-    err = nvs_set_i32(handle, "afe", (int32_t)afe);
-    if (err == ESP_OK) err = nvs_set_i32(handle, "noise_lvl", (int32_t)noise_level);
-    if (err == ESP_OK) err = nvs_set_i32(handle, "spike_rej", (int32_t)spike_rejection);
-    if (err == ESP_OK) err = nvs_set_i32(handle, "min_strikes", (int32_t)min_strikes);
-    if (err == ESP_OK) err = nvs_set_u8(handle, "disturber", disturber_enabled ? 1 : 0);
-    if (err == ESP_OK) err = nvs_set_i32(handle, "watchdog", (int32_t)watchdog);
-    
-    if (err == ESP_OK) {
-        err = nvs_commit(handle);
-    }
-    
-    nvs_close(handle);
+    // Written through the settings service so the in-RAM copy and subscribers stay in sync
+    esp_err_t err = settings_save_i32(NVS_NAMESPACE_AS3935_CFG, "afe", (int32_t)afe);
+    if (err == ESP_OK) err = settings_save_i32(NVS_NAMESPACE_AS3935_CFG, "noise_lvl", (int32_t)noise_level);
+    if (err == ESP_OK) err = settings_save_i32(NVS_NAMESPACE_AS3935_CFG, "spike_rej", (int32_t)spike_rejection);
+    if (err == ESP_OK) err = settings_save_i32(NVS_NAMESPACE_AS3935_CFG, "min_strikes", (int32_t)min_strikes);
+    if (err == ESP_OK) err = settings_save_u8(NVS_NAMESPACE_AS3935_CFG, "disturber", disturber_enabled ? 1 : 0);
+    if (err == ESP_OK) err = settings_save_i32(NVS_NAMESPACE_AS3935_CFG, "watchdog", (int32_t)watchdog);
     
     if (err == ESP_OK) {
         ESP_LOGI(TAG, "Advanced settings saved to NVS");
@@ -859,26 +795,17 @@ esp_err_t as3935_load_advanced_settings_nvs(
     if (disturber_enabled) *disturber_enabled = true;  // Disturber detection ON
     if (watchdog) *watchdog = 2;                // Medium watchdog threshold
     
-    ESP_LOGD(TAG, "[LOAD-NVS] Attempting to read advanced settings from NVS namespace: %s", 
+    ESP_LOGD(TAG, "[LOAD-NVS] Reading advanced settings of namespace '%s' from the settings snapshot", 
              NVS_NAMESPACE_AS3935_CFG);
     
-    nvs_handle_t handle;
-    esp_err_t err = nvs_open(NVS_NAMESPACE_AS3935_CFG, NVS_READONLY, &handle);
-    if (err != ESP_OK) {
-        ESP_LOGD(TAG, "[LOAD-NVS] NVS namespace not found or empty - using defaults: %s", 
-                 esp_err_to_name(err));
-        return ESP_ERR_NVS_NOT_FOUND;  // Not an error, just no saved settings
-    }
-    
-    ESP_LOGI(TAG, "[LOAD-NVS] NVS namespace '%s' opened successfully, reading individual keys...", 
-             NVS_NAMESPACE_AS3935_CFG);
+    // Served from the in-RAM settings snapshot, no flash access
+    const settings_snapshot_t *snap = settings_snapshot_acquire();
     
     int32_t val;
-    uint8_t u8_val;
     int read_count = 0;
     
     // Load AFE
-    if (afe && nvs_get_i32(handle, "afe", &val) == ESP_OK) {
+    if (afe && settings_snapshot_get_i32(snap, NVS_NAMESPACE_AS3935_CFG, "afe", &val) == ESP_OK) {
         *afe = (int)val;
         // Validate AFE: must be 18 (INDOOR) or 14 (OUTDOOR)
         if (*afe != 18 && *afe != 14) {
@@ -893,7 +820,7 @@ esp_err_t as3935_load_advanced_settings_nvs(
     }
     
     // Load Noise Level
-    if (noise_level && nvs_get_i32(handle, "noise_lvl", &val) == ESP_OK) {
+    if (noise_level && settings_snapshot_get_i32(snap, NVS_NAMESPACE_AS3935_CFG, "noise_lvl", &val) == ESP_OK) {
         *noise_level = (int)val;
         // Validate noise level: 0-7
         if (*noise_level < 0 || *noise_level > 7) {
@@ -908,7 +835,7 @@ esp_err_t as3935_load_advanced_settings_nvs(
     }
     
     // Load Spike Rejection
-    if (spike_rejection && nvs_get_i32(handle, "spike_rej", &val) == ESP_OK) {
+    if (spike_rejection && settings_snapshot_get_i32(snap, NVS_NAMESPACE_AS3935_CFG, "spike_rej", &val) == ESP_OK) {
         *spike_rejection = (int)val;
         // Validate spike rejection: 0-15
         if (*spike_rejection < 0 || *spike_rejection > 15) {
@@ -923,7 +850,7 @@ esp_err_t as3935_load_advanced_settings_nvs(
     }
     
     // Load Min Strikes
-    if (min_strikes && nvs_get_i32(handle, "min_strikes", &val) == ESP_OK) {
+    if (min_strikes && settings_snapshot_get_i32(snap, NVS_NAMESPACE_AS3935_CFG, "min_strikes", &val) == ESP_OK) {
         *min_strikes = (int)val;
         // Validate min strikes: 0-3
         if (*min_strikes < 0 || *min_strikes > 3) {
@@ -938,8 +865,8 @@ esp_err_t as3935_load_advanced_settings_nvs(
     }
     
     // Load Disturber Setting
-    if (disturber_enabled && nvs_get_u8(handle, "disturber", &u8_val) == ESP_OK) {
-        *disturber_enabled = (u8_val != 0);
+    if (disturber_enabled && settings_snapshot_get_i32(snap, NVS_NAMESPACE_AS3935_CFG, "disturber", &val) == ESP_OK) {
+        *disturber_enabled = (val != 0);
         ESP_LOGI(TAG, "[LOAD-NVS]   ✓ Disturber Detection = %s from NVS", 
                  *disturber_enabled ? "ENABLED" : "DISABLED");
         read_count++;
@@ -948,7 +875,7 @@ esp_err_t as3935_load_advanced_settings_nvs(
     }
     
     // Load Watchdog
-    if (watchdog && nvs_get_i32(handle, "watchdog", &val) == ESP_OK) {
+    if (watchdog && settings_snapshot_get_i32(snap, NVS_NAMESPACE_AS3935_CFG, "watchdog", &val) == ESP_OK) {
         *watchdog = (int)val;
         // Validate watchdog: 0-10
         if (*watchdog < 0 || *watchdog > 10) {
@@ -962,7 +889,7 @@ esp_err_t as3935_load_advanced_settings_nvs(
         ESP_LOGD(TAG, "[LOAD-NVS]   Watchdog key not found in NVS, using default 2");
     }
     
-    nvs_close(handle);
+    settings_snapshot_release(snap);
     
     if (read_count > 0) {
         ESP_LOGI(TAG, "[LOAD-NVS] Successfully loaded %d settings from NVS namespace '%s'", 
@@ -975,95 +902,96 @@ esp_err_t as3935_load_advanced_settings_nvs(
 }
 
 /**
- * @brief Apply advanced settings to the sensor
+ * @brief Writes the advanced settings to registers 0x00..0x03 in one bus pass
+ * 
+ * The target register values are computed from the shadow, and only the span from the
+ * first to the last register that actually differs is written, as one burst transaction.
+ * Registers 0x00..0x02 the shadow does not hold yet are read once first.  Register 0x03
+ * is never read here: reading it acknowledges a pending interrupt, and the event would be
+ * lost.  Its shadow is primed by the library at init and refreshed by every interrupt
+ * readout; while it is invalid the settings are refused with ESP_ERR_INVALID_STATE.
+ * 
+ * @param first_reg Set to the first register written, may be NULL
+ * @param reg_count Set to the number of registers written (0 when nothing changed), may be NULL
  */
-esp_err_t as3935_apply_advanced_settings(
-    int afe, int noise_level, int spike_rejection,
-    int min_strikes, bool disturber_enabled, int watchdog) {
+static esp_err_t as3935_write_advanced_settings(int afe, int noise_level, int spike_rejection,
+                                                int min_strikes, bool disturber_enabled, int watchdog,
+                                                uint8_t *first_reg, uint8_t *reg_count) {
+    as3935_register_shadow_t shadow;
+    esp_err_t err = as3935_get_register_shadow(g_sensor_handle, &shadow);
+    if (err != ESP_OK) {
+        return err;
+    }
     
-    if (!g_sensor_handle) {
-        ESP_LOGW(TAG, "[APPLY-SETTINGS] Cannot apply settings - sensor not initialized");
+    if (!(shadow.valid_mask & (1u << AS3935_REG_03))) {
+        ESP_LOGW(TAG, "Register 0x03 not in the shadow, not reading it as that clears the interrupt");
         return ESP_ERR_INVALID_STATE;
     }
     
-    ESP_LOGI(TAG, "[APPLY-SETTINGS] Starting application of advanced settings to AS3935...");
-    esp_err_t err = ESP_OK;
-    
-    // Apply AFE (Analog Front End)
-    ESP_LOGI(TAG, "[APPLY-SETTINGS] Applying AFE setting: %d (%s)...", 
-             afe, afe == 18 ? "INDOOR" : "OUTDOOR");
-    as3935_0x00_register_t reg_0x00;
-    err = as3935_get_0x00_register(g_sensor_handle, &reg_0x00);
-    if (err == ESP_OK) {
-        reg_0x00.bits.analog_frontend = (afe & 0x1F);
-        err = as3935_set_0x00_register(g_sensor_handle, reg_0x00);
-        if (err == ESP_OK) {
-            ESP_LOGI(TAG, "[APPLY-SETTINGS] ✓ AFE applied successfully: %d", afe);
+    uint8_t current[4];
+    for (uint8_t reg = 0; reg < 4; reg++) {
+        if (shadow.valid_mask & (1u << reg)) {
+            current[reg] = shadow.registers[reg];
         } else {
-            ESP_LOGE(TAG, "[APPLY-SETTINGS] ✗ AFE failed: %s", esp_err_to_name(err));
+            err = as3935_read_register(g_sensor_handle, reg, &current[reg]);
+            if (err != ESP_OK) {
+                return err;
+            }
         }
-    } else {
-        ESP_LOGE(TAG, "[APPLY-SETTINGS] ✗ Failed to read register 0x00 for AFE: %s", esp_err_to_name(err));
     }
     
-    // Apply Noise Level and Watchdog (both in Register 0x01)
-    ESP_LOGI(TAG, "[APPLY-SETTINGS] Applying Noise Level: %d (0-7)...", noise_level);
-    ESP_LOGI(TAG, "[APPLY-SETTINGS] Applying Watchdog Threshold: %d (0-10)...", watchdog);
-    as3935_0x01_register_t reg_0x01;
-    err = as3935_get_0x01_register(g_sensor_handle, &reg_0x01);
-    if (err == ESP_OK) {
-        reg_0x01.bits.noise_floor_level = (noise_level & 0x07);
-        reg_0x01.bits.watchdog_threshold = (watchdog & 0x0F);
-        err = as3935_set_0x01_register(g_sensor_handle, reg_0x01);
-        if (err == ESP_OK) {
-            ESP_LOGI(TAG, "[APPLY-SETTINGS] ✓ Noise Level applied: %d", noise_level);
-            ESP_LOGI(TAG, "[APPLY-SETTINGS] ✓ Watchdog Threshold applied: %d", watchdog);
-        } else {
-            ESP_LOGE(TAG, "[APPLY-SETTINGS] ✗ Noise/Watchdog failed: %s", esp_err_to_name(err));
+    uint8_t target[4];
+    target[0] = (current[0] & 0xC1) | ((afe & 0x1F) << 1);                              // AFE gain bits 5:1
+    target[1] = (current[1] & 0x80) | ((noise_level & 0x07) << 4) | (watchdog & 0x0F);  // NF_LEV 6:4, WDTH 3:0
+    target[2] = (current[2] & 0xC0) | ((min_strikes & 0x03) << 4) | (spike_rejection & 0x0F);  // MIN_NUM_LIGH 5:4, SREJ 3:0
+    target[3] = disturber_enabled ? (current[3] & 0xDF) : (current[3] | 0x20);          // MASK_DIST bit 5
+    
+    int first = -1;
+    int last = -1;
+    for (int reg = 0; reg < 4; reg++) {
+        if (target[reg] != current[reg]) {
+            if (first < 0) first = reg;
+            last = reg;
         }
-    } else {
-        ESP_LOGE(TAG, "[APPLY-SETTINGS] ✗ Failed to read register 0x01 for Noise/Watchdog: %s", esp_err_to_name(err));
     }
     
-    // Apply Spike Rejection and Min Strikes (both in Register 0x02)
-    ESP_LOGI(TAG, "[APPLY-SETTINGS] Applying Spike Rejection: %d (0-15)...", spike_rejection);
-    ESP_LOGI(TAG, "[APPLY-SETTINGS] Applying Min Lightning Strikes: %d...", min_strikes);
-    as3935_0x02_register_t reg_0x02;
-    err = as3935_get_0x02_register(g_sensor_handle, &reg_0x02);
-    if (err == ESP_OK) {
-        reg_0x02.bits.spike_rejection = (spike_rejection & 0x0F);
-        reg_0x02.bits.min_num_lightning = (min_strikes & 0x03);
-        err = as3935_set_0x02_register(g_sensor_handle, reg_0x02);
-        if (err == ESP_OK) {
-            ESP_LOGI(TAG, "[APPLY-SETTINGS] ✓ Spike Rejection applied: %d", spike_rejection);
-            ESP_LOGI(TAG, "[APPLY-SETTINGS] ✓ Min Lightning Strikes applied: %d", min_strikes);
-        } else {
-            ESP_LOGE(TAG, "[APPLY-SETTINGS] ✗ Spike/MinStrikes failed: %s", esp_err_to_name(err));
-        }
-    } else {
-        ESP_LOGE(TAG, "[APPLY-SETTINGS] ✗ Failed to read register 0x02 for Spike/MinStrikes: %s", esp_err_to_name(err));
+    if (first_reg) *first_reg = first < 0 ? 0 : (uint8_t)first;
+    if (reg_count) *reg_count = first < 0 ? 0 : (uint8_t)(last - first + 1);
+    if (first < 0) {
+        return ESP_OK;
     }
     
-    // Apply Disturber Detection (Register 0x03)
-    ESP_LOGI(TAG, "[APPLY-SETTINGS] Applying Disturber Detection: %s...", 
+    return as3935_write_registers(g_sensor_handle, (uint8_t)first, &target[first], (uint8_t)(last - first + 1));
+}
+
+/**
+ * @brief Apply advanced settings to the sensor
+ */
+esp_err_t as3935_apply_advanced_settings(
+    int afe, int noise_level, int spike_rejection,
+    int min_strikes, bool disturber_enabled, int watchdog) {
+    
+    if (!g_sensor_handle) {
+        ESP_LOGW(TAG, "[APPLY-SETTINGS] Cannot apply settings - sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    ESP_LOGI(TAG, "[APPLY-SETTINGS] Applying AFE=%d (%s), Noise=%d, Watchdog=%d, Spike=%d, MinStrikes=%d, Disturber=%s",
+             afe, afe == 18 ? "INDOOR" : "OUTDOOR", noise_level, watchdog, spike_rejection, min_strikes,
              disturber_enabled ? "ENABLED" : "DISABLED");
-    as3935_0x03_register_t reg_0x03;
-    err = as3935_get_0x03_register(g_sensor_handle, &reg_0x03);
-    if (err == ESP_OK) {
-        reg_0x03.bits.disturber_detection_state = disturber_enabled ? 
-            AS3935_DISTURBER_DETECTION_ENABLED : AS3935_DISTURBER_DETECTION_DISABLED;
-        err = as3935_set_0x03_register(g_sensor_handle, reg_0x03);
-        if (err == ESP_OK) {
-            ESP_LOGI(TAG, "[APPLY-SETTINGS] ✓ Disturber Detection applied: %s", 
-                     disturber_enabled ? "ENABLED" : "DISABLED");
-        } else {
-            ESP_LOGE(TAG, "[APPLY-SETTINGS] ✗ Disturber Detection failed: %s", esp_err_to_name(err));
-        }
+    
+    uint8_t first_reg = 0;
+    uint8_t reg_count = 0;
+    esp_err_t err = as3935_write_advanced_settings(afe, noise_level, spike_rejection, min_strikes,
+                                                   disturber_enabled, watchdog, &first_reg, &reg_count);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "[APPLY-SETTINGS] ✗ Failed to apply settings: %s", esp_err_to_name(err));
+    } else if (reg_count == 0) {
+        ESP_LOGI(TAG, "[APPLY-SETTINGS] ✓ Sensor already configured, no register written");
     } else {
-        ESP_LOGE(TAG, "[APPLY-SETTINGS] ✗ Failed to read register 0x03 for Disturber: %s", esp_err_to_name(err));
+        ESP_LOGI(TAG, "[APPLY-SETTINGS] ✓ Wrote %u register(s) from 0x%02x in one transaction", reg_count, first_reg);
     }
     
-    ESP_LOGI(TAG, "[APPLY-SETTINGS] ====== SETTINGS APPLICATION COMPLETE ======");
     return err;
 }
 
@@ -1121,18 +1049,22 @@ esp_err_t as3935_save_handler(httpd_req_t *req) {
 
 esp_err_t as3935_status_handler(httpd_req_t *req) {
     char buf[1024];
-    bool sensor_ok = g_initialized && (g_i2c_bus != NULL) && (g_sensor_handle != NULL) && (g_monitor_handle != NULL);
+    bool sensor_ok = g_initialized && (g_i2c_arbiter != NULL) && (g_sensor_handle != NULL) && (g_monitor_handle != NULL);
     
     const char *sensor_status = sensor_ok ? "connected" : "disconnected";
     
-    // Read register values using non-blocking I2C reads
-    uint8_t r0 = 0, r1 = 0, r3 = 0, r8 = 0;
+    // Register values come from the register shadow - no I2C traffic per poll
+    as3935_register_shadow_t shadow;
+    as3935_shadow_snapshot(&shadow);
+    const uint8_t r0 = shadow.registers[AS3935_REG_00];
+    const uint8_t r1 = shadow.registers[AS3935_REG_01];
+    const uint8_t r3 = shadow.registers[AS3935_REG_03];
+    const uint8_t r8 = shadow.registers[AS3935_REG_08];
     
-    // Use non-blocking reads to avoid blocking HTTP handler
-    as3935_i2c_read_byte_nb(0x00, &r0);
-    as3935_i2c_read_byte_nb(0x01, &r1);
-    as3935_i2c_read_byte_nb(0x03, &r3);
-    as3935_i2c_read_byte_nb(0x08, &r8);
+    as3935_monitor_irq_stats_t irq_stats = { 0 };
+    if (g_monitor_handle) {
+        as3935_monitor_get_irq_stats(g_monitor_handle, &irq_stats);
+    }
     
     snprintf(buf, sizeof(buf), 
         "{\"initialized\":%s,"
@@ -1147,12 +1079,18 @@ esp_err_t as3935_status_handler(httpd_req_t *req) {
         "\"r0\":\"0x%02x\","
         "\"r1\":\"0x%02x\","
         "\"r3\":\"0x%02x\","
-        "\"r8\":\"0x%02x\"}",
+        "\"r8\":\"0x%02x\","
+        "\"shadow_generation\":%lu,"
+        "\"shadow_stale_mask\":\"0x%03x\","
+        "\"irq_count\":%lu,"
+        "\"irq_overruns\":%lu}",
         g_initialized ? "true" : "false",
         sensor_status,
         (g_sensor_handle != NULL) ? "true" : "false",
         g_config.i2c_port, g_config.sda_pin, g_config.scl_pin, 
-        g_config.irq_pin, g_config.i2c_addr, r0, r0, r1, r3, r8);
+        g_config.irq_pin, g_config.i2c_addr, r0, r0, r1, r3, r8,
+        (unsigned long)shadow.generation, shadow.stale_mask,
+        (unsigned long)irq_stats.irq_count, (unsigned long)irq_stats.irq_overruns);
     return http_reply_json(req, buf);
 }
 
@@ -1231,7 +1169,7 @@ esp_err_t as3935_pins_save_handler(httpd_req_t *req) {
         g_config.scl_pin = scl;
         g_config.irq_pin = irq;
         
-        if (critical_pins_changed && g_i2c_bus != NULL) {
+        if (critical_pins_changed && g_i2c_arbiter != NULL) {
             ESP_LOGW(TAG, "I2C pins changed - device restart required to apply changes!");
             snprintf(buf, sizeof(buf), "{\"status\":\"ok\",\"saved\":true,\"warning\":\"I2C pins require restart to apply\"}");
         } else {
@@ -1332,23 +1270,18 @@ esp_err_t as3935_addr_status_handler(httpd_req_t *req) {
 }
 
 esp_err_t as3935_params_handler(httpd_req_t *req) {
-    // Use non-blocking I2C reads instead of blocking library functions
-    uint8_t reg0 = 0, reg1 = 0, reg2 = 0;
+    // Served from the register shadow - no I2C traffic
+    as3935_register_shadow_t shadow;
+    as3935_shadow_snapshot(&shadow);
+    const uint8_t reg0 = shadow.registers[AS3935_REG_00];
+    const uint8_t reg1 = shadow.registers[AS3935_REG_01];
+    const uint8_t reg2 = shadow.registers[AS3935_REG_02];
     
     char buf[1024];
     
-    // Read the registers using non-blocking I2C
-    as3935_i2c_read_byte_nb(0x00, &reg0);
-    as3935_i2c_read_byte_nb(0x01, &reg1);
-    as3935_i2c_read_byte_nb(0x02, &reg2);
-    
-    // Get lightning distance and energy (these are safe)
-    uint32_t energy = 0;
-    uint8_t distance_km = 0;
-    if (g_sensor_handle) {
-        as3935_get_lightning_energy(g_sensor_handle, &energy);
-        as3935_get_lightning_distance_km(g_sensor_handle, &distance_km);
-    }
+    // Last lightning distance and energy as captured by the interrupt burst read
+    const uint32_t energy = shadow.lightning_energy;
+    const uint8_t distance_km = as3935_distance_to_km(shadow.lightning_distance);
     
     // Extract bit fields from raw register values
     // Reg 0x00 bits: power_state=0, analog_frontend=5:1
@@ -1403,6 +1336,46 @@ esp_err_t as3935_calibrate_apply_handler(httpd_req_t *req) {
     return http_reply_json(req, "{\"status\":\"applied\"}");
 }
 
+int as3935_register_read_command(const char *body, char *out, size_t len) {
+    cJSON *json = cJSON_Parse(body);
+    if (!json) {
+        return snprintf(out, len, "{\"status\":\"error\",\"msg\":\"json_parse_failed\"}");
+    }
+    
+    int reg = -1;
+    const cJSON *item = cJSON_GetObjectItemCaseSensitive(json, "reg");
+    
+    if (item && item->type == cJSON_Number) {
+        reg = item->valueint;
+    }
+    
+    cJSON_Delete(json);
+    
+    if (reg < 0 || reg > 255) {
+        return snprintf(out, len, "{\"status\":\"error\",\"msg\":\"invalid_reg\",\"reg\":%d}", reg);
+    }
+    
+    // Reading 0x03 acknowledges a pending interrupt and would lose the event, serve it from the shadow
+    if (reg == AS3935_REG_03) {
+        as3935_register_shadow_t shadow;
+        if (!as3935_shadow_snapshot(&shadow) || !(shadow.valid_mask & (1u << AS3935_REG_03))) {
+            return snprintf(out, len, "{\"status\":\"error\",\"msg\":\"register_shadow_not_ready\",\"reg\":\"0x03\"}");
+        }
+        return snprintf(out, len, "{\"status\":\"ok\",\"reg\":\"0x03\",\"value\":%d,\"source\":\"shadow\"}",
+                        shadow.registers[AS3935_REG_03]);
+    }
+    
+    // Use non-blocking I2C read instead of library functions
+    uint8_t value = 0;
+    esp_err_t ret_esp = as3935_i2c_read_byte_nb(reg, &value);
+    
+    if (ret_esp != ESP_OK) {
+        return snprintf(out, len, "{\"status\":\"error\",\"msg\":\"read_failed\",\"reg\":\"0x%02x\"}", reg);
+    }
+    
+    return snprintf(out, len, "{\"status\":\"ok\",\"reg\":\"0x%02x\",\"value\":%d}", reg, value);
+}
+
 esp_err_t as3935_register_read_handler(httpd_req_t *req) {
     // Parse JSON POST body: {"reg":0}
     char buf[256];
@@ -1428,39 +1401,8 @@ esp_err_t as3935_register_read_handler(httpd_req_t *req) {
     
     body[content_len] = '\0';
     
-    // Parse JSON
-    cJSON *json = cJSON_Parse(body);
+    as3935_register_read_command(body, buf, sizeof(buf));
     free(body);
-    
-    if (!json) {
-        snprintf(buf, sizeof(buf), "{\"status\":\"error\",\"msg\":\"json_parse_failed\"}");
-        return http_reply_json(req, buf);
-    }
-    
-    int reg = -1;
-    const cJSON *item = cJSON_GetObjectItemCaseSensitive(json, "reg");
-    
-    if (item && item->type == cJSON_Number) {
-        reg = item->valueint;
-    }
-    
-    cJSON_Delete(json);
-    
-    if (reg < 0 || reg > 255) {
-        snprintf(buf, sizeof(buf), "{\"status\":\"error\",\"msg\":\"invalid_reg\",\"reg\":%d}", reg);
-        return http_reply_json(req, buf);
-    }
-    
-    // Use non-blocking I2C read instead of library functions
-    uint8_t value = 0;
-    esp_err_t ret_esp = as3935_i2c_read_byte_nb(reg, &value);
-    
-    if (ret_esp != ESP_OK) {
-        snprintf(buf, sizeof(buf), "{\"status\":\"error\",\"msg\":\"read_failed\",\"reg\":\"0x%02x\"}", reg);
-        return http_reply_json(req, buf);
-    }
-    
-    snprintf(buf, sizeof(buf), "{\"status\":\"ok\",\"reg\":\"0x%02x\",\"value\":%d}", reg, value);
     return http_reply_json(req, buf);
 }
 
@@ -1548,28 +1490,13 @@ esp_err_t as3935_register_write_handler(httpd_req_t *req) {
     return http_reply_json(req, buf);
 }
 
-esp_err_t as3935_registers_all_handler(httpd_req_t *req) {
-    // Use non-blocking I2C reads instead of blocking library functions
-    uint8_t reg0 = 0, reg1 = 0, reg2 = 0, reg3 = 0, reg8 = 0;
-    
-    // Read all registers using non-blocking I2C
-    as3935_i2c_read_byte_nb(0x00, &reg0);
-    as3935_i2c_read_byte_nb(0x01, &reg1);
-    as3935_i2c_read_byte_nb(0x02, &reg2);
-    as3935_i2c_read_byte_nb(0x03, &reg3);
-    as3935_i2c_read_byte_nb(0x08, &reg8);
+int as3935_registers_json(char *out, size_t len) {
+    // Served from the register shadow - no I2C traffic
+    as3935_register_shadow_t shadow;
+    as3935_shadow_snapshot(&shadow);
+    const uint8_t *regs = shadow.registers;
     
-    // Get lightning readings (these are safe as they likely use internal state, not I2C)
-    uint32_t energy = 0;
-    uint8_t distance_km = 0;
-    if (g_sensor_handle) {
-        as3935_get_lightning_energy(g_sensor_handle, &energy);
-        as3935_get_lightning_distance_km(g_sensor_handle, &distance_km);
-    }
-    
-    // Build JSON response
-    char response[1024];
-    snprintf(response, sizeof(response),
+    return snprintf(out, len,
         "{\"status\":\"ok\","
         "\"registers\":{"
             "\"0x00\":%d,"
@@ -1581,10 +1508,98 @@ esp_err_t as3935_registers_all_handler(httpd_req_t *req) {
         "\"sensor_data\":{"
             "\"lightning_energy\":%lu,"
             "\"lightning_distance_km\":%d"
+        "},"
+        "\"shadow\":{"
+            "\"generation\":%lu,"
+            "\"valid_mask\":\"0x%03x\","
+            "\"stale_mask\":\"0x%03x\","
+            "\"verify_count\":%lu,"
+            "\"verify_mismatches\":%lu"
         "}"
         "}",
-        reg0, reg1, reg2, reg3, reg8,
-        (unsigned long)energy, distance_km);
+        regs[AS3935_REG_00], regs[AS3935_REG_01], regs[AS3935_REG_02], regs[AS3935_REG_03], regs[AS3935_REG_08],
+        (unsigned long)shadow.lightning_energy, as3935_distance_to_km(shadow.lightning_distance),
+        (unsigned long)shadow.generation, shadow.valid_mask, shadow.stale_mask,
+        (unsigned long)shadow.verify_count, (unsigned long)shadow.verify_mismatches);
+}
+
+esp_err_t as3935_registers_all_handler(httpd_req_t *req) {
+    char response[1024];
+    as3935_registers_json(response, sizeof(response));
+    return http_reply_json(req, response);
+}
+
+esp_err_t as3935_bus_stats_handler(httpd_req_t *req) {
+    // Per-priority I2C bus arbiter statistics (irq, control, diag)
+    if (!g_i2c_arbiter) {
+        return http_reply_json(req, "{\"status\":\"error\",\"msg\":\"i2c_bus_not_initialized\"}");
+    }
+    
+    char response[768];
+    int len = snprintf(response, sizeof(response), "{\"status\":\"ok\",\"classes\":{");
+    
+    for (int prio = 0; prio < I2C_ARBITER_PRIO_MAX && len < (int)sizeof(response); prio++) {
+        i2c_arbiter_stats_t stats = { 0 };
+        i2c_arbiter_get_stats(g_i2c_arbiter, (i2c_arbiter_priority_t)prio, &stats);
+        
+        uint32_t wait_avg_us = stats.transactions ? (uint32_t)(stats.wait_total_us / stats.transactions) : 0;
+        len += snprintf(response + len, sizeof(response) - len,
+            "%s\"%s\":{"
+                "\"transactions\":%lu,"
+                "\"contended\":%lu,"
+                "\"timeouts\":%lu,"
+                "\"errors\":%lu,"
+                "\"wait_avg_us\":%lu,"
+                "\"wait_max_us\":%lu"
+            "}",
+            prio ? "," : "", i2c_arbiter_priority_name((i2c_arbiter_priority_t)prio),
+            (unsigned long)stats.transactions, (unsigned long)stats.contended,
+            (unsigned long)stats.timeouts, (unsigned long)stats.errors,
+            (unsigned long)wait_avg_us, (unsigned long)stats.wait_max_us);
+    }
+    
+    if (len < (int)sizeof(response)) {
+        snprintf(response + len, sizeof(response) - len, "}}");
+    }
+    
+    return http_reply_json(req, response);
+}
+
+esp_err_t as3935_irq_stats_handler(httpd_req_t *req) {
+    // Interrupt counters and IRQ-to-readout latency histogram from the monitor task
+    if (!g_monitor_handle) {
+        return http_reply_json(req, "{\"status\":\"error\",\"msg\":\"monitor_not_initialized\"}");
+    }
+    
+    as3935_monitor_irq_stats_t stats = { 0 };
+    as3935_monitor_get_irq_stats(g_monitor_handle, &stats);
+    
+    char response[768];
+    int len = snprintf(response, sizeof(response),
+        "{\"status\":\"ok\","
+        "\"irq_count\":%lu,"
+        "\"irq_overruns\":%lu,"
+        "\"irq_merged\":%lu,"
+        "\"readouts\":%lu,"
+        "\"latency_max_us\":%lu,"
+        "\"latency_histogram\":[",
+        (unsigned long)stats.irq_count, (unsigned long)stats.irq_overruns,
+        (unsigned long)stats.irq_merged, (unsigned long)stats.readouts,
+        (unsigned long)stats.latency_max_us);
+    
+    for (int i = 0; i < AS3935_LATENCY_BUCKETS && len < (int)sizeof(response); i++) {
+        if (stats.latency_bucket_le_us[i] == UINT32_MAX) {
+            len += snprintf(response + len, sizeof(response) - len, "%s{\"le_us\":null,\"count\":%lu}",
+                            i ? "," : "", (unsigned long)stats.latency_hist[i]);
+        } else {
+            len += snprintf(response + len, sizeof(response) - len, "%s{\"le_us\":%lu,\"count\":%lu}",
+                            i ? "," : "", (unsigned long)stats.latency_bucket_le_us[i], (unsigned long)stats.latency_hist[i]);
+        }
+    }
+    
+    if (len < (int)sizeof(response)) {
+        snprintf(response + len, sizeof(response) - len, "]}");
+    }
     
     return http_reply_json(req, response);
 }
@@ -1595,12 +1610,13 @@ esp_err_t as3935_post_handler(httpd_req_t *req) {
     
     char buf[1024];
     
-    // Read current register values
-    uint8_t r0 = 0, r1 = 0, r3 = 0, r8 = 0;
-    as3935_i2c_read_byte_nb(0x00, &r0);
-    as3935_i2c_read_byte_nb(0x01, &r1);
-    as3935_i2c_read_byte_nb(0x03, &r3);
-    as3935_i2c_read_byte_nb(0x08, &r8);
+    // Current register values from the register shadow
+    as3935_register_shadow_t shadow;
+    as3935_shadow_snapshot(&shadow);
+    const uint8_t r0 = shadow.registers[AS3935_REG_00];
+    const uint8_t r1 = shadow.registers[AS3935_REG_01];
+    const uint8_t r3 = shadow.registers[AS3935_REG_03];
+    const uint8_t r8 = shadow.registers[AS3935_REG_08];
     
     // Load advanced settings from NVS
     int afe, noise_level, spike_rejection, min_strikes, watchdog;
@@ -1661,16 +1677,13 @@ esp_err_t as3935_get_sensor_energy(uint32_t *energy) {
     if (!energy) return ESP_ERR_INVALID_ARG;
     if (!g_sensor_handle) return ESP_ERR_INVALID_STATE;
     
-    // Use direct non-blocking I2C read instead of library function to avoid vTaskDelay
-    // Library's as3935_get_lightning_energy() calls get_0x04_register() which blocks
-    uint8_t reg_val = 0;
-    esp_err_t err = as3935_i2c_read_byte_nb(0x04, &reg_val);
-    if (err != ESP_OK) {
-        return err;
+    // Last lightning energy (registers 0x04..0x06) from the register shadow - no I2C traffic
+    as3935_register_shadow_t shadow;
+    if (!as3935_shadow_snapshot(&shadow)) {
+        return ESP_ERR_INVALID_STATE;
     }
     
-    // Energy is in the upper nibble of register 0x04
-    *energy = (reg_val >> 4) & 0x0F;
+    *energy = shadow.lightning_energy;
     return ESP_OK;
 }
 
@@ -1678,16 +1691,13 @@ esp_err_t as3935_get_sensor_distance(uint8_t *distance_km) {
     if (!distance_km) return ESP_ERR_INVALID_ARG;
     if (!g_sensor_handle) return ESP_ERR_INVALID_STATE;
     
-    // Use direct non-blocking I2C read instead of library function to avoid vTaskDelay
-    // Library's as3935_get_lightning_distance_km() calls get_0x03_register() which blocks
-    uint8_t reg_val = 0;
-    esp_err_t err = as3935_i2c_read_byte_nb(0x03, &reg_val);
-    if (err != ESP_OK) {
-        return err;
+    // Last lightning distance (register 0x07) from the register shadow - no I2C traffic
+    as3935_register_shadow_t shadow;
+    if (!as3935_shadow_snapshot(&shadow)) {
+        return ESP_ERR_INVALID_STATE;
     }
     
-    // Distance is in the lower nibble of register 0x03
-    *distance_km = reg_val & 0x0F;
+    *distance_km = as3935_distance_to_km(shadow.lightning_distance);
     return ESP_OK;
 }
 
@@ -2216,7 +2226,136 @@ esp_err_t as3935_watchdog_handler(httpd_req_t *req) {
     return http_reply_json(req, buf);
 }
 
+/**
+ * @brief Whole advanced configuration in one request
+ * 
+ * GET returns all six settings.  PUT accepts any subset of them, diffs the result against
+ * the register shadow, writes only the registers that change in a single burst, persists
+ * once through the settings write-behind and returns the applied state.
+ */
+int as3935_settings_command(const char *patch, char *out, size_t len) {
+    int afe, noise_level, spike_rejection, min_strikes, watchdog;
+    bool disturber_enabled;
+    
+    if (as3935_get_cached_advanced_settings(&afe, &noise_level, &spike_rejection,
+                                            &min_strikes, &disturber_enabled, &watchdog) != ESP_OK) {
+        as3935_load_advanced_settings_nvs(&afe, &noise_level, &spike_rejection,
+                                          &min_strikes, &disturber_enabled, &watchdog);
+    }
+    
+    uint8_t first_reg = 0;
+    uint8_t reg_count = 0;
+    
+    if (patch) {
+        if (!g_sensor_handle) {
+            return snprintf(out, len, "{\"status\":\"error\",\"msg\":\"sensor_not_initialized\"}");
+        }
+        
+        cJSON *root = cJSON_Parse(patch);
+        if (!root) {
+            return snprintf(out, len, "{\"status\":\"error\",\"msg\":\"json_parse_failed\"}");
+        }
+        
+        // Fields that are present must be valid; absent fields keep their current value
+        const char *invalid = NULL;
+        const cJSON *item;
+        if ((item = cJSON_GetObjectItemCaseSensitive(root, "afe")) != NULL) {
+            if (!cJSON_IsNumber(item) || (item->valueint != 18 && item->valueint != 14)) invalid = "afe_must_be_18_or_14";
+            else afe = item->valueint;
+        }
+        if ((item = cJSON_GetObjectItemCaseSensitive(root, "noise_level")) != NULL) {
+            if (!cJSON_IsNumber(item) || item->valueint < 0 || item->valueint > 7) invalid = "noise_level_must_be_0_to_7";
+            else noise_level = item->valueint;
+        }
+        if ((item = cJSON_GetObjectItemCaseSensitive(root, "spike_rejection")) != NULL) {
+            if (!cJSON_IsNumber(item) || item->valueint < 0 || item->valueint > 15) invalid = "spike_rejection_must_be_0_to_15";
+            else spike_rejection = item->valueint;
+        }
+        if ((item = cJSON_GetObjectItemCaseSensitive(root, "min_strikes")) != NULL) {
+            if (!cJSON_IsNumber(item) || item->valueint < 0 || item->valueint > 3) invalid = "min_strikes_must_be_0_to_3";
+            else min_strikes = item->valueint;
+        }
+        if ((item = cJSON_GetObjectItemCaseSensitive(root, "disturber_enabled")) != NULL) {
+            if (!cJSON_IsBool(item)) invalid = "disturber_enabled_must_be_boolean";
+            else disturber_enabled = cJSON_IsTrue(item);
+        }
+        if ((item = cJSON_GetObjectItemCaseSensitive(root, "watchdog")) != NULL) {
+            if (!cJSON_IsNumber(item) || item->valueint < 0 || item->valueint > 10) invalid = "watchdog_must_be_0_to_10";
+            else watchdog = item->valueint;
+        }
+        cJSON_Delete(root);
+        
+        if (invalid) {
+            return snprintf(out, len, "{\"status\":\"error\",\"msg\":\"%s\"}", invalid);
+        }
+        
+        esp_err_t err = as3935_write_advanced_settings(afe, noise_level, spike_rejection, min_strikes,
+                                                       disturber_enabled, watchdog, &first_reg, &reg_count);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "[SETTINGS-PUT] Register write failed: %s", esp_err_to_name(err));
+            return snprintf(out, len, "{\"status\":\"error\",\"msg\":\"%s\"}",
+                            err == ESP_ERR_INVALID_STATE ? "register_shadow_not_ready" : "set_failed");
+        }
+        
+        // The sensor runs the new values now, keep the cache in step with it even if the save fails
+        as3935_update_cached_advanced_settings(afe, noise_level, spike_rejection,
+                                               min_strikes, disturber_enabled, watchdog);
+        
+        // One save; the settings write-behind turns it into a single commit of the changed keys
+        err = as3935_save_advanced_settings_nvs(afe, noise_level, spike_rejection,
+                                                min_strikes, disturber_enabled, watchdog);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "[SETTINGS-PUT] Applied but not saved: %s", esp_err_to_name(err));
+            return snprintf(out, len, "{\"status\":\"error\",\"msg\":\"save_failed\",\"error\":\"%s\","
+                            "\"registers_written\":%u}", esp_err_to_name(err), reg_count);
+        }
+        ESP_LOGI(TAG, "[SETTINGS-PUT] Applied, %u register(s) written from 0x%02x", reg_count, first_reg);
+    }
+    
+    return snprintf(out, len,
+        "{\"status\":\"ok\","
+        "\"afe\":%d,\"afe_name\":\"%s\","
+        "\"noise_level\":%d,"
+        "\"spike_rejection\":%d,"
+        "\"min_strikes\":%d,"
+        "\"disturber_enabled\":%s,"
+        "\"watchdog\":%d,"
+        "\"registers_written\":%u,"
+        "\"first_register\":\"0x%02x\"}",
+        afe, afe == 18 ? "INDOOR" : "OUTDOOR", noise_level, spike_rejection, min_strikes,
+        disturber_enabled ? "true" : "false", watchdog, reg_count, first_reg);
+}
+
+esp_err_t as3935_settings_handler(httpd_req_t *req) {
+    char buf[384];
+    
+    if (req->method == HTTP_PUT) {
+        char body[512];
+        if (req->content_len <= 0 || req->content_len >= (int)sizeof(body)) {
+            return http_reply_json(req, "{\"status\":\"error\",\"msg\":\"invalid_content_length\"}");
+        }
+        int received = 0;
+        while (received < req->content_len) {
+            int ret = httpd_req_recv(req, body + received, req->content_len - received);
+            if (ret <= 0) {
+                return http_reply_json(req, "{\"status\":\"error\",\"msg\":\"recv_failed\"}");
+            }
+            received += ret;
+        }
+        body[received] = '\0';
+        
+        as3935_settings_command(body, buf, sizeof(buf));
+        return http_reply_json(req, buf);
+    }
+    
+    as3935_settings_command(NULL, buf, sizeof(buf));
+    return http_reply_json(req, buf);
+}
+
 esp_err_t as3935_reboot_handler(httpd_req_t *req) {
+    // Commit settings still waiting in the write-behind buffer
+    settings_flush();
+    
     // Send OK response before rebooting
     http_reply_json(req, "{\"status\":\"ok\",\"message\":\"Device rebooting...\"}");
     
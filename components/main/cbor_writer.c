@@ -0,0 +1,109 @@
+/**
+ * @file cbor_writer.c
+ * @brief Streaming CBOR (RFC 8949) encoder into a caller buffer
+ */
+
+#include "cbor_writer.h"
+#include <string.h>
+
+#define CBOR_MAJOR_UINT     (0)
+#define CBOR_MAJOR_NINT     (1)
+#define CBOR_MAJOR_BYTES    (2)
+#define CBOR_MAJOR_TEXT     (3)
+#define CBOR_MAJOR_ARRAY    (4)
+#define CBOR_MAJOR_MAP      (5)
+#define CBOR_MAJOR_SIMPLE   (7)
+
+#define CBOR_FALSE          (20)
+#define CBOR_TRUE           (21)
+#define CBOR_NULL           (22)
+
+static void cbor_write(cbor_writer_t *w, const void *data, size_t len) {
+    if (len == 0) return;
+    if (w->overflow || len > w->size - w->len) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+/**
+ * @brief Item head: major type and argument in the shortest form, big endian
+ */
+static void cbor_put_head(cbor_writer_t *w, uint8_t major, uint64_t arg) {
+    uint8_t head[9];
+    size_t n;
+
+    if (arg < 24) {
+        head[0] = (uint8_t)(major << 5 | arg);
+        n = 0;
+    } else if (arg <= UINT8_MAX) {
+        head[0] = (uint8_t)(major << 5 | 24);
+        n = 1;
+    } else if (arg <= UINT16_MAX) {
+        head[0] = (uint8_t)(major << 5 | 25);
+        n = 2;
+    } else if (arg <= UINT32_MAX) {
+        head[0] = (uint8_t)(major << 5 | 26);
+        n = 4;
+    } else {
+        head[0] = (uint8_t)(major << 5 | 27);
+        n = 8;
+    }
+    for (size_t i = 0; i < n; i++) {
+        head[n - i] = (uint8_t)(arg >> (8 * i));
+    }
+    cbor_write(w, head, n + 1);
+}
+
+void cbor_writer_init(cbor_writer_t *w, uint8_t *buf, size_t size) {
+    w->buf = buf;
+    w->size = buf ? size : 0;
+    w->len = 0;
+    w->overflow = false;
+}
+
+void cbor_put_uint(cbor_writer_t *w, uint64_t value) {
+    cbor_put_head(w, CBOR_MAJOR_UINT, value);
+}
+
+void cbor_put_int(cbor_writer_t *w, int64_t value) {
+    if (value >= 0) {
+        cbor_put_head(w, CBOR_MAJOR_UINT, (uint64_t)value);
+    } else {
+        // -1 - n, without overflowing on INT64_MIN
+        cbor_put_head(w, CBOR_MAJOR_NINT, ~(uint64_t)value);
+    }
+}
+
+void cbor_put_bytes(cbor_writer_t *w, const void *data, size_t len) {
+    cbor_put_head(w, CBOR_MAJOR_BYTES, len);
+    cbor_write(w, data, len);
+}
+
+void cbor_put_text(cbor_writer_t *w, const char *text) {
+    const size_t len = text ? strlen(text) : 0;
+    cbor_put_head(w, CBOR_MAJOR_TEXT, len);
+    cbor_write(w, text, len);
+}
+
+void cbor_put_bool(cbor_writer_t *w, bool value) {
+    cbor_put_head(w, CBOR_MAJOR_SIMPLE, value ? CBOR_TRUE : CBOR_FALSE);
+}
+
+void cbor_put_null(cbor_writer_t *w) {
+    cbor_put_head(w, CBOR_MAJOR_SIMPLE, CBOR_NULL);
+}
+
+void cbor_put_array(cbor_writer_t *w, size_t count) {
+    cbor_put_head(w, CBOR_MAJOR_ARRAY, count);
+}
+
+void cbor_put_map(cbor_writer_t *w, size_t count) {
+    cbor_put_head(w, CBOR_MAJOR_MAP, count);
+}
+
+size_t cbor_writer_finish(const cbor_writer_t *w) {
+    return w->overflow ? 0 : w->len;
+}
@@ -0,0 +1,238 @@
+/**
+ * @file event_histogram.c
+ * @brief Rolling 1 h / 24 h distributions of AS3935 events
+ */
+
+#include "event_histogram.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_http_server.h"
+#include "freertos/FreeRTOS.h"
+#include "http_helpers.h"
+#include "../esp_as3935/include/as3935.h"
+
+static const char *TAG = "event_histogram";
+
+#define EVENT_HISTOGRAM_ENERGY_MAX  (0x1FFFFF)  // 21-bit energy register value
+#define EVENT_HISTOGRAM_COUNT_MAX   (0xFFFF)
+
+// distance estimates the AS3935 reports, km; out of range (0x3f) is the last bucket
+static const uint8_t g_distances[EVENT_HISTOGRAM_DISTANCE_BUCKETS] = {
+    0x01, 0x05, 0x06, 0x08, 0x0A, 0x0C, 0x0E, 0x11, 0x14, 0x18, 0x1B, 0x1F, 0x22, 0x25, 0x28, 0x3F
+};
+
+/**
+ * @brief Counts of one time slice; 16-bit counters saturate
+ */
+typedef struct {
+    uint32_t slot;      // slice number since boot this entry holds
+    uint16_t lightning;
+    uint16_t disturber;
+    uint16_t noise;
+    uint16_t energy[EVENT_HISTOGRAM_ENERGY_BUCKETS];
+    uint16_t distance[EVENT_HISTOGRAM_DISTANCE_BUCKETS];
+} event_histogram_slice_t;
+
+static event_histogram_slice_t g_slices_1h[12];
+static event_histogram_slice_t g_slices_24h[24];
+
+static const struct {
+    const char *name;
+    event_histogram_slice_t *slices;
+    uint32_t count;
+    uint32_t slice_s;
+} g_windows[EVENT_HISTOGRAM_WINDOW_MAX] = {
+    [EVENT_HISTOGRAM_1H]  = { "1h",  g_slices_1h,  sizeof(g_slices_1h) / sizeof(g_slices_1h[0]),   300 },
+    [EVENT_HISTOGRAM_24H] = { "24h", g_slices_24h, sizeof(g_slices_24h) / sizeof(g_slices_24h[0]), 3600 },
+};
+
+static portMUX_TYPE g_lock = portMUX_INITIALIZER_UNLOCKED;  // slices and g_summary_armed
+static esp_timer_handle_t g_summary_timer = NULL;
+static bool g_summary_armed = false;
+
+static inline void event_histogram_inc(uint16_t *counter) {
+    if (*counter < EVENT_HISTOGRAM_COUNT_MAX) (*counter)++;
+}
+
+static uint8_t event_histogram_energy_bucket(uint32_t energy) {
+    if (energy > EVENT_HISTOGRAM_ENERGY_MAX) energy = EVENT_HISTOGRAM_ENERGY_MAX;
+    return energy ? (uint8_t)(32 - __builtin_clz(energy)) : 0;
+}
+
+static uint8_t event_histogram_distance_bucket(uint8_t distance_km) {
+    uint8_t bucket = 0;
+    while (bucket < EVENT_HISTOGRAM_DISTANCE_BUCKETS - 1 && g_distances[bucket] < distance_km) bucket++;
+    return bucket;
+}
+
+static int event_histogram_format_counts(char *buf, size_t len, const uint32_t *counts, int n) {
+    int pos = 0;
+    for (int i = 0; i < n && pos < (int)len; i++) {
+        pos += snprintf(buf + pos, len - pos, "%s%lu", i ? "," : "", (unsigned long)counts[i]);
+    }
+    return pos;
+}
+
+/**
+ * @brief One window as a JSON object
+ */
+static int event_histogram_format(event_histogram_window_t window, const event_histogram_t *h, char *buf, size_t len) {
+    char energy[EVENT_HISTOGRAM_ENERGY_BUCKETS * 11];
+    char distance[EVENT_HISTOGRAM_DISTANCE_BUCKETS * 11];
+    event_histogram_format_counts(energy, sizeof(energy), h->energy, EVENT_HISTOGRAM_ENERGY_BUCKETS);
+    event_histogram_format_counts(distance, sizeof(distance), h->distance, EVENT_HISTOGRAM_DISTANCE_BUCKETS);
+
+    return snprintf(buf, len,
+        "{\"window\":\"%s\",\"lightning\":%lu,\"disturber\":%lu,\"noise\":%lu,\"energy\":[%s],\"distance\":[%s]}",
+        event_histogram_window_name(window), (unsigned long)h->lightning, (unsigned long)h->disturber,
+        (unsigned long)h->noise, energy, distance);
+}
+
+/**
+ * @brief Publishes both windows as retained messages; runs on the esp_timer task
+ */
+static void event_histogram_summary(void *arg) {
+    static const char *const topics[EVENT_HISTOGRAM_WINDOW_MAX] = { "histogram/1h", "histogram/24h" };
+
+    taskENTER_CRITICAL(&g_lock);
+    g_summary_armed = false;
+    taskEXIT_CRITICAL(&g_lock);
+
+    for (int w = 0; w < EVENT_HISTOGRAM_WINDOW_MAX; w++) {
+        event_histogram_t h;
+        event_histogram_get((event_histogram_window_t)w, &h);
+
+        char payload[EVENT_PIPELINE_PAYLOAD_MAX];
+        event_histogram_format((event_histogram_window_t)w, &h, payload, sizeof(payload));
+        if (event_pipeline_publish("histogram", topics[w], payload, true) != ESP_OK) {
+            ESP_LOGW(TAG, "%s summary dropped", event_histogram_window_name((event_histogram_window_t)w));
+        }
+    }
+}
+
+esp_err_t event_histogram_init(void) {
+    if (g_summary_timer) return ESP_OK;
+
+    const esp_timer_create_args_t args = {
+        .callback = event_histogram_summary,
+        .name = "hist_summary",
+    };
+    return esp_timer_create(&args, &g_summary_timer);
+}
+
+void event_histogram_add(const event_pipeline_record_t *record) {
+    if (record->event_id != AS3935_INT_LIGHTNING && record->event_id != AS3935_INT_DISTURBER &&
+        record->event_id != AS3935_INT_NOISE) {
+        return;
+    }
+
+    const uint32_t now_s = (uint32_t)(record->irq_timestamp_us / 1000000);
+    const uint8_t energy_bucket = event_histogram_energy_bucket(record->energy);
+    const uint8_t distance_bucket = event_histogram_distance_bucket(record->distance_km);
+
+    taskENTER_CRITICAL(&g_lock);
+    for (int w = 0; w < EVENT_HISTOGRAM_WINDOW_MAX; w++) {
+        const uint32_t slot = now_s / g_windows[w].slice_s;
+        event_histogram_slice_t *slice = &g_windows[w].slices[slot % g_windows[w].count];
+        if (slice->slot != slot) {
+            memset(slice, 0, sizeof(*slice));
+            slice->slot = slot;
+        }
+
+        switch (record->event_id) {
+            case AS3935_INT_LIGHTNING:
+                event_histogram_inc(&slice->lightning);
+                event_histogram_inc(&slice->energy[energy_bucket]);
+                event_histogram_inc(&slice->distance[distance_bucket]);
+                break;
+            case AS3935_INT_DISTURBER:
+                event_histogram_inc(&slice->disturber);
+                break;
+            default:
+                event_histogram_inc(&slice->noise);
+                break;
+        }
+    }
+    const bool arm = g_summary_timer && !g_summary_armed;
+    g_summary_armed |= arm;
+    taskEXIT_CRITICAL(&g_lock);
+
+    if (arm) esp_timer_start_once(g_summary_timer, (uint64_t)EVENT_HISTOGRAM_SUMMARY_MS * 1000);
+}
+
+void event_histogram_get(event_histogram_window_t window, event_histogram_t *out) {
+    if (!out || window >= EVENT_HISTOGRAM_WINDOW_MAX) return;
+
+    memset(out, 0, sizeof(*out));
+    const uint32_t count = g_windows[window].count;
+    const uint32_t now_slot = (uint32_t)(esp_timer_get_time() / 1000000) / g_windows[window].slice_s;
+
+    taskENTER_CRITICAL(&g_lock);
+    for (uint32_t i = 0; i < count; i++) {
+        const event_histogram_slice_t *slice = &g_windows[window].slices[i];
+        if (slice->slot > now_slot || now_slot - slice->slot >= count) continue;
+
+        out->lightning += slice->lightning;
+        out->disturber += slice->disturber;
+        out->noise += slice->noise;
+        for (int b = 0; b < EVENT_HISTOGRAM_ENERGY_BUCKETS; b++) out->energy[b] += slice->energy[b];
+        for (int b = 0; b < EVENT_HISTOGRAM_DISTANCE_BUCKETS; b++) out->distance[b] += slice->distance[b];
+    }
+    taskEXIT_CRITICAL(&g_lock);
+}
+
+const char *event_histogram_window_name(event_histogram_window_t window) {
+    return window < EVENT_HISTOGRAM_WINDOW_MAX ? g_windows[window].name : "unknown";
+}
+
+/**
+ * @brief GET /api/events/histogram?window=1h|24h - bucket bounds and the counts of one or both windows
+ */
+esp_err_t event_histogram_handler(httpd_req_t *req) {
+    int only = -1;
+    char query[32];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        char value[8];
+        if (httpd_query_key_value(query, "window", value, sizeof(value)) == ESP_OK) {
+            for (int w = 0; w < EVENT_HISTOGRAM_WINDOW_MAX; w++) {
+                if (strcmp(value, event_histogram_window_name((event_histogram_window_t)w)) == 0) only = w;
+            }
+            if (only < 0) {
+                return http_reply_json(req, "{\"status\":\"error\",\"msg\":\"unknown window\"}");
+            }
+        }
+    }
+
+    const size_t size = 2048;
+    char *response = malloc(size);
+    if (!response) return http_reply_json(req, "{\"status\":\"error\",\"msg\":\"malloc_failed\"}");
+
+    uint32_t bounds[EVENT_HISTOGRAM_ENERGY_BUCKETS];
+    for (int b = 0; b < EVENT_HISTOGRAM_ENERGY_BUCKETS; b++) bounds[b] = b ? 1UL << (b - 1) : 0;
+    uint32_t distances[EVENT_HISTOGRAM_DISTANCE_BUCKETS];
+    for (int b = 0; b < EVENT_HISTOGRAM_DISTANCE_BUCKETS; b++) distances[b] = g_distances[b];
+
+    int len = snprintf(response, size, "{\"status\":\"ok\",\"energy_lower\":[");
+    len += event_histogram_format_counts(response + len, size - len, bounds, EVENT_HISTOGRAM_ENERGY_BUCKETS);
+    len += snprintf(response + len, size - len, "],\"distance_km\":[");
+    len += event_histogram_format_counts(response + len, size - len, distances, EVENT_HISTOGRAM_DISTANCE_BUCKETS);
+    len += snprintf(response + len, size - len, "],\"windows\":[");
+
+    bool first = true;
+    for (int w = 0; w < EVENT_HISTOGRAM_WINDOW_MAX && len < (int)size; w++) {
+        if (only >= 0 && w != only) continue;
+        event_histogram_t h;
+        event_histogram_get((event_histogram_window_t)w, &h);
+        if (!first) response[len++] = ',';
+        first = false;
+        len += event_histogram_format((event_histogram_window_t)w, &h, response + len, size - len);
+    }
+    if (len < (int)size) snprintf(response + len, size - len, "]}");
+
+    esp_err_t err = http_reply_json(req, response);
+    free(response);
+    return err;
+}
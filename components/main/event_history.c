@@ -0,0 +1,160 @@
+/**
+ * @file event_history.c
+ * @brief Fixed-memory history of AS3935 events, written by the monitor task and queried over HTTP
+ */
+
+#include "event_history.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_http_server.h"
+#include "http_helpers.h"
+
+static const char *TAG = "event_history";
+
+#define EVENT_HISTORY_READ_RETRIES  (4)     // attempts to copy a slot the writer keeps changing
+#define EVENT_HISTORY_CHUNK_SIZE    (1024)  // NDJSON bytes sent per chunk
+
+_Static_assert((EVENT_HISTORY_DEPTH & (EVENT_HISTORY_DEPTH - 1)) == 0, "EVENT_HISTORY_DEPTH must be a power of two");
+
+/**
+ * @brief One ring slot; lock is odd while the writer is inside the slot
+ */
+typedef struct {
+    volatile uint32_t lock;
+    event_history_record_t record;
+} event_history_slot_t;
+
+static event_history_slot_t g_slots[EVENT_HISTORY_DEPTH];
+static volatile uint32_t g_last_id = 0;    // written by the single writer only
+
+uint32_t event_history_append(event_history_record_t *record) {
+    const uint32_t id = g_last_id + 1;
+    event_history_slot_t *slot = &g_slots[(id - 1) % EVENT_HISTORY_DEPTH];
+
+    record->id = id;
+    __atomic_store_n(&slot->lock, slot->lock + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->record = *record;
+    __atomic_store_n(&slot->lock, slot->lock + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&g_last_id, id, __ATOMIC_RELEASE);
+
+    return id;
+}
+
+esp_err_t event_history_get(uint32_t id, event_history_record_t *out) {
+    if (!out) return ESP_ERR_INVALID_ARG;
+
+    const uint32_t last_id = __atomic_load_n(&g_last_id, __ATOMIC_ACQUIRE);
+    if (id == 0 || id > last_id || last_id - id >= EVENT_HISTORY_DEPTH) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const event_history_slot_t *slot = &g_slots[(id - 1) % EVENT_HISTORY_DEPTH];
+    for (int attempt = 0; attempt < EVENT_HISTORY_READ_RETRIES; attempt++) {
+        const uint32_t before = __atomic_load_n(&slot->lock, __ATOMIC_ACQUIRE);
+        if (before & 1) continue;
+        *out = slot->record;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->lock, __ATOMIC_RELAXED) == before) {
+            // the slot may already hold a newer record
+            return out->id == id ? ESP_OK : ESP_ERR_NOT_FOUND;
+        }
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+uint32_t event_history_last_id(void) {
+    return __atomic_load_n(&g_last_id, __ATOMIC_ACQUIRE);
+}
+
+const char *event_history_type_name(event_history_type_t type) {
+    switch (type) {
+        case EVENT_HISTORY_LIGHTNING:
+            return "lightning";
+        case EVENT_HISTORY_DISTURBER:
+            return "disturber";
+        case EVENT_HISTORY_NOISE:
+            return "noise";
+        default:
+            return "unknown";
+    }
+}
+
+/**
+ * @brief GET /api/events/history?since=&limit=&type= - streams matching records as NDJSON
+ *
+ * Records are returned oldest first, starting after the id given in since.
+ */
+esp_err_t event_history_handler(httpd_req_t *req) {
+    uint32_t since = 0;
+    uint32_t limit = EVENT_HISTORY_QUERY_LIMIT;
+    int type = -1;
+
+    char query[96];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        char value[16];
+        if (httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK) {
+            since = (uint32_t)strtoul(value, NULL, 10);
+        }
+        if (httpd_query_key_value(query, "limit", value, sizeof(value)) == ESP_OK) {
+            limit = (uint32_t)strtoul(value, NULL, 10);
+            if (limit == 0 || limit > EVENT_HISTORY_DEPTH) limit = EVENT_HISTORY_DEPTH;
+        }
+        if (httpd_query_key_value(query, "type", value, sizeof(value)) == ESP_OK) {
+            for (int t = EVENT_HISTORY_LIGHTNING; t < EVENT_HISTORY_TYPE_MAX; t++) {
+                if (strcmp(value, event_history_type_name((event_history_type_t)t)) == 0) type = t;
+            }
+            if (type < 0) {
+                return http_reply_json(req, "{\"status\":\"error\",\"msg\":\"unknown type\"}");
+            }
+        }
+    }
+
+    const uint32_t last_id = event_history_last_id();
+    uint32_t id = since + 1;
+    if (last_id >= EVENT_HISTORY_DEPTH && id <= last_id - EVENT_HISTORY_DEPTH) {
+        id = last_id - EVENT_HISTORY_DEPTH + 1;
+    }
+
+    char *chunk = malloc(EVENT_HISTORY_CHUNK_SIZE);
+    if (!chunk) return http_reply_json(req, "{\"status\":\"error\",\"msg\":\"malloc_failed\"}");
+
+    httpd_resp_set_type(req, "application/x-ndjson");
+    esp_err_t err = ESP_OK;
+    size_t len = 0;
+    uint32_t sent = 0;
+
+    for (; id <= last_id && sent < limit && err == ESP_OK; id++) {
+        event_history_record_t record;
+        if (event_history_get(id, &record) != ESP_OK) continue;
+        if (type >= 0 && record.type != (uint32_t)type) continue;
+
+        char line[200];
+        const int n = snprintf(line, sizeof(line),
+            "{\"id\":%lu,\"irq_timestamp_us\":%lld,\"type\":\"%s\",\"distance_km\":%u,\"energy\":%lu,"
+            "\"r0\":%u,\"r1\":%u,\"r3\":%u,\"r8\":%u}\n",
+            (unsigned long)record.id, (long long)record.timestamp_us,
+            event_history_type_name((event_history_type_t)record.type), (unsigned int)record.distance_km,
+            (unsigned long)record.energy, record.r0, record.r1, record.r3, record.r8);
+
+        if (len + n > EVENT_HISTORY_CHUNK_SIZE) {
+            err = httpd_resp_send_chunk(req, chunk, len);
+            len = 0;
+        }
+        memcpy(chunk + len, line, n);
+        len += n;
+        sent++;
+    }
+
+    if (err == ESP_OK && len) err = httpd_resp_send_chunk(req, chunk, len);
+    if (err == ESP_OK) err = httpd_resp_send_chunk(req, NULL, 0);
+    free(chunk);
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "History stream aborted after %lu records", (unsigned long)sent);
+    }
+    return err;
+}
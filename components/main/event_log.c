@@ -0,0 +1,739 @@
+/**
+ * @file event_log.c
+ * @brief Persistent append-only log of AS3935 events in the "evlog" data partition
+ */
+
+#include "event_log.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_http_server.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "http_helpers.h"
+#include "event_history.h"
+#include "event_pipeline.h"
+
+static const char *TAG = "event_log";
+
+#define EVENT_LOG_TASK_PRIORITY     (2)
+#define EVENT_LOG_TASK_STACK_SIZE   (4096)
+#define EVENT_LOG_SECTOR_MAGIC      (0x31474C45)    // "ELG1"
+#define EVENT_LOG_BLOCK_MAGIC       (0xB10C)
+#define EVENT_LOG_BLOCK_ERASED      (0xFFFF)
+#define EVENT_LOG_FORMAT_RAW        (0)             // payload is an array of event_log_raw_t
+#define EVENT_LOG_FORMAT_DELTA      (1)             // payload is delta/varint encoded, see event_log_encode()
+#define EVENT_LOG_FLAG_EPOCH        (1 << 0)        // timestamps are Unix time, not time since boot
+#define EVENT_LOG_CHUNK_SIZE        (1024)          // NDJSON bytes sent per chunk
+
+/**
+ * @brief Sector header, written right after the sector is erased
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;           // increases every time a sector is opened, 0 never used
+    uint32_t first_lsn;     // lsn of the first record in the sector
+    uint32_t crc;           // crc32 of the fields above
+} event_log_sector_hdr_t;
+
+/**
+ * @brief Block header; a block is one flash write of up to EVENT_LOG_PAGE_SIZE bytes
+ */
+typedef struct {
+    uint16_t magic;         // EVENT_LOG_BLOCK_MAGIC, EVENT_LOG_BLOCK_ERASED past the last block
+    uint8_t  count;         // records in the block
+    uint8_t  format;        // payload encoding
+    uint16_t len;           // payload bytes
+    uint16_t flags;         // EVENT_LOG_FLAG_*
+    uint32_t first_lsn;     // lsn of the first record in the block
+    uint32_t crc;           // crc32 of the fields above and the payload
+} event_log_block_hdr_t;
+
+/**
+ * @brief Stored record; the lsn is implied by its position in the block
+ */
+typedef struct {
+    int64_t  timestamp_us;
+    uint32_t energy      : 21;
+    uint32_t type        : 3;
+    uint32_t distance_km : 8;
+    uint8_t  r0;
+    uint8_t  r1;
+    uint8_t  r3;
+    uint8_t  r8;
+} event_log_raw_t;
+
+#define EVENT_LOG_BLOCK_PAYLOAD_MAX (EVENT_LOG_PAGE_SIZE - sizeof(event_log_block_hdr_t))
+#define EVENT_LOG_BLOCK_RECORDS     (255)           // block count field is 8 bits
+#define EVENT_LOG_ENCODED_MAX       (24)            // longest encoded record
+
+// Delta format: one head byte per record
+#define EVENT_LOG_HEAD_DISTANCE     (0x0F)          // index into g_distances
+#define EVENT_LOG_HEAD_TYPE_SHIFT   (4)             // 2-bit event_history_type_t
+#define EVENT_LOG_HEAD_REGS         (1 << 6)        // r0, r1, r3, r8 follow, otherwise as before
+#define EVENT_LOG_HEAD_EXT          (1 << 7)        // an extension byte follows the head
+#define EVENT_LOG_EXT_ENERGY        (1 << 0)        // energy follows for a type other than lightning
+#define EVENT_LOG_EXT_DISTANCE      (1 << 1)        // distance byte follows, not in g_distances
+#define EVENT_LOG_EXT_BACKWARDS     (1 << 2)        // timestamp delta is negative (clock stepped back)
+#define EVENT_LOG_TICK_SHIFT        (4)             // timestamps stored in 16 us ticks
+
+_Static_assert(sizeof(event_log_block_hdr_t) == 16, "block header must stay 16 bytes");
+_Static_assert(sizeof(event_log_raw_t) == 16, "stored record must stay 16 bytes");
+
+/**
+ * @brief In-RAM sector index entry, seq 0 when the sector holds no valid header
+ */
+typedef struct {
+    uint32_t seq;
+    uint32_t first_lsn;
+} event_log_sector_t;
+
+static const esp_partition_t *g_part = NULL;
+static SemaphoreHandle_t g_lock = NULL;             // protects everything below
+static TaskHandle_t g_task = NULL;
+static event_log_sector_t g_index[EVENT_LOG_MAX_SECTORS];
+static uint32_t g_sector_count = 0;
+static int g_head = -1;                             // sector being written, -1 before the first write
+static uint32_t g_seq = 0;                          // seq of the head sector
+static uint32_t g_write_offset = EVENT_LOG_SECTOR_SIZE;
+static uint32_t g_next_lsn = 1;
+static uint32_t g_history_next = 1;                 // next event_history id to collect
+
+// block being collected
+static uint8_t g_payload[EVENT_LOG_BLOCK_PAYLOAD_MAX];
+static uint32_t g_payload_len = 0;
+static int64_t g_prev_ticks = 0;                    // encoder state, reset with every block
+static uint8_t g_prev_regs[4];
+static uint32_t g_block_count = 0;
+static uint16_t g_block_flags = 0;
+static TickType_t g_block_first_tick = 0;
+
+static event_log_stats_t g_stats = { 0 };
+
+// AS3935 distance estimates (as3935_lightning_distances_t), stored as a 4-bit index
+static const uint8_t g_distances[16] = {
+    0x01, 0x05, 0x06, 0x08, 0x0A, 0x0C, 0x0E, 0x11, 0x14, 0x18, 0x1B, 0x1F, 0x22, 0x25, 0x28, 0x3F,
+};
+
+// REG0x03 interrupt bits expected for each type; r3 is stored XORed with them so
+// it only changes when the rest of the register does
+static const uint8_t g_type_int_bits[4] = { 0x00, 0x08, 0x04, 0x01 };
+
+/**
+ * @brief Streaming decoder over one block payload, either format
+ */
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    uint8_t  format;
+    int64_t  prev_ticks;
+    uint8_t  regs[4];
+} event_log_decoder_t;
+
+static size_t event_log_put_varint(uint8_t *out, uint64_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+static bool event_log_get_varint(event_log_decoder_t *dec, uint64_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && dec->p < dec->end; shift += 7) {
+        const uint8_t b = *dec->p++;
+        *value |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Encode one record against the previous one in the block
+ *
+ * Head byte: distance index, type, REGS and EXT flags.  Then an extension byte
+ * if EXT, the varint timestamp delta in 16 us ticks (its sign in EXT_BACKWARDS),
+ * the energy varint (lightning, or EXT_ENERGY), the raw distance (EXT_DISTANCE)
+ * and r0, r1, r3 ^ int bits, r8 when they differ from the previous record (REGS).
+ * A noise or disturber event takes 3-4 bytes, a lightning event 6-7.
+ */
+static size_t event_log_encode(const event_log_raw_t *raw, int64_t *prev_ticks, uint8_t prev_regs[4],
+                               bool first, uint8_t *out) {
+    const uint8_t regs[4] = { raw->r0, raw->r1, (uint8_t)(raw->r3 ^ g_type_int_bits[raw->type & 3]), raw->r8 };
+    uint8_t head = (uint8_t)((raw->type & 3) << EVENT_LOG_HEAD_TYPE_SHIFT);
+    uint8_t ext = 0;
+
+    int idx = 0;
+    while (idx < 16 && g_distances[idx] != raw->distance_km) idx++;
+    if (idx < 16) head |= (uint8_t)idx;
+    else ext |= EVENT_LOG_EXT_DISTANCE;
+    if (raw->type != EVENT_HISTORY_LIGHTNING && raw->energy) ext |= EVENT_LOG_EXT_ENERGY;
+    const int64_t ticks = raw->timestamp_us >> EVENT_LOG_TICK_SHIFT;
+    int64_t delta = ticks - *prev_ticks;
+    if (delta < 0) {
+        ext |= EVENT_LOG_EXT_BACKWARDS;
+        delta = -delta;
+    }
+    if (ext) head |= EVENT_LOG_HEAD_EXT;
+    if (first || memcmp(regs, prev_regs, sizeof(regs)) != 0) head |= EVENT_LOG_HEAD_REGS;
+
+    size_t n = 0;
+    out[n++] = head;
+    if (ext) out[n++] = ext;
+    n += event_log_put_varint(out + n, (uint64_t)delta);
+    if (raw->type == EVENT_HISTORY_LIGHTNING || (ext & EVENT_LOG_EXT_ENERGY)) {
+        n += event_log_put_varint(out + n, raw->energy);
+    }
+    if (ext & EVENT_LOG_EXT_DISTANCE) out[n++] = (uint8_t)raw->distance_km;
+    if (head & EVENT_LOG_HEAD_REGS) {
+        memcpy(out + n, regs, sizeof(regs));
+        n += sizeof(regs);
+        memcpy(prev_regs, regs, sizeof(regs));
+    }
+    *prev_ticks = ticks;
+    return n;
+}
+
+static void event_log_decoder_init(event_log_decoder_t *dec, const event_log_block_hdr_t *hdr, const uint8_t *payload) {
+    memset(dec, 0, sizeof(*dec));
+    dec->p = payload;
+    dec->end = payload + hdr->len;
+    dec->format = hdr->format;
+}
+
+/**
+ * @brief Decode the next record, false at the end of the payload or on malformed data
+ */
+static bool event_log_decode_next(event_log_decoder_t *dec, event_log_raw_t *out) {
+    if (dec->format == EVENT_LOG_FORMAT_RAW) {
+        if (dec->end - dec->p < (ptrdiff_t)sizeof(*out)) return false;
+        memcpy(out, dec->p, sizeof(*out));
+        dec->p += sizeof(*out);
+        return true;
+    }
+    if (dec->format != EVENT_LOG_FORMAT_DELTA || dec->p >= dec->end) return false;
+
+    const uint8_t head = *dec->p++;
+    const uint8_t ext = (head & EVENT_LOG_HEAD_EXT) && dec->p < dec->end ? *dec->p++ : 0;
+    const uint8_t type = (head >> EVENT_LOG_HEAD_TYPE_SHIFT) & 3;
+    uint64_t value;
+
+    memset(out, 0, sizeof(*out));
+    out->type = type;
+    if (!event_log_get_varint(dec, &value)) return false;
+    dec->prev_ticks += (ext & EVENT_LOG_EXT_BACKWARDS) ? -(int64_t)value : (int64_t)value;
+    out->timestamp_us = dec->prev_ticks << EVENT_LOG_TICK_SHIFT;
+    if (type == EVENT_HISTORY_LIGHTNING || (ext & EVENT_LOG_EXT_ENERGY)) {
+        if (!event_log_get_varint(dec, &value)) return false;
+        out->energy = (uint32_t)value;
+    }
+    if (ext & EVENT_LOG_EXT_DISTANCE) {
+        if (dec->p >= dec->end) return false;
+        out->distance_km = *dec->p++;
+    } else {
+        out->distance_km = g_distances[head & EVENT_LOG_HEAD_DISTANCE];
+    }
+    if (head & EVENT_LOG_HEAD_REGS) {
+        if (dec->end - dec->p < (ptrdiff_t)sizeof(dec->regs)) return false;
+        memcpy(dec->regs, dec->p, sizeof(dec->regs));
+        dec->p += sizeof(dec->regs);
+    }
+    out->r0 = dec->regs[0];
+    out->r1 = dec->regs[1];
+    out->r3 = dec->regs[2] ^ g_type_int_bits[type];
+    out->r8 = dec->regs[3];
+    return true;
+}
+
+static uint32_t event_log_sector_crc(const event_log_sector_hdr_t *hdr) {
+    return esp_rom_crc32_le(0, (const uint8_t *)hdr, offsetof(event_log_sector_hdr_t, crc));
+}
+
+static uint32_t event_log_block_crc(const event_log_block_hdr_t *hdr, const void *payload) {
+    const uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)hdr, offsetof(event_log_block_hdr_t, crc));
+    return esp_rom_crc32_le(crc, payload, hdr->len);
+}
+
+/**
+ * @brief Oldest sector in the ring, -1 while nothing has been written
+ */
+static int event_log_oldest_sector(void) {
+    if (g_head < 0) return -1;
+
+    // the ring is written in order, so the oldest valid sector follows the head
+    for (uint32_t i = 1; i <= g_sector_count; i++) {
+        const uint32_t idx = (g_head + i) % g_sector_count;
+        if (g_index[idx].seq) return (int)idx;
+    }
+    return g_head;
+}
+
+/**
+ * @brief Erase the sector after the head and make it the new head
+ */
+static esp_err_t event_log_open_sector(void) {
+    const uint32_t idx = g_head < 0 ? 0 : (g_head + 1) % g_sector_count;
+
+    esp_err_t err = esp_partition_erase_range(g_part, idx * EVENT_LOG_SECTOR_SIZE, EVENT_LOG_SECTOR_SIZE);
+    if (err != ESP_OK) return err;
+    g_stats.sector_erases++;
+    g_index[idx].seq = 0;
+
+    event_log_sector_hdr_t hdr = {
+        .magic = EVENT_LOG_SECTOR_MAGIC,
+        .seq = g_seq + 1,
+        .first_lsn = g_next_lsn,
+    };
+    hdr.crc = event_log_sector_crc(&hdr);
+    err = esp_partition_write(g_part, idx * EVENT_LOG_SECTOR_SIZE, &hdr, sizeof(hdr));
+    if (err != ESP_OK) return err;
+
+    g_seq = hdr.seq;
+    g_index[idx].seq = hdr.seq;
+    g_index[idx].first_lsn = hdr.first_lsn;
+    g_head = (int)idx;
+    g_write_offset = sizeof(hdr);
+    return ESP_OK;
+}
+
+/**
+ * @brief Write the collected records as one block (lock held)
+ */
+static esp_err_t event_log_write_block(void) {
+    if (!g_block_count) return ESP_OK;
+
+    static uint8_t page[EVENT_LOG_PAGE_SIZE];
+    event_log_block_hdr_t hdr = {
+        .magic = EVENT_LOG_BLOCK_MAGIC,
+        .count = (uint8_t)g_block_count,
+        .format = EVENT_LOG_FORMAT_DELTA,
+        .len = (uint16_t)g_payload_len,
+        .flags = g_block_flags,
+        .first_lsn = g_next_lsn,
+    };
+    hdr.crc = event_log_block_crc(&hdr, g_payload);
+    memcpy(page, &hdr, sizeof(hdr));
+    memcpy(page + sizeof(hdr), g_payload, hdr.len);
+    const uint32_t len = sizeof(hdr) + hdr.len;
+
+    esp_err_t err = ESP_OK;
+    if (g_write_offset + len > EVENT_LOG_SECTOR_SIZE) {
+        err = event_log_open_sector();
+    }
+    if (err == ESP_OK) {
+        err = esp_partition_write(g_part, g_head * EVENT_LOG_SECTOR_SIZE + g_write_offset, page, len);
+        // a failed write may have left partial data behind, never write over it
+        g_write_offset += len;
+    }
+
+    if (err == ESP_OK) {
+        g_stats.blocks_written++;
+        g_stats.bytes_written += len;
+        g_stats.records_written += g_block_count;
+    } else {
+        ESP_LOGW(TAG, "Block write failed (%s), %lu records lost", esp_err_to_name(err), (unsigned long)g_block_count);
+        g_stats.write_failures++;
+        g_stats.lost += g_block_count;
+    }
+    g_next_lsn += g_block_count;
+    g_block_count = 0;
+    g_payload_len = 0;
+    g_prev_ticks = 0;
+    return err;
+}
+
+/**
+ * @brief Move new history records into the block, writing every block that fills up (lock held)
+ */
+static void event_log_collect(void) {
+    const uint32_t last_id = event_history_last_id();
+    if (last_id >= g_history_next + EVENT_HISTORY_DEPTH) {
+        // the history wrapped before the task got to run
+        g_stats.lost += last_id - EVENT_HISTORY_DEPTH + 1 - g_history_next;
+        g_history_next = last_id - EVENT_HISTORY_DEPTH + 1;
+    }
+
+    for (; g_history_next <= last_id; g_history_next++) {
+        event_history_record_t record;
+        if (event_history_get(g_history_next, &record) != ESP_OK) {
+            g_stats.lost++;
+            continue;
+        }
+
+        const int64_t epoch_us = event_pipeline_timestamp_to_epoch_us(record.timestamp_us);
+        const uint16_t flags = epoch_us ? EVENT_LOG_FLAG_EPOCH : 0;
+        if (g_block_count && flags != g_block_flags) {
+            event_log_write_block();
+        }
+
+        const event_log_raw_t raw = {
+            .timestamp_us = epoch_us ? epoch_us : record.timestamp_us,
+            .energy = record.energy,
+            .type = record.type,
+            .distance_km = record.distance_km,
+            .r0 = record.r0,
+            .r1 = record.r1,
+            .r3 = record.r3,
+            .r8 = record.r8,
+        };
+
+        uint8_t encoded[EVENT_LOG_ENCODED_MAX];
+        int64_t prev_ticks = g_prev_ticks;
+        uint8_t prev_regs[4];
+        memcpy(prev_regs, g_prev_regs, sizeof(prev_regs));
+        size_t n = event_log_encode(&raw, &prev_ticks, prev_regs, g_block_count == 0, encoded);
+        if (g_payload_len + n > EVENT_LOG_BLOCK_PAYLOAD_MAX || g_block_count == EVENT_LOG_BLOCK_RECORDS) {
+            // page full: write it and encode again against an empty block
+            event_log_write_block();
+            prev_ticks = 0;
+            n = event_log_encode(&raw, &prev_ticks, prev_regs, true, encoded);
+        }
+        if (!g_block_count) {
+            g_block_flags = flags;
+            g_block_first_tick = xTaskGetTickCount();
+        }
+
+        memcpy(g_payload + g_payload_len, encoded, n);
+        g_payload_len += n;
+        g_prev_ticks = prev_ticks;
+        memcpy(g_prev_regs, prev_regs, sizeof(prev_regs));
+        g_block_count++;
+    }
+}
+
+/**
+ * @brief Collects on every notification and writes a partly filled block
+ * once it has waited EVENT_LOG_FLUSH_MS
+ */
+static void event_log_task(void *pvParameters) {
+    for (;;) {
+        TickType_t wait = portMAX_DELAY;
+
+        xSemaphoreTake(g_lock, portMAX_DELAY);
+        event_log_collect();
+        if (g_block_count) {
+            const TickType_t age = xTaskGetTickCount() - g_block_first_tick;
+            if (age >= pdMS_TO_TICKS(EVENT_LOG_FLUSH_MS)) {
+                event_log_write_block();
+            } else {
+                wait = pdMS_TO_TICKS(EVENT_LOG_FLUSH_MS) - age;
+            }
+        }
+        xSemaphoreGive(g_lock);
+
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+static void event_log_shutdown_handler(void) {
+    event_log_flush();
+}
+
+/**
+ * @brief Rebuild the sector index from the headers and find the write position in the head sector
+ */
+static void event_log_recover(void) {
+    const int64_t start = esp_timer_get_time();
+    uint32_t reads = 0;
+
+    for (uint32_t idx = 0; idx < g_sector_count; idx++) {
+        event_log_sector_hdr_t hdr;
+        reads++;
+        if (esp_partition_read(g_part, idx * EVENT_LOG_SECTOR_SIZE, &hdr, sizeof(hdr)) != ESP_OK ||
+            hdr.magic != EVENT_LOG_SECTOR_MAGIC || hdr.crc != event_log_sector_crc(&hdr) || hdr.seq == 0) {
+            continue;
+        }
+        g_index[idx].seq = hdr.seq;
+        g_index[idx].first_lsn = hdr.first_lsn;
+        g_stats.sectors_used++;
+        if (hdr.seq > g_seq) {
+            g_seq = hdr.seq;
+            g_head = (int)idx;
+        }
+    }
+
+    if (g_head >= 0) {
+        // walk the block headers of the head sector to the first erased one
+        uint32_t offset = sizeof(event_log_sector_hdr_t);
+        uint32_t lsn = g_index[g_head].first_lsn;
+        static uint8_t payload[EVENT_LOG_BLOCK_PAYLOAD_MAX];
+
+        while (offset + sizeof(event_log_block_hdr_t) <= EVENT_LOG_SECTOR_SIZE) {
+            const uint32_t base = g_head * EVENT_LOG_SECTOR_SIZE + offset;
+            event_log_block_hdr_t hdr;
+            reads++;
+            if (esp_partition_read(g_part, base, &hdr, sizeof(hdr)) != ESP_OK) {
+                offset = EVENT_LOG_SECTOR_SIZE;
+                break;
+            }
+            if (hdr.magic == EVENT_LOG_BLOCK_ERASED) break;
+            if (hdr.magic != EVENT_LOG_BLOCK_MAGIC || hdr.len > EVENT_LOG_BLOCK_PAYLOAD_MAX ||
+                offset + sizeof(hdr) + hdr.len > EVENT_LOG_SECTOR_SIZE) {
+                // unreadable structure: leave the rest of the sector alone
+                g_stats.corrupt_blocks++;
+                offset = EVENT_LOG_SECTOR_SIZE;
+                break;
+            }
+            reads++;
+            if (esp_partition_read(g_part, base + sizeof(hdr), payload, hdr.len) != ESP_OK ||
+                hdr.crc != event_log_block_crc(&hdr, payload)) {
+                // torn write; its records are lost but the lsns stay used
+                g_stats.corrupt_blocks++;
+            }
+            lsn = hdr.first_lsn + hdr.count;
+            offset += sizeof(hdr) + hdr.len;
+        }
+
+        g_write_offset = offset;
+        g_next_lsn = lsn;
+    }
+
+    const int oldest = event_log_oldest_sector();
+    g_stats.first_lsn = oldest >= 0 ? g_index[oldest].first_lsn : g_next_lsn;
+    g_stats.recovery_us = (uint32_t)(esp_timer_get_time() - start);
+    g_stats.recovery_reads = reads;
+}
+
+esp_err_t event_log_init(void) {
+    if (g_task) return ESP_OK;
+
+    g_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, EVENT_LOG_PARTITION_SUBTYPE, EVENT_LOG_PARTITION_LABEL);
+    if (!g_part) {
+        ESP_LOGW(TAG, "No '%s' partition, events will not be persisted", EVENT_LOG_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    g_sector_count = g_part->size / EVENT_LOG_SECTOR_SIZE;
+    if (g_sector_count > EVENT_LOG_MAX_SECTORS) g_sector_count = EVENT_LOG_MAX_SECTORS;
+    if (g_sector_count < 2) return ESP_ERR_INVALID_SIZE;
+    g_stats.sectors = g_sector_count;
+
+    g_lock = xSemaphoreCreateMutex();
+    if (!g_lock) return ESP_ERR_NO_MEM;
+
+    event_log_recover();
+
+    // events already in the history are from this boot and not yet stored
+    g_history_next = 1;
+
+    if (xTaskCreate(event_log_task, "event_log", EVENT_LOG_TASK_STACK_SIZE, NULL,
+                    EVENT_LOG_TASK_PRIORITY, &g_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create event log task");
+        return ESP_ERR_NO_MEM;
+    }
+    esp_register_shutdown_handler(event_log_shutdown_handler);
+
+    ESP_LOGI(TAG, "Event log: %lu/%lu sectors, lsn %lu..%lu, recovered in %lu us (%lu reads)",
+             (unsigned long)g_stats.sectors_used, (unsigned long)g_sector_count,
+             (unsigned long)g_stats.first_lsn, (unsigned long)g_next_lsn,
+             (unsigned long)g_stats.recovery_us, (unsigned long)g_stats.recovery_reads);
+    return ESP_OK;
+}
+
+void event_log_notify(void) {
+    if (g_task) xTaskNotifyGive(g_task);
+}
+
+esp_err_t event_log_flush(void) {
+    if (!g_lock) return ESP_ERR_INVALID_STATE;
+    if (xSemaphoreTake(g_lock, pdMS_TO_TICKS(1000)) != pdTRUE) return ESP_ERR_TIMEOUT;
+
+    event_log_collect();
+    const esp_err_t err = event_log_write_block();
+    xSemaphoreGive(g_lock);
+    return err;
+}
+
+void event_log_get_stats(event_log_stats_t *stats) {
+    if (!stats) return;
+
+    if (!g_lock) {
+        *stats = g_stats;
+        return;
+    }
+
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    *stats = g_stats;
+    const int oldest = event_log_oldest_sector();
+    stats->first_lsn = oldest >= 0 ? g_index[oldest].first_lsn : g_next_lsn;
+    stats->next_lsn = g_next_lsn + g_block_count;
+    stats->pending = g_block_count;
+    stats->sectors_used = 0;
+    for (uint32_t idx = 0; idx < g_sector_count; idx++) {
+        if (g_index[idx].seq) stats->sectors_used++;
+    }
+    xSemaphoreGive(g_lock);
+}
+
+/**
+ * @brief Appends one record to the NDJSON chunk, sending the chunk when it is full
+ */
+static esp_err_t event_log_emit(httpd_req_t *req, char *chunk, size_t *len, uint32_t lsn, uint16_t flags,
+                                const event_log_raw_t *raw) {
+    char line[224];
+    const int n = snprintf(line, sizeof(line),
+        "{\"lsn\":%lu,\"%s\":%lld,\"type\":\"%s\",\"distance_km\":%u,\"energy\":%lu,"
+        "\"r0\":%u,\"r1\":%u,\"r3\":%u,\"r8\":%u}\n",
+        (unsigned long)lsn, (flags & EVENT_LOG_FLAG_EPOCH) ? "epoch_us" : "uptime_us", (long long)raw->timestamp_us,
+        event_history_type_name((event_history_type_t)raw->type), (unsigned int)raw->distance_km,
+        (unsigned long)raw->energy, raw->r0, raw->r1, raw->r3, raw->r8);
+
+    esp_err_t err = ESP_OK;
+    if (*len + n > EVENT_LOG_CHUNK_SIZE) {
+        err = httpd_resp_send_chunk(req, chunk, *len);
+        *len = 0;
+    }
+    memcpy(chunk + *len, line, n);
+    *len += n;
+    return err;
+}
+
+/**
+ * @brief Appends one stored block verbatim to the binary export chunk
+ */
+static esp_err_t event_log_emit_block(httpd_req_t *req, char *chunk, size_t *len, const event_log_block_hdr_t *hdr,
+                                      const uint8_t *payload) {
+    esp_err_t err = ESP_OK;
+    if (*len + sizeof(*hdr) + hdr->len > EVENT_LOG_CHUNK_SIZE) {
+        err = httpd_resp_send_chunk(req, chunk, *len);
+        *len = 0;
+    }
+    memcpy(chunk + *len, hdr, sizeof(*hdr));
+    memcpy(chunk + *len + sizeof(*hdr), payload, hdr->len);
+    *len += sizeof(*hdr) + hdr->len;
+    return err;
+}
+
+/**
+ * @brief GET /api/events/log?since=&limit=&format= - streams stored records, oldest first
+ *
+ * format=ndjson (default) decodes every record; format=bin sends the stored
+ * blocks as they are, for scripts/evlog_decode.py.
+ */
+esp_err_t event_log_export_handler(httpd_req_t *req) {
+    if (!g_lock) return http_reply_json(req, "{\"status\":\"error\",\"msg\":\"event log not available\"}");
+
+    uint32_t since = 0;
+    uint32_t limit = EVENT_LOG_QUERY_LIMIT;
+    bool binary = false;
+    char query[96];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        char value[16];
+        if (httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK) {
+            since = (uint32_t)strtoul(value, NULL, 10);
+        }
+        if (httpd_query_key_value(query, "limit", value, sizeof(value)) == ESP_OK) {
+            limit = (uint32_t)strtoul(value, NULL, 10);
+            if (limit == 0) limit = EVENT_LOG_QUERY_LIMIT;
+        }
+        if (httpd_query_key_value(query, "format", value, sizeof(value)) == ESP_OK) {
+            binary = strcmp(value, "bin") == 0;
+        }
+    }
+
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    int idx = event_log_oldest_sector();
+    const int head = g_head;
+    xSemaphoreGive(g_lock);
+
+    char *chunk = malloc(EVENT_LOG_CHUNK_SIZE);
+    uint8_t *payload = malloc(EVENT_LOG_BLOCK_PAYLOAD_MAX);
+    if (!chunk || !payload) {
+        free(chunk);
+        free(payload);
+        return http_reply_json(req, "{\"status\":\"error\",\"msg\":\"malloc_failed\"}");
+    }
+
+    httpd_resp_set_type(req, binary ? "application/octet-stream" : "application/x-ndjson");
+    esp_err_t err = ESP_OK;
+    size_t len = 0;
+    uint32_t sent = 0;
+
+    // walk the ring from the oldest sector to the head, sector index read under the lock
+    for (uint32_t visited = 0; idx >= 0 && visited < g_sector_count && sent < limit && err == ESP_OK; visited++) {
+        xSemaphoreTake(g_lock, portMAX_DELAY);
+        const event_log_sector_t sector = g_index[idx];
+        const event_log_sector_t next = g_index[(idx + 1) % g_sector_count];
+        xSemaphoreGive(g_lock);
+
+        const bool skip = !sector.seq || (idx != head && next.seq > sector.seq && next.first_lsn <= since + 1);
+        for (uint32_t offset = sizeof(event_log_sector_hdr_t);
+             !skip && offset + sizeof(event_log_block_hdr_t) <= EVENT_LOG_SECTOR_SIZE && sent < limit && err == ESP_OK; ) {
+            const uint32_t base = idx * EVENT_LOG_SECTOR_SIZE + offset;
+            event_log_block_hdr_t hdr;
+            if (esp_partition_read(g_part, base, &hdr, sizeof(hdr)) != ESP_OK ||
+                hdr.magic != EVENT_LOG_BLOCK_MAGIC || hdr.len > EVENT_LOG_BLOCK_PAYLOAD_MAX) {
+                break;
+            }
+            offset += sizeof(hdr) + hdr.len;
+            if (hdr.first_lsn + hdr.count <= since + 1) continue;
+            if (esp_partition_read(g_part, base + sizeof(hdr), payload, hdr.len) != ESP_OK ||
+                hdr.crc != event_log_block_crc(&hdr, payload)) {
+                xSemaphoreTake(g_lock, portMAX_DELAY);
+                g_stats.corrupt_blocks++;
+                xSemaphoreGive(g_lock);
+                continue;
+            }
+
+            if (binary) {
+                // whole blocks; the reader drops records up to since itself
+                err = event_log_emit_block(req, chunk, &len, &hdr, payload);
+                sent += hdr.first_lsn + hdr.count - 1 - (since >= hdr.first_lsn ? since : hdr.first_lsn - 1);
+                continue;
+            }
+
+            event_log_decoder_t dec;
+            event_log_raw_t raw;
+            event_log_decoder_init(&dec, &hdr, payload);
+            for (uint32_t i = 0; i < hdr.count && sent < limit && err == ESP_OK && event_log_decode_next(&dec, &raw); i++) {
+                const uint32_t lsn = hdr.first_lsn + i;
+                if (lsn <= since) continue;
+                err = event_log_emit(req, chunk, &len, lsn, hdr.flags, &raw);
+                sent++;
+            }
+        }
+
+        if (idx == head) break;
+        idx = (idx + 1) % g_sector_count;
+    }
+
+    if (err == ESP_OK && len) err = httpd_resp_send_chunk(req, chunk, len);
+    if (err == ESP_OK) err = httpd_resp_send_chunk(req, NULL, 0);
+    free(chunk);
+    free(payload);
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Export aborted after %lu records", (unsigned long)sent);
+    }
+    return err;
+}
+
+esp_err_t event_log_stats_handler(httpd_req_t *req) {
+    event_log_stats_t stats;
+    event_log_get_stats(&stats);
+
+    char response[512];
+    snprintf(response, sizeof(response),
+        "{\"status\":\"ok\",\"available\":%s,"
+        "\"sectors\":%lu,\"sectors_used\":%lu,\"first_lsn\":%lu,\"next_lsn\":%lu,\"pending\":%lu,"
+        "\"blocks_written\":%lu,\"records_written\":%lu,\"bytes_written\":%lu,\"sector_erases\":%lu,"
+        "\"lost\":%lu,\"write_failures\":%lu,\"corrupt_blocks\":%lu,"
+        "\"recovery_us\":%lu,\"recovery_reads\":%lu}",
+        g_task ? "true" : "false",
+        (unsigned long)stats.sectors, (unsigned long)stats.sectors_used, (unsigned long)stats.first_lsn,
+        (unsigned long)stats.next_lsn, (unsigned long)stats.pending,
+        (unsigned long)stats.blocks_written, (unsigned long)stats.records_written, (unsigned long)stats.bytes_written, (unsigned long)stats.sector_erases,
+        (unsigned long)stats.lost, (unsigned long)stats.write_failures, (unsigned long)stats.corrupt_blocks,
+        (unsigned long)stats.recovery_us, (unsigned long)stats.recovery_reads);
+
+    return http_reply_json(req, response);
+}
@@ -0,0 +1,681 @@
+/**
+ * @file event_pipeline.c
+ * @brief Staged AS3935 event pipeline: monitor task -> SPSC ring -> formatter -> MQTT / SSE workers
+ */
+
+#include "event_pipeline.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_http_server.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "http_helpers.h"
+#include "app_mqtt.h"
+#include "cbor_writer.h"
+#include "mqtt_outbox.h"
+#include "events.h"
+#include "settings.h"
+#include "../esp_as3935/include/as3935.h"
+
+static const char *TAG = "event_pipeline";
+
+#define EVENT_PIPELINE_FORMAT_TASK_PRIORITY     (5)
+#define EVENT_PIPELINE_PUBLISH_TASK_PRIORITY    (4)
+#define EVENT_PIPELINE_TASK_STACK_SIZE          (4096)
+#define EVENT_PIPELINE_OFFLINE_POLL_MS          (1000)  // reconnect check while messages are queued
+#define EVENT_PIPELINE_BATCH_BYTES              (4096)
+#define EVENT_PIPELINE_BATCH_TOPIC              "batch"
+#define EVENT_PIPELINE_CBOR_TOPIC               "cbor"
+
+/**
+ * @brief Formatted event, shared read-only by every publisher stage and
+ * returned to the pool by the last one to release it
+ */
+typedef struct {
+    uint32_t    refs;                               // publisher stages still holding the frame
+    uint32_t    seq;                                // record sequence number, 0 for derived events
+    const char *event_type;                         // SSE event name, static string
+    const char *topic_leaf;                         // MQTT topic under the base topic, NULL for the event topic
+    bool        retain;                             // publish as a retained MQTT message
+    char        payload[EVENT_PIPELINE_PAYLOAD_MAX];
+    uint16_t    cbor_len;                           // CBOR copy for <base>/cbor, 0 for none
+    uint8_t     cbor[EVENT_PIPELINE_CBOR_MAX];
+} event_pipeline_frame_t;
+
+// monitor -> formatter ring; head is written by the producer only, tail by the consumer only
+static event_pipeline_record_t g_ring[EVENT_PIPELINE_RING_SIZE];
+static volatile uint32_t g_ring_head = 0;
+static volatile uint32_t g_ring_tail = 0;
+static uint32_t g_seq = 0;
+
+// formatted frame pool
+static event_pipeline_frame_t g_frames[EVENT_PIPELINE_FRAME_COUNT];
+static uint32_t g_frames_free = (1UL << EVENT_PIPELINE_FRAME_COUNT) - 1;
+
+static TaskHandle_t g_format_task = NULL;
+static QueueHandle_t g_stage_queues[EVENT_PIPELINE_STAGE_MAX] = { NULL };
+static event_pipeline_record_cb_t g_record_cb = NULL;
+
+static portMUX_TYPE g_lock = portMUX_INITIALIZER_UNLOCKED;  // protects frame pool and stats
+static event_pipeline_stats_t g_stats = { 0 };
+
+/**
+ * @brief Sensor events collected by the MQTT publisher, published together as one JSON array
+ */
+static struct {
+    char     buf[EVENT_PIPELINE_BATCH_BYTES];       // "[" then the events separated by ","; "]" added on flush
+    uint32_t len;
+    uint32_t count;
+    uint16_t start[EVENT_PIPELINE_BATCH_EVENTS];    // offset of each event in buf
+    int64_t  deadline_us;                           // flush time, set by the first event
+} g_batch;
+static int64_t g_last_event_us = 0;                 // last sensor event seen by the MQTT publisher
+
+int64_t event_pipeline_timestamp_to_epoch_us(int64_t irq_timestamp_us) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    if (tv.tv_sec < 1600000000) {
+        return 0;
+    }
+
+    const int64_t now_epoch_us = (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+    return now_epoch_us - (esp_timer_get_time() - irq_timestamp_us);
+}
+
+static void event_pipeline_note_depth(event_pipeline_stage_t stage, uint32_t depth) {
+    if (depth > g_stats.stages[stage].depth_max) {
+        g_stats.stages[stage].depth_max = depth;
+    }
+}
+
+static event_pipeline_frame_t *event_pipeline_frame_alloc(void) {
+    event_pipeline_frame_t *frame = NULL;
+
+    taskENTER_CRITICAL(&g_lock);
+    if (g_frames_free) {
+        const int idx = __builtin_ctz(g_frames_free);
+        g_frames_free &= ~(1UL << idx);
+        frame = &g_frames[idx];
+    } else {
+        g_stats.frames_exhausted++;
+    }
+    taskEXIT_CRITICAL(&g_lock);
+
+    return frame;
+}
+
+static void event_pipeline_frame_release(event_pipeline_frame_t *frame) {
+    taskENTER_CRITICAL(&g_lock);
+    if (frame->refs > 0 && --frame->refs == 0) {
+        g_frames_free |= 1UL << (frame - g_frames);
+    }
+    taskEXIT_CRITICAL(&g_lock);
+}
+
+/**
+ * @brief Builds the JSON payload published for one record, returns the event type
+ */
+static const char *event_pipeline_format(const event_pipeline_record_t *record, char *payload, size_t len) {
+    const unsigned int timestamp_ms = (unsigned int)(record->irq_timestamp_us / 1000);
+    const int64_t epoch_us = event_pipeline_timestamp_to_epoch_us(record->irq_timestamp_us);
+    const char *event_type = "unknown";
+    const char *event_description = "Unknown event";
+
+    switch (record->event_id) {
+        case AS3935_INT_LIGHTNING:
+            event_type = "lightning";
+            event_description = "Lightning Strike Detected";
+            snprintf(payload, len,
+                "{\"event\":\"%s\",\"description\":\"%s\",\"distance_km\":%d,\"distance_description\":\"%s\","
+                "\"energy\":%lu,\"energy_description\":\"%s\","
+                "\"r0\":\"0x%02x\",\"r1\":\"0x%02x\",\"r3\":\"0x%02x\",\"r8\":\"0x%02x\","
+                "\"timestamp\":%u,\"irq_timestamp_us\":%lld,\"epoch_us\":%lld}",
+                event_type, event_description,
+                record->distance_km,
+                record->distance_km > 40 ? "Very Far (>40km)" :
+                record->distance_km > 20 ? "Far (20-40km)" :
+                record->distance_km > 10 ? "Moderate (10-20km)" :
+                record->distance_km > 5 ? "Close (5-10km)" :
+                "Very Close (<5km)",
+                (unsigned long)record->energy,
+                record->energy > 1000 ? "Very Strong (>1000)" :
+                record->energy > 500 ? "Strong (500-1000)" :
+                record->energy > 200 ? "Moderate (200-500)" : "Weak (<200)",
+                record->r0, record->r1, record->r3, record->r8, timestamp_ms, (long long)record->irq_timestamp_us, (long long)epoch_us);
+            break;
+
+        case AS3935_INT_DISTURBER:
+        case AS3935_INT_NOISE:
+            event_type = record->event_id == AS3935_INT_DISTURBER ? "disturber" : "noise";
+            event_description = record->event_id == AS3935_INT_DISTURBER ? "Disturber Detected (non-lightning noise)" : "Noise Level Too High";
+            snprintf(payload, len,
+                "{\"event\":\"%s\",\"description\":\"%s\","
+                "\"r0\":\"0x%02x\",\"r1\":\"0x%02x\",\"r3\":\"0x%02x\",\"r8\":\"0x%02x\","
+                "\"timestamp\":%u,\"irq_timestamp_us\":%lld,\"epoch_us\":%lld}",
+                event_type, event_description, record->r0, record->r1, record->r3, record->r8,
+                timestamp_ms, (long long)record->irq_timestamp_us, (long long)epoch_us);
+            break;
+
+        default:
+            event_description = "Unknown event type";
+            snprintf(payload, len,
+                "{\"event\":\"unknown\",\"description\":\"%s\",\"event_id\":%d,"
+                "\"r0\":\"0x%02x\",\"r1\":\"0x%02x\",\"r3\":\"0x%02x\",\"r8\":\"0x%02x\","
+                "\"timestamp\":%u,\"irq_timestamp_us\":%lld,\"epoch_us\":%lld}",
+                event_description, (int)record->event_id, record->r0, record->r1, record->r3, record->r8,
+                timestamp_ms, (long long)record->irq_timestamp_us, (long long)epoch_us);
+            break;
+    }
+
+    return event_type;
+}
+
+/**
+ * @brief "mqtt" / "cbor" is "1" when every sensor event is also published as CBOR
+ */
+static bool event_pipeline_cbor_enabled(void) {
+    const settings_snapshot_t *snap = settings_snapshot_acquire();
+    const char *cbor = settings_snapshot_get_str(snap, "mqtt", "cbor");
+    const bool enabled = cbor && cbor[0] == '1';
+    settings_snapshot_release(snap);
+    return enabled;
+}
+
+/**
+ * @brief Builds the compact CBOR payload of a record (schema in event_pipeline.h)
+ * @return encoded length, 0 if it did not fit
+ */
+size_t event_pipeline_format_cbor(const event_pipeline_record_t *record, uint8_t *buf, size_t len) {
+    const int64_t epoch_us = event_pipeline_timestamp_to_epoch_us(record->irq_timestamp_us);
+    const uint8_t regs[4] = { record->r0, record->r1, record->r3, record->r8 };
+    uint8_t type = EVENT_PIPELINE_CBOR_TYPE_UNKNOWN;
+
+    switch (record->event_id) {
+        case AS3935_INT_LIGHTNING: type = EVENT_PIPELINE_CBOR_TYPE_LIGHTNING; break;
+        case AS3935_INT_DISTURBER: type = EVENT_PIPELINE_CBOR_TYPE_DISTURBER; break;
+        case AS3935_INT_NOISE:     type = EVENT_PIPELINE_CBOR_TYPE_NOISE; break;
+        default: break;
+    }
+
+    // version, type, seq, irq timestamp and registers, then the optional keys
+    const size_t pairs = 5 + (epoch_us ? 1 : 0) + (type == EVENT_PIPELINE_CBOR_TYPE_LIGHTNING ? 2 : 0) +
+                         (type == EVENT_PIPELINE_CBOR_TYPE_UNKNOWN ? 1 : 0);
+
+    cbor_writer_t w;
+    cbor_writer_init(&w, buf, len);
+    cbor_put_map(&w, pairs);
+    cbor_put_uint(&w, EVENT_PIPELINE_CBOR_KEY_VERSION);
+    cbor_put_uint(&w, EVENT_PIPELINE_CBOR_VERSION);
+    cbor_put_uint(&w, EVENT_PIPELINE_CBOR_KEY_TYPE);
+    cbor_put_uint(&w, type);
+    cbor_put_uint(&w, EVENT_PIPELINE_CBOR_KEY_SEQ);
+    cbor_put_uint(&w, record->seq);
+    cbor_put_uint(&w, EVENT_PIPELINE_CBOR_KEY_IRQ_US);
+    cbor_put_int(&w, record->irq_timestamp_us);
+    if (epoch_us) {
+        cbor_put_uint(&w, EVENT_PIPELINE_CBOR_KEY_EPOCH_US);
+        cbor_put_int(&w, epoch_us);
+    }
+    if (type == EVENT_PIPELINE_CBOR_TYPE_LIGHTNING) {
+        cbor_put_uint(&w, EVENT_PIPELINE_CBOR_KEY_DISTANCE);
+        cbor_put_uint(&w, record->distance_km);
+        cbor_put_uint(&w, EVENT_PIPELINE_CBOR_KEY_ENERGY);
+        cbor_put_uint(&w, record->energy);
+    }
+    cbor_put_uint(&w, EVENT_PIPELINE_CBOR_KEY_REGS);
+    cbor_put_bytes(&w, regs, sizeof(regs));
+    if (type == EVENT_PIPELINE_CBOR_TYPE_UNKNOWN) {
+        cbor_put_uint(&w, EVENT_PIPELINE_CBOR_KEY_EVENT_ID);
+        cbor_put_uint(&w, record->event_id);
+    }
+    return cbor_writer_finish(&w);
+}
+
+/**
+ * @brief Hands a formatted frame to every publisher stage that has room for it
+ */
+static void event_pipeline_dispatch(event_pipeline_frame_t *frame) {
+    // hold one reference while dispatching so a fast publisher cannot recycle the frame under us
+    frame->refs = 1;
+
+    for (int stage = EVENT_PIPELINE_STAGE_MQTT; stage < EVENT_PIPELINE_STAGE_MAX; stage++) {
+        taskENTER_CRITICAL(&g_lock);
+        frame->refs++;
+        taskEXIT_CRITICAL(&g_lock);
+
+        if (xQueueSend(g_stage_queues[stage], &frame, 0) != pdTRUE) {
+            taskENTER_CRITICAL(&g_lock);
+            frame->refs--;
+            g_stats.stages[stage].dropped++;
+            taskEXIT_CRITICAL(&g_lock);
+            ESP_LOGW(TAG, "%s stage full, event %lu dropped", event_pipeline_stage_name(stage), (unsigned long)frame->seq);
+            continue;
+        }
+
+        const uint32_t depth = (uint32_t)uxQueueMessagesWaiting(g_stage_queues[stage]);
+        taskENTER_CRITICAL(&g_lock);
+        g_stats.stages[stage].enqueued++;
+        event_pipeline_note_depth(stage, depth);
+        taskEXIT_CRITICAL(&g_lock);
+    }
+
+    event_pipeline_frame_release(frame);
+}
+
+static void event_pipeline_format_task(void *pvParameters) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // drain everything the monitor has produced since the last wake-up
+        uint32_t tail = g_ring_tail;
+        while (tail != __atomic_load_n(&g_ring_head, __ATOMIC_ACQUIRE)) {
+            const event_pipeline_record_t record = g_ring[tail % EVENT_PIPELINE_RING_SIZE];
+            tail++;
+            __atomic_store_n(&g_ring_tail, tail, __ATOMIC_RELEASE);
+
+            event_pipeline_frame_t *frame = event_pipeline_frame_alloc();
+            if (frame) {
+                frame->seq = record.seq;
+                frame->topic_leaf = NULL;
+                frame->retain = false;
+                frame->event_type = event_pipeline_format(&record, frame->payload, sizeof(frame->payload));
+                frame->cbor_len = event_pipeline_cbor_enabled() ?
+                                  (uint16_t)event_pipeline_format_cbor(&record, frame->cbor, sizeof(frame->cbor)) : 0;
+                event_pipeline_dispatch(frame);
+            } else {
+                ESP_LOGW(TAG, "No free frame, event %lu dropped", (unsigned long)record.seq);
+            }
+
+            // after dispatch, so anything the hook publishes follows the event itself
+            if (g_record_cb) {
+                g_record_cb(&record);
+            }
+
+            const int64_t latency_us = esp_timer_get_time() - record.irq_timestamp_us;
+            taskENTER_CRITICAL(&g_lock);
+            g_stats.stages[EVENT_PIPELINE_STAGE_RING].processed++;
+            if (latency_us > (int64_t)g_stats.latency_max_us) {
+                g_stats.latency_max_us = (uint32_t)latency_us;
+            }
+            taskEXIT_CRITICAL(&g_lock);
+        }
+    }
+}
+
+void event_pipeline_topic(const char *event_topic, const char *leaf, char *topic, size_t len) {
+    const char *slash = strrchr(event_topic, '/');
+    const int base_len = slash ? (int)(slash - event_topic) : (int)strlen(event_topic);
+    snprintf(topic, len, "%.*s/%s", base_len, event_topic, leaf);
+}
+
+/**
+ * @brief Publishes one message, binary when len is set; the topic is read in place from the settings snapshot, no flash access
+ */
+static esp_err_t event_pipeline_mqtt_send(const char *topic_leaf, bool retain, const char *payload, size_t len) {
+    const settings_snapshot_t *snap = settings_snapshot_acquire();
+    const char *topic = settings_snapshot_get_str(snap, "mqtt", "topic");
+    if (!topic) topic = "as3935/lightning";
+    char leaf_topic[128];
+    if (topic_leaf && topic_leaf[0]) {
+        event_pipeline_topic(topic, topic_leaf, leaf_topic, sizeof(leaf_topic));
+        topic = leaf_topic;
+    }
+    const esp_err_t err = len ? mqtt_publish_bin(topic, payload, len) :
+                          retain ? mqtt_publish_retained(topic, payload) : mqtt_publish(topic, payload);
+    settings_snapshot_release(snap);
+    return err;
+}
+
+static void event_pipeline_mqtt_count(uint32_t processed, uint32_t queued, uint32_t failed) {
+    taskENTER_CRITICAL(&g_lock);
+    g_stats.stages[EVENT_PIPELINE_STAGE_MQTT].processed += processed;
+    g_stats.stages[EVENT_PIPELINE_STAGE_MQTT].skipped += queued;
+    g_stats.stages[EVENT_PIPELINE_STAGE_MQTT].failed += failed;
+    taskEXIT_CRITICAL(&g_lock);
+}
+
+/**
+ * @brief Reads "mqtt" / "batch_window_ms" (0 disables batching) and "mqtt" / "batch_max"
+ */
+static void event_pipeline_batch_config(uint32_t *window_ms, uint32_t *max_events) {
+    int32_t window = 0;
+    int32_t max = EVENT_PIPELINE_BATCH_EVENTS;
+    const settings_snapshot_t *snap = settings_snapshot_acquire();
+    settings_snapshot_get_i32(snap, "mqtt", "batch_window_ms", &window);
+    settings_snapshot_get_i32(snap, "mqtt", "batch_max", &max);
+    settings_snapshot_release(snap);
+
+    if (window < 0) window = 0;
+    if (window > EVENT_PIPELINE_BATCH_WINDOW_MAX) window = EVENT_PIPELINE_BATCH_WINDOW_MAX;
+    if (max < 2) max = 2;
+    if (max > EVENT_PIPELINE_BATCH_EVENTS) max = EVENT_PIPELINE_BATCH_EVENTS;
+    *window_ms = (uint32_t)window;
+    *max_events = (uint32_t)max;
+}
+
+/**
+ * @brief Publishes the open batch as one JSON array on <base>/batch, or a lone
+ * event on the event topic; when that is not possible the events are queued
+ * one by one in the outbox
+ */
+static void event_pipeline_batch_flush(void) {
+    if (!g_batch.count) return;
+
+    const uint32_t end = g_batch.len;
+    esp_err_t err = ESP_FAIL;
+    if (mqtt_is_connected() && mqtt_outbox_pending() == 0) {
+        if (g_batch.count == 1) {
+            g_batch.buf[end] = '\0';
+            err = event_pipeline_mqtt_send(NULL, false, g_batch.buf + g_batch.start[0], 0);
+        } else {
+            g_batch.buf[end] = ']';
+            g_batch.buf[end + 1] = '\0';
+            err = event_pipeline_mqtt_send(EVENT_PIPELINE_BATCH_TOPIC, false, g_batch.buf, 0);
+        }
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "MQTT publish of %lu batched events failed: %s", (unsigned long)g_batch.count, esp_err_to_name(err));
+        }
+    }
+
+    if (err == ESP_OK) {
+        event_pipeline_mqtt_count(g_batch.count, 0, 0);
+        if (g_batch.count > 1) {
+            taskENTER_CRITICAL(&g_lock);
+            g_stats.mqtt_batches++;
+            g_stats.mqtt_batched += g_batch.count;
+            taskEXIT_CRITICAL(&g_lock);
+        }
+    } else {
+        uint32_t queued = 0;
+        for (uint32_t i = 0; i < g_batch.count; i++) {
+            // events are separated by a single ','
+            g_batch.buf[i + 1 < g_batch.count ? g_batch.start[i + 1] - 1u : end] = '\0';
+            if (mqtt_outbox_push(NULL, false, g_batch.buf + g_batch.start[i]) == ESP_OK) queued++;
+        }
+        event_pipeline_mqtt_count(0, queued, g_batch.count - queued);
+    }
+
+    g_batch.count = 0;
+    g_batch.len = 0;
+}
+
+/**
+ * @brief Adds a sensor event to the batch, opening it if needed
+ */
+static void event_pipeline_batch_add(const char *payload, int64_t now_us, uint32_t window_ms, uint32_t max_events) {
+    const uint32_t len = strlen(payload);
+    // room for the separator, the closing ']' and the terminator
+    if (g_batch.count && g_batch.len + len + 3 > sizeof(g_batch.buf)) {
+        event_pipeline_batch_flush();
+    }
+
+    if (!g_batch.count) {
+        g_batch.buf[0] = '[';
+        g_batch.len = 1;
+        g_batch.deadline_us = now_us + (int64_t)window_ms * 1000;
+    } else {
+        g_batch.buf[g_batch.len++] = ',';
+    }
+    g_batch.start[g_batch.count++] = (uint16_t)g_batch.len;
+    memcpy(g_batch.buf + g_batch.len, payload, len);
+    g_batch.len += len;
+
+    if (g_batch.count >= max_events) {
+        event_pipeline_batch_flush();
+    }
+}
+
+static void event_pipeline_mqtt_handle(const event_pipeline_frame_t *frame) {
+    const int64_t now_us = esp_timer_get_time();
+    const bool online = mqtt_is_connected() && mqtt_outbox_pending() == 0;
+
+    if (frame->seq && !frame->topic_leaf) {
+        uint32_t window_ms, max_events;
+        event_pipeline_batch_config(&window_ms, &max_events);
+
+        // a sensor event within the window of the previous one starts or joins a batch,
+        // an isolated one goes out at once
+        const bool burst = g_batch.count ||
+                           (g_last_event_us && now_us - g_last_event_us < (int64_t)window_ms * 1000);
+        g_last_event_us = now_us;
+        if (window_ms && online && burst) {
+            event_pipeline_batch_add(frame->payload, now_us, window_ms, max_events);
+            return;
+        }
+    }
+
+    // nothing may overtake the events already batched
+    event_pipeline_batch_flush();
+
+    esp_err_t err = ESP_FAIL;
+    if (mqtt_is_connected() && mqtt_outbox_pending() == 0) {
+        err = event_pipeline_mqtt_send(frame->topic_leaf, frame->retain, frame->payload, 0);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "MQTT publish of event %lu failed: %s", (unsigned long)frame->seq, esp_err_to_name(err));
+        }
+    }
+    if (err == ESP_OK) {
+        event_pipeline_mqtt_count(1, 0, 0);
+    } else if (mqtt_outbox_push(frame->topic_leaf, frame->retain, frame->payload) == ESP_OK) {
+        event_pipeline_mqtt_count(0, 1, 0);
+    } else {
+        event_pipeline_mqtt_count(0, 0, 1);
+    }
+}
+
+/**
+ * @brief Publishes the CBOR copy of a sensor event on <base>/cbor; never batched,
+ * queued like any other message while the broker is away
+ */
+static void event_pipeline_mqtt_cbor(const event_pipeline_frame_t *frame) {
+    if (!frame->cbor_len) return;
+
+    esp_err_t err = ESP_FAIL;
+    if (mqtt_is_connected() && mqtt_outbox_pending() == 0) {
+        err = event_pipeline_mqtt_send(EVENT_PIPELINE_CBOR_TOPIC, false, (const char *)frame->cbor, frame->cbor_len);
+    }
+    if (err != ESP_OK && mqtt_outbox_push_bin(EVENT_PIPELINE_CBOR_TOPIC, frame->cbor, frame->cbor_len) != ESP_OK) {
+        ESP_LOGW(TAG, "CBOR copy of event %lu dropped", (unsigned long)frame->seq);
+    }
+}
+
+/**
+ * @brief MQTT publisher: sends frames straight through while the broker is up and
+ * nothing is queued, otherwise queues them in the outbox and replays it in order,
+ * rate limited, once connected again.  With batching enabled, bursts of sensor
+ * events are collected for up to the batch window and published together.
+ */
+static void event_pipeline_mqtt_task(void *pvParameters) {
+    static mqtt_outbox_msg_t msg;    // too big for the task stack
+    event_pipeline_frame_t *frame = NULL;
+    int64_t last_replay_us = 0;
+
+    for (;;) {
+        uint32_t wait_ms = UINT32_MAX;
+        if (g_batch.count) {
+            const int64_t remaining_us = g_batch.deadline_us - esp_timer_get_time();
+            wait_ms = remaining_us > 0 ? (uint32_t)((remaining_us + 999) / 1000) : 0;
+        }
+        if (mqtt_outbox_pending()) {
+            const uint32_t poll_ms = mqtt_is_connected() ? mqtt_outbox_replay_interval_ms() : EVENT_PIPELINE_OFFLINE_POLL_MS;
+            if (poll_ms < wait_ms) wait_ms = poll_ms;
+        }
+
+        const TickType_t wait = wait_ms == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(wait_ms);
+        if (xQueueReceive(g_stage_queues[EVENT_PIPELINE_STAGE_MQTT], &frame, wait) == pdTRUE) {
+            event_pipeline_mqtt_handle(frame);
+            event_pipeline_mqtt_cbor(frame);
+            event_pipeline_frame_release(frame);
+        }
+
+        const int64_t now_us = esp_timer_get_time();
+        if (g_batch.count && now_us >= g_batch.deadline_us) {
+            event_pipeline_batch_flush();
+        }
+
+        // replay the backlog, one message per interval
+        if (mqtt_is_connected() && mqtt_outbox_pending() &&
+            now_us - last_replay_us >= (int64_t)mqtt_outbox_replay_interval_ms() * 1000 &&
+            mqtt_outbox_peek(&msg) == ESP_OK) {
+            last_replay_us = now_us;
+            if (event_pipeline_mqtt_send(msg.topic_leaf, msg.retain, msg.payload, msg.binary ? msg.len : 0) == ESP_OK) {
+                mqtt_outbox_pop();
+            }
+        }
+    }
+}
+
+static void event_pipeline_sse_task(void *pvParameters) {
+    event_pipeline_frame_t *frame = NULL;
+
+    for (;;) {
+        if (xQueueReceive(g_stage_queues[EVENT_PIPELINE_STAGE_SSE], &frame, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        events_broadcast(frame->event_type, frame->payload);
+
+        taskENTER_CRITICAL(&g_lock);
+        g_stats.stages[EVENT_PIPELINE_STAGE_SSE].processed++;
+        taskEXIT_CRITICAL(&g_lock);
+
+        event_pipeline_frame_release(frame);
+    }
+}
+
+esp_err_t event_pipeline_init(void) {
+    if (g_format_task) {
+        return ESP_OK;
+    }
+
+    for (int stage = EVENT_PIPELINE_STAGE_MQTT; stage < EVENT_PIPELINE_STAGE_MAX; stage++) {
+        g_stage_queues[stage] = xQueueCreate(EVENT_PIPELINE_STAGE_DEPTH, sizeof(event_pipeline_frame_t *));
+        if (!g_stage_queues[stage]) {
+            ESP_LOGE(TAG, "Failed to create %s stage queue", event_pipeline_stage_name(stage));
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    if (xTaskCreate(event_pipeline_mqtt_task, "evp_mqtt", EVENT_PIPELINE_TASK_STACK_SIZE, NULL,
+                    EVENT_PIPELINE_PUBLISH_TASK_PRIORITY, NULL) != pdPASS ||
+        xTaskCreate(event_pipeline_sse_task, "evp_sse", EVENT_PIPELINE_TASK_STACK_SIZE, NULL,
+                    EVENT_PIPELINE_PUBLISH_TASK_PRIORITY, NULL) != pdPASS ||
+        xTaskCreate(event_pipeline_format_task, "evp_format", EVENT_PIPELINE_TASK_STACK_SIZE, NULL,
+                    EVENT_PIPELINE_FORMAT_TASK_PRIORITY, &g_format_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create pipeline tasks");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Event pipeline started: ring=%d frames=%d stage_depth=%d",
+             EVENT_PIPELINE_RING_SIZE, EVENT_PIPELINE_FRAME_COUNT, EVENT_PIPELINE_STAGE_DEPTH);
+    return ESP_OK;
+}
+
+esp_err_t event_pipeline_submit(const event_pipeline_record_t *record) {
+    if (!record) return ESP_ERR_INVALID_ARG;
+    if (!g_format_task) return ESP_ERR_INVALID_STATE;
+
+    const uint32_t head = g_ring_head;
+    const uint32_t depth = head - __atomic_load_n(&g_ring_tail, __ATOMIC_ACQUIRE);
+    if (depth >= EVENT_PIPELINE_RING_SIZE) {
+        taskENTER_CRITICAL(&g_lock);
+        g_stats.stages[EVENT_PIPELINE_STAGE_RING].dropped++;
+        taskEXIT_CRITICAL(&g_lock);
+        return ESP_ERR_NO_MEM;
+    }
+
+    event_pipeline_record_t *slot = &g_ring[head % EVENT_PIPELINE_RING_SIZE];
+    *slot = *record;
+    slot->seq = ++g_seq;
+    __atomic_store_n(&g_ring_head, head + 1, __ATOMIC_RELEASE);
+
+    taskENTER_CRITICAL(&g_lock);
+    g_stats.stages[EVENT_PIPELINE_STAGE_RING].enqueued++;
+    event_pipeline_note_depth(EVENT_PIPELINE_STAGE_RING, depth + 1);
+    taskEXIT_CRITICAL(&g_lock);
+
+    xTaskNotifyGive(g_format_task);
+    return ESP_OK;
+}
+
+esp_err_t event_pipeline_publish(const char *event_type, const char *topic_leaf, const char *payload, bool retain) {
+    if (!event_type || !topic_leaf || !payload) return ESP_ERR_INVALID_ARG;
+    if (!g_format_task) return ESP_ERR_INVALID_STATE;
+
+    event_pipeline_frame_t *frame = event_pipeline_frame_alloc();
+    if (!frame) {
+        ESP_LOGW(TAG, "No free frame, %s update dropped", event_type);
+        return ESP_ERR_NO_MEM;
+    }
+
+    frame->seq = 0;
+    frame->event_type = event_type;
+    frame->topic_leaf = topic_leaf;
+    frame->retain = retain;
+    frame->cbor_len = 0;
+    strlcpy(frame->payload, payload, sizeof(frame->payload));
+    event_pipeline_dispatch(frame);
+    return ESP_OK;
+}
+
+void event_pipeline_set_record_cb(event_pipeline_record_cb_t cb) {
+    g_record_cb = cb;
+}
+
+void event_pipeline_get_stats(event_pipeline_stats_t *stats) {
+    if (!stats) return;
+
+    taskENTER_CRITICAL(&g_lock);
+    *stats = g_stats;
+    taskEXIT_CRITICAL(&g_lock);
+}
+
+const char *event_pipeline_stage_name(event_pipeline_stage_t stage) {
+    switch (stage) {
+        case EVENT_PIPELINE_STAGE_RING:
+            return "ring";
+        case EVENT_PIPELINE_STAGE_MQTT:
+            return "mqtt";
+        case EVENT_PIPELINE_STAGE_SSE:
+            return "sse";
+        default:
+            return "unknown";
+    }
+}
+
+esp_err_t event_pipeline_stats_handler(httpd_req_t *req) {
+    event_pipeline_stats_t stats;
+    event_pipeline_get_stats(&stats);
+
+    char response[768];
+    int len = snprintf(response, sizeof(response), "{\"status\":\"ok\",\"stages\":{");
+
+    for (int stage = 0; stage < EVENT_PIPELINE_STAGE_MAX && len < (int)sizeof(response); stage++) {
+        const event_pipeline_stage_stats_t *s = &stats.stages[stage];
+        len += snprintf(response + len, sizeof(response) - len,
+            "%s\"%s\":{"
+                "\"enqueued\":%lu,"
+                "\"dropped\":%lu,"
+                "\"processed\":%lu,"
+                "\"failed\":%lu,"
+                "\"skipped\":%lu,"
+                "\"depth_max\":%lu"
+            "}",
+            stage ? "," : "", event_pipeline_stage_name((event_pipeline_stage_t)stage),
+            (unsigned long)s->enqueued, (unsigned long)s->dropped, (unsigned long)s->processed,
+            (unsigned long)s->failed, (unsigned long)s->skipped, (unsigned long)s->depth_max);
+    }
+
+    if (len < (int)sizeof(response)) {
+        snprintf(response + len, sizeof(response) - len,
+                 "},\"frames_exhausted\":%lu,\"latency_max_us\":%lu,\"mqtt_batches\":%lu,\"mqtt_batched\":%lu}",
+                 (unsigned long)stats.frames_exhausted, (unsigned long)stats.latency_max_us,
+                 (unsigned long)stats.mqtt_batches, (unsigned long)stats.mqtt_batched);
+    }
+
+    return http_reply_json(req, response);
+}
@@ -1,84 +1,451 @@
 #include "events.h"
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
 #include "esp_http_server.h"
+#include "http_helpers.h"
 
 static const char *TAG = "events";
 
-typedef struct sse_client {
-    httpd_req_t *req;
-    struct sse_client *next;
+typedef struct {
+    uint32_t seq;           // sequence number of the frame in this slot
+    int64_t  queued_us;     // esp_timer time the frame was broadcast
+    uint32_t type_bit;      // event_type_bit() of the frame's event name
+    size_t   len;
+    char     data[EVENTS_FRAME_MAX + EVENTS_CHUNK_OVERHEAD];   // already in HTTP chunk framing
+} sse_frame_t;
+
+// Subscribers are plain session sockets: the stream handler sends the headers
+// and returns, so no server task is held.  Slots are only touched from the HTTP
+// server task (handler, session close, drain and keepalive work), so they need
+// no lock; only the count is read elsewhere.
+//
+// Frames are written without blocking, so a slow browser never holds up the
+// server task.  When the socket takes only part of a frame, the client keeps
+// its place in that frame (next_seq, partial_off) and the rest goes out on the
+// next drain; frames arriving meanwhile wait in the ring and fall under
+// drop-oldest.
+typedef struct {
+    int          fd;                // session socket, -1 when the slot is free
+    uint32_t     next_seq;          // next frame this client has to receive
+    uint32_t     types;             // event_type_bit() mask of the events the client subscribed to
+    int64_t      connected_us;
+    uint32_t     sent;
+    uint32_t     dropped;           // frames skipped because the client lagged too far
+    uint32_t     replayed;          // frames resent after a reconnect with Last-Event-ID
+    uint32_t     filtered;          // frames skipped by the client's ?types= filter
+    uint32_t     latency_max_us;    // broadcast-to-sent delay
+    uint64_t     latency_total_us;
+    uint32_t     partial_off;       // bytes of frame next_seq already written, 0 on a frame boundary
+    int64_t      stalled_us;        // time the socket last refused data without progress, 0 while it drains
+    uint32_t     stalls;            // sends the socket could not take in full
 } sse_client_t;
 
-static sse_client_t *clients = NULL;
-static SemaphoreHandle_t clients_mutex;
+static sse_frame_t ring[EVENTS_RING_SIZE];
+static uint32_t ring_head = 0;              // sequence number of the next frame, protected by ring_mutex
+static SemaphoreHandle_t ring_mutex;
+static sse_client_t clients[EVENTS_MAX_CLIENTS];
+static volatile uint32_t client_count = 0;
+static uint32_t client_peak = 0;
+static volatile bool drain_pending = false;
+static httpd_handle_t server = NULL;
+static esp_timer_handle_t keepalive_timer = NULL;
+static uint32_t broadcasts = 0;
+static uint32_t rejected = 0;
+static uint32_t replays = 0;
 
-void events_init(void)
+// Event names a client can pass in ?types=, one mask bit each; names not in
+// the table share the "other" bit.
+static const char *const event_types[] = { "lightning", "disturber", "noise", "ota_progress", "storm", "alert", "histogram", "command" };
+#define EVENT_TYPE_OTHER    (1u << 31)
+#define EVENT_TYPES_ALL     (0xFFFFFFFFu)
+
+static const char keepalive_chunk[] = "d\r\n: keepalive\n\n\r\n";
+
+static uint32_t event_type_bit(const char *name, size_t len)
 {
-    if (!clients_mutex) clients_mutex = xSemaphoreCreateMutex();
-    ESP_LOGI(TAG, "events initialized");
+    for (size_t i = 0; i < sizeof(event_types) / sizeof(event_types[0]); i++) {
+        if (strlen(event_types[i]) == len && strncmp(event_types[i], name, len) == 0) return 1u << i;
+    }
+    return EVENT_TYPE_OTHER;
+}
+
+/**
+ * @brief Parses a comma separated list of event names into a type mask
+ * @return false if the list names an unknown event
+ */
+static bool parse_types(const char *list, uint32_t *mask)
+{
+    *mask = 0;
+    while (*list) {
+        const char *end = strchr(list, ',');
+        const size_t len = end ? (size_t)(end - list) : strlen(list);
+        if (len) {
+            const uint32_t bit = event_type_bit(list, len);
+            if (bit == EVENT_TYPE_OTHER && !(len == 5 && strncmp(list, "other", 5) == 0)) return false;
+            *mask |= bit;
+        }
+        if (!end) break;
+        list = end + 1;
+    }
+    return *mask != 0;
+}
+
+static void client_close(sse_client_t *c, const char *why)
+{
+    ESP_LOGW(TAG, "SSE client fd=%d %s, closing", c->fd, why);
+    // the session close frees the slot
+    httpd_sess_trigger_close(server, c->fd);
+}
+
+/**
+ * @brief Writes as much of buf as the socket takes without blocking
+ * @return bytes written, or -1 when the client was closed (send error, or
+ * no progress for EVENTS_STALL_MS)
+ */
+static int client_send(sse_client_t *c, const char *buf, size_t len)
+{
+    int n = httpd_socket_send(server, c->fd, buf, len, MSG_DONTWAIT);
+    if (n == HTTPD_SOCK_ERR_TIMEOUT) n = 0;     // socket buffer full
+    if (n < 0) {
+        client_close(c, "send failed");
+        return -1;
+    }
+    if (n == (int)len) {
+        c->stalled_us = 0;
+        return n;
+    }
+
+    const int64_t now_us = esp_timer_get_time();
+    c->stalls++;
+    if (n > 0 || !c->stalled_us) {
+        c->stalled_us = now_us;
+    } else if (now_us - c->stalled_us > (int64_t)EVENTS_STALL_MS * 1000) {
+        client_close(c, "stalled");
+        return -1;
+    }
+    return n;
+}
+
+/**
+ * @brief Session context destructor, runs when the server closes a subscriber's socket
+ */
+static void client_free(void *ctx)
+{
+    sse_client_t *c = ctx;
+    if (c->fd < 0) return;
+    ESP_LOGI(TAG, "SSE client fd=%d closed after %lu frames (%lu dropped)", c->fd, (unsigned long)c->sent, (unsigned long)c->dropped);
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+    client_count--;
+}
+
+/**
+ * @brief Sends every client the frames it has not received yet.  Runs on the server task.
+ */
+static void drain_work(void *arg)
+{
+    static char buf[sizeof(ring[0].data)];  // server task only
+    __atomic_store_n(&drain_pending, false, __ATOMIC_RELEASE);
+
+    for (int i = 0; i < EVENTS_MAX_CLIENTS; i++) {
+        sse_client_t *c = &clients[i];
+        while (c->fd >= 0) {
+            size_t len = 0;
+            int64_t queued_us = 0;
+
+            xSemaphoreTake(ring_mutex, portMAX_DELAY);
+            const uint32_t head = ring_head;
+            if (c->next_seq == head) {
+                xSemaphoreGive(ring_mutex);
+                break;
+            }
+            // a frame cut short has to be finished first, the stream is mid-chunk
+            if (!c->partial_off) {
+                if (head - c->next_seq > EVENTS_CLIENT_BACKLOG) {
+                    // drop-oldest: keep only the newest frames this client is allowed to lag
+                    c->dropped += head - c->next_seq - EVENTS_CLIENT_BACKLOG;
+                    c->next_seq = head - EVENTS_CLIENT_BACKLOG;
+                }
+                while (c->next_seq != head && !(ring[c->next_seq % EVENTS_RING_SIZE].type_bit & c->types)) {
+                    c->next_seq++;
+                    c->filtered++;
+                }
+                if (c->next_seq == head) {
+                    xSemaphoreGive(ring_mutex);
+                    break;
+                }
+            }
+            const sse_frame_t *f = &ring[c->next_seq % EVENTS_RING_SIZE];
+            if (f->seq != c->next_seq) {
+                // the rest of the half-written frame was overwritten; the browser
+                // reconnects with Last-Event-ID and gets the missed frames replayed
+                xSemaphoreGive(ring_mutex);
+                client_close(c, "lost its partial frame");
+                break;
+            }
+            len = f->len - c->partial_off;
+            queued_us = f->queued_us;
+            memcpy(buf, f->data + c->partial_off, len);
+            xSemaphoreGive(ring_mutex);
+
+            const int n = client_send(c, buf, len);
+            if (n < 0) break;
+            if (n < (int)len) {
+                c->partial_off += n;
+                break;  // retried on the next broadcast or keepalive
+            }
+
+            c->partial_off = 0;
+            const int64_t latency_us = esp_timer_get_time() - queued_us;
+            c->next_seq++;
+            c->sent++;
+            c->latency_total_us += (uint64_t)latency_us;
+            if (latency_us > c->latency_max_us) c->latency_max_us = (uint32_t)latency_us;
+        }
+    }
+}
+
+static void keepalive_work(void *arg)
+{
+    // retry clients whose socket was full, even when nothing new was broadcast
+    drain_work(NULL);
+
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    const uint32_t head = ring_head;
+    xSemaphoreGive(ring_mutex);
+
+    for (int i = 0; i < EVENTS_MAX_CLIENTS; i++) {
+        sse_client_t *c = &clients[i];
+        // a client that is mid-frame or behind is kept busy by the drain anyway
+        if (c->fd < 0 || c->partial_off || c->next_seq != head) continue;
+        const int n = client_send(c, keepalive_chunk, sizeof(keepalive_chunk) - 1);
+        if (n > 0 && n < (int)sizeof(keepalive_chunk) - 1) {
+            // a keepalive is not in the ring, so its rest cannot be resent
+            client_close(c, "took part of a keepalive");
+        }
+    }
 }
 
-static void add_client(sse_client_t *c)
+static void keepalive_timer_cb(void *arg)
 {
-    xSemaphoreTake(clients_mutex, portMAX_DELAY);
-    c->next = clients;
-    clients = c;
-    xSemaphoreGive(clients_mutex);
+    if (server && client_count) httpd_queue_work(server, keepalive_work, NULL);
 }
 
-static void remove_client(sse_client_t *c)
+void events_init(void)
 {
-    xSemaphoreTake(clients_mutex, portMAX_DELAY);
-    sse_client_t **p = &clients;
-    while (*p) {
-        if (*p == c) { *p = c->next; break; }
-        p = &(*p)->next;
+    if (!ring_mutex) {
+        ring_mutex = xSemaphoreCreateMutex();
+        for (int i = 0; i < EVENTS_MAX_CLIENTS; i++) clients[i].fd = -1;
     }
-    xSemaphoreGive(clients_mutex);
+    if (!keepalive_timer) {
+        const esp_timer_create_args_t args = { .callback = keepalive_timer_cb, .name = "sse_keepalive" };
+        if (esp_timer_create(&args, &keepalive_timer) == ESP_OK) {
+            esp_timer_start_periodic(keepalive_timer, (uint64_t)EVENTS_KEEPALIVE_MS * 1000);
+        }
+    }
+    ESP_LOGI(TAG, "events initialized");
 }
 
 void events_broadcast(const char *event, const char *data)
 {
-    xSemaphoreTake(clients_mutex, portMAX_DELAY);
-    sse_client_t *it = clients;
-    char buf[1024];
-    int offset = 0;
-    if (event && event[0]) offset += snprintf(buf + offset, sizeof(buf) - offset, "event: %s\n", event);
-    if (data) offset += snprintf(buf + offset, sizeof(buf) - offset, "data: %s\n\n", data);
-    else offset += snprintf(buf + offset, sizeof(buf) - offset, "data: \n\n");
-    while (it) {
-        // best-effort send as chunk; ignore errors per-client
-        httpd_resp_sendstr_chunk(it->req, buf);
-        it = it->next;
-    }
-    xSemaphoreGive(clients_mutex);
+    if (!ring_mutex) return;
+
+    char payload[EVENTS_FRAME_MAX];
+    int n = 0;
+    if (event && event[0]) n += snprintf(payload + n, sizeof(payload) - n, "event: %s\n", event);
+    if (data) n += snprintf(payload + n, sizeof(payload) - n, "data: %s\n\n", data);
+    else n += snprintf(payload + n, sizeof(payload) - n, "data: \n\n");
+    if (n >= (int)sizeof(payload)) n = sizeof(payload) - 1;
+
+    // frame once in HTTP chunk encoding so every subscriber gets a single send;
+    // the SSE id is the sequence number plus one, so ids start at 1
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    sse_frame_t *f = &ring[ring_head % EVENTS_RING_SIZE];
+    char id_line[24];
+    const int id_len = snprintf(id_line, sizeof(id_line), "id: %lu\n", (unsigned long)ring_head + 1);
+    int len = snprintf(f->data, sizeof(f->data), "%x\r\n", id_len + n);
+    memcpy(f->data + len, id_line, id_len);
+    len += id_len;
+    memcpy(f->data + len, payload, n);
+    len += n;
+    memcpy(f->data + len, "\r\n", 2);
+    f->len = len + 2;
+    f->seq = ring_head;
+    f->type_bit = event_type_bit(event ? event : "", event ? strlen(event) : 0);
+    f->queued_us = esp_timer_get_time();
+    ring_head++;
+    broadcasts++;
+    xSemaphoreGive(ring_mutex);
+
+    // one drain per burst, whatever the number of clients
+    if (server && client_count && !__atomic_exchange_n(&drain_pending, true, __ATOMIC_ACQ_REL)) {
+        if (httpd_queue_work(server, drain_work, NULL) != ESP_OK) {
+            __atomic_store_n(&drain_pending, false, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+/**
+ * @brief Sends a reconnecting client everything after its Last-Event-ID in one write
+ *
+ * Frames older than the ring are counted as dropped.  If the batch cannot be
+ * allocated the client is simply left behind and the next drain catches it up.
+ */
+static void client_replay(sse_client_t *c, uint32_t last_id)
+{
+    char *batch = NULL;
+    size_t total = 0;
+    uint32_t count = 0;
+    uint32_t seqs[EVENTS_RING_SIZE];    // frames in the batch, to resume a partial write
+    uint16_t lens[EVENTS_RING_SIZE];
+
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    const uint32_t head = ring_head;
+    const uint32_t oldest = head > EVENTS_RING_SIZE ? head - EVENTS_RING_SIZE : 0;
+    uint32_t from = last_id;  // id N is sequence N - 1, so the first missed sequence is N
+    if (from > head) from = head;  // id from before a reboot, nothing to replay
+    if (from < oldest) {
+        c->dropped += oldest - from;
+        from = oldest;
+    }
+    c->next_seq = from;
+    for (uint32_t seq = from; seq != head; seq++) {
+        const sse_frame_t *f = &ring[seq % EVENTS_RING_SIZE];
+        if (f->type_bit & c->types) total += f->len;
+        else c->filtered++;
+    }
+    if (total && (batch = malloc(total)) != NULL) {
+        size_t off = 0;
+        for (uint32_t seq = from; seq != head; seq++) {
+            const sse_frame_t *f = &ring[seq % EVENTS_RING_SIZE];
+            if (!(f->type_bit & c->types)) continue;
+            memcpy(batch + off, f->data, f->len);
+            off += f->len;
+            seqs[count] = seq;
+            lens[count] = (uint16_t)f->len;
+            count++;
+        }
+        c->next_seq = head;
+    } else if (!total) {
+        c->next_seq = head;
+    }
+    xSemaphoreGive(ring_mutex);
+
+    if (batch) {
+        const int n = client_send(c, batch, total);
+        if (n == (int)total) {
+            c->replayed += count;
+            replays++;
+        } else if (n >= 0) {
+            // the socket took part of the batch: continue from the frame it stopped in
+            size_t done = 0;
+            uint32_t i = 0;
+            while (done + lens[i] <= (size_t)n) done += lens[i++];
+            c->replayed += i;
+            c->next_seq = seqs[i];
+            c->partial_off = (uint32_t)(n - done);
+        }
+        free(batch);
+    } else if (c->next_seq != head && !__atomic_exchange_n(&drain_pending, true, __ATOMIC_ACQ_REL)) {
+        if (httpd_queue_work(server, drain_work, NULL) != ESP_OK) {
+            __atomic_store_n(&drain_pending, false, __ATOMIC_RELEASE);
+        }
+    }
 }
 
 static esp_err_t sse_handler(httpd_req_t *req)
 {
+    int slot = -1;
+    for (int i = 0; i < EVENTS_MAX_CLIENTS && slot < 0; i++) {
+        if (clients[i].fd < 0) slot = i;
+    }
+    // optional ?types=lightning,noise subscription filter
+    uint32_t types = EVENT_TYPES_ALL;
+    char query[128];
+    char list[96];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "types", list, sizeof(list)) == ESP_OK &&
+        !parse_types(list, &types)) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "unknown event type in types");
+    }
+
+    if (slot < 0) {
+        rejected++;
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_sendstr(req, "too many event stream clients");
+    }
+
+    // headers and the first chunk go out through the request, everything after
+    // that straight to the socket; the chunked response is never terminated
     httpd_resp_set_type(req, "text/event-stream");
     httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
-    httpd_resp_sendstr_chunk(req, "retry: 10000\n\n");
-    sse_client_t *client = calloc(1, sizeof(sse_client_t));
-    if (!client) return ESP_ERR_NO_MEM;
-    client->req = req;
-    client->next = NULL;
-    add_client(client);
-    // keep connection open; send periodic keepalives
-    while (1) {
-        vTaskDelay(pdMS_TO_TICKS(10000));
-        esp_err_t r = httpd_resp_sendstr_chunk(req, ": keepalive\n\n");
-        if (r != ESP_OK) {
-            // client disconnected or send failed
-            remove_client(client);
-            free(client);
-            return r;
-        }
+    esp_err_t err = httpd_resp_sendstr_chunk(req, "retry: 10000\n\n");
+    if (err != ESP_OK) return err;
+
+    sse_client_t *c = &clients[slot];
+    server = req->handle;
+    c->fd = httpd_req_to_sockfd(req);
+    c->types = types;
+    c->connected_us = esp_timer_get_time();
+    if (++client_count > client_peak) client_peak = client_count;
+
+    // the slot is released when the server closes the session
+    req->sess_ctx = c;
+    req->free_ctx = client_free;
+
+    // browsers send Last-Event-ID when they reconnect after the retry interval
+    char last_id[16];
+    if (httpd_req_get_hdr_value_str(req, "Last-Event-ID", last_id, sizeof(last_id)) == ESP_OK) {
+        client_replay(c, (uint32_t)strtoul(last_id, NULL, 10));
+    } else {
+        xSemaphoreTake(ring_mutex, portMAX_DELAY);
+        c->next_seq = ring_head;
+        xSemaphoreGive(ring_mutex);
     }
+
+    ESP_LOGI(TAG, "SSE client fd=%d connected (%lu/%d)", c->fd, (unsigned long)client_count, EVENTS_MAX_CLIENTS);
+    return ESP_OK;
+}
+
+esp_err_t events_clients_handler(httpd_req_t *req)
+{
+    const size_t size = 256 + EVENTS_MAX_CLIENTS * 160;
+    char *response = malloc(size);
+    if (!response) return http_reply_json(req, "{\"status\":\"error\",\"msg\":\"malloc_failed\"}");
+    const int64_t now_us = esp_timer_get_time();
+
+    xSemaphoreTake(ring_mutex, portMAX_DELAY);
+    const uint32_t head = ring_head;
+    xSemaphoreGive(ring_mutex);
+
+    int len = snprintf(response, size, "{\"status\":\"ok\",\"active\":%lu,\"peak\":%lu,\"max\":%d,\"broadcasts\":%lu,\"rejected\":%lu,\"replays\":%lu,\"clients\":[",
+                       (unsigned long)client_count, (unsigned long)client_peak, EVENTS_MAX_CLIENTS,
+                       (unsigned long)broadcasts, (unsigned long)rejected, (unsigned long)replays);
+    bool first = true;
+    for (int i = 0; i < EVENTS_MAX_CLIENTS && len < (int)size; i++) {
+        const sse_client_t *c = &clients[i];
+        if (c->fd < 0) continue;
+        len += snprintf(response + len, size - len,
+            "%s{\"fd\":%d,\"connected_s\":%lu,\"sent\":%lu,\"dropped\":%lu,\"replayed\":%lu,\"filtered\":%lu,\"types\":%lu,\"backlog\":%lu,"
+            "\"stalls\":%lu,\"latency_avg_us\":%lu,\"latency_max_us\":%lu}",
+            first ? "" : ",", c->fd, (unsigned long)((now_us - c->connected_us) / 1000000),
+            (unsigned long)c->sent, (unsigned long)c->dropped, (unsigned long)c->replayed,
+            (unsigned long)c->filtered, (unsigned long)c->types, (unsigned long)(head - c->next_seq),
+            (unsigned long)c->stalls, (unsigned long)(c->sent ? c->latency_total_us / c->sent : 0), (unsigned long)c->latency_max_us);
+        first = false;
+    }
+    if (len < (int)size) snprintf(response + len, size - len, "]}");
+
+    esp_err_t err = http_reply_json(req, response);
+    free(response);
+    return err;
 }
 
 httpd_uri_t sse_uri = {
@@ -0,0 +1,240 @@
+/**
+ * @file ha_discovery.c
+ * @brief Home Assistant MQTT discovery and retained per-value state topics
+ */
+
+#include "ha_discovery.h"
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_app_desc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "app_mqtt.h"
+#include "settings.h"
+#include "../esp_as3935/include/as3935.h"
+
+static const char *TAG = "ha_discovery";
+
+#define HA_DISCOVERY_TASK_PRIORITY      (3)     // below the pipeline publishers
+#define HA_DISCOVERY_TASK_STACK_SIZE    (3072)
+#define HA_DISCOVERY_NOISE_NS           "as3935_cfg"
+#define HA_DISCOVERY_NOISE_KEY          "noise_lvl"
+#define HA_DISCOVERY_NOISE_DEFAULT      (2)     // as3935_adapter default
+#define HA_DISCOVERY_OUT_OF_RANGE       (0x3F)
+
+#define HA_DISCOVERY_NOTIFY_CONNECT     (1u << 0)
+#define HA_DISCOVERY_NOTIFY_STATE       (1u << 1)
+
+typedef enum {
+    HA_ENTITY_DISTANCE = 0,
+    HA_ENTITY_ENERGY,
+    HA_ENTITY_STRIKES,
+    HA_ENTITY_STORM,
+    HA_ENTITY_NOISE_LEVEL,
+    HA_ENTITY_COUNT
+} ha_entity_t;
+
+/**
+ * @brief Entities, with their discovery fields in the abbreviated form Home Assistant accepts
+ */
+static const struct {
+    const char *id;         // state topic level and unique_id suffix
+    const char *name;
+    const char *fields;     // entity specific config fields
+} g_entities[HA_ENTITY_COUNT] = {
+    { "distance",    "Lightning distance",
+      "\"unit_of_meas\":\"km\",\"dev_cla\":\"distance\",\"stat_cla\":\"measurement\",\"ic\":\"mdi:map-marker-distance\"" },
+    { "energy",      "Lightning energy",
+      "\"stat_cla\":\"measurement\",\"ic\":\"mdi:flash\"" },
+    { "strikes",     "Lightning strikes",
+      "\"stat_cla\":\"total_increasing\",\"ic\":\"mdi:weather-lightning\"" },
+    { "storm",       "Storm",
+      "\"dev_cla\":\"enum\",\"ops\":[\"clear\",\"active\",\"overhead\"],\"ic\":\"mdi:weather-lightning-rainy\"" },
+    { "noise_level", "Noise floor level",
+      "\"stat_cla\":\"measurement\",\"ent_cat\":\"diagnostic\",\"ic\":\"mdi:waveform\"" },
+};
+
+// built on the task at connect time, published from there on
+static char g_state_topics[HA_ENTITY_COUNT][HA_DISCOVERY_TOPIC_MAX];
+static char g_config_topics[HA_ENTITY_COUNT][HA_DISCOVERY_TOPIC_MAX];
+static char g_configs[HA_ENTITY_COUNT][HA_DISCOVERY_CONFIG_MAX];
+static bool g_ready = false;        // discovery enabled and the topics built for this connection
+
+static portMUX_TYPE g_lock = portMUX_INITIALIZER_UNLOCKED;  // values and masks below
+static uint32_t g_values[HA_ENTITY_COUNT];
+static uint32_t g_known = 0;        // entities with a value
+static uint32_t g_dirty = 0;        // entities whose state topic is out of date
+
+static TaskHandle_t g_task = NULL;
+
+/**
+ * @brief Sets an entity value, or adds to it; marks the state topic dirty when the value changed
+ */
+static void ha_discovery_update(ha_entity_t entity, uint32_t value, bool add) {
+    const uint32_t bit = 1u << entity;
+    bool changed = false;
+
+    taskENTER_CRITICAL(&g_lock);
+    if (add) value += g_values[entity];
+    if (!(g_known & bit) || g_values[entity] != value) {
+        g_values[entity] = value;
+        g_known |= bit;
+        g_dirty |= bit;
+        changed = true;
+    }
+    taskEXIT_CRITICAL(&g_lock);
+
+    if (changed && g_task) {
+        xTaskNotify(g_task, HA_DISCOVERY_NOTIFY_STATE, eSetBits);
+    }
+}
+
+static void ha_discovery_load_noise_level(void) {
+    const settings_snapshot_t *snap = settings_snapshot_acquire();
+    int32_t level = HA_DISCOVERY_NOISE_DEFAULT;
+    if (settings_snapshot_get_i32(snap, HA_DISCOVERY_NOISE_NS, HA_DISCOVERY_NOISE_KEY, &level) != ESP_OK ||
+        level < 0 || level > 7) {
+        level = HA_DISCOVERY_NOISE_DEFAULT;
+    }
+    settings_snapshot_release(snap);
+    ha_discovery_update(HA_ENTITY_NOISE_LEVEL, (uint32_t)level, false);
+}
+
+static void ha_discovery_noise_changed(const char *ns, const char *key, void *arg) {
+    ha_discovery_load_noise_level();
+}
+
+/**
+ * @brief Builds the topics and discovery payloads for this connection and publishes the configs
+ * @return false when discovery is disabled
+ */
+static bool ha_discovery_announce(void) {
+    char base[HA_DISCOVERY_TOPIC_MAX];
+    char prefix[64];
+    char availability[HA_DISCOVERY_TOPIC_MAX];
+
+    const settings_snapshot_t *snap = settings_snapshot_acquire();
+    const char *enabled = settings_snapshot_get_str(snap, "mqtt", "ha_discovery");
+    const char *topic = settings_snapshot_get_str(snap, "mqtt", "topic");
+    const char *prefix_setting = settings_snapshot_get_str(snap, "mqtt", "ha_prefix");
+    const char *availability_setting = settings_snapshot_get_str(snap, "mqtt", "availability_topic");
+    const bool on = enabled && enabled[0] == '1';
+    event_pipeline_topic(topic ? topic : "as3935/lightning", "state", base, sizeof(base));
+    strlcpy(prefix, prefix_setting && prefix_setting[0] ? prefix_setting : HA_DISCOVERY_PREFIX_DEFAULT, sizeof(prefix));
+    strlcpy(availability, availability_setting && availability_setting[0] ? availability_setting : "as3935/availability",
+            sizeof(availability));
+    settings_snapshot_release(snap);
+    if (!on) return false;
+
+    uint8_t mac[6] = { 0 };
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    char node[24];
+    snprintf(node, sizeof(node), "as3935_%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    const esp_app_desc_t *app = esp_app_get_description();
+
+    int published = 0;
+    for (int e = 0; e < HA_ENTITY_COUNT; e++) {
+        snprintf(g_state_topics[e], sizeof(g_state_topics[e]), "%s/%s", base, g_entities[e].id);
+        snprintf(g_config_topics[e], sizeof(g_config_topics[e]), "%s/sensor/%s/%s/config", prefix, node, g_entities[e].id);
+        const int n = snprintf(g_configs[e], sizeof(g_configs[e]),
+            "{\"~\":\"%s\",\"name\":\"%s\",\"uniq_id\":\"%s_%s\",\"stat_t\":\"~/%s\",\"avty_t\":\"%s\",%s,"
+            "\"dev\":{\"ids\":[\"%s\"],\"name\":\"AS3935 Lightning Detector\",\"mdl\":\"AS3935\",\"sw\":\"%s\"}}",
+            base, g_entities[e].name, node, g_entities[e].id, g_entities[e].id, availability, g_entities[e].fields,
+            node, app->version);
+        if (n >= (int)sizeof(g_configs[e])) {
+            ESP_LOGW(TAG, "Discovery config for %s does not fit, topics too long", g_entities[e].id);
+            continue;
+        }
+        if (mqtt_publish_retained(g_config_topics[e], g_configs[e]) == ESP_OK) published++;
+    }
+    ESP_LOGI(TAG, "Published %d of %d discovery configs under %s/sensor/%s", published, HA_ENTITY_COUNT, prefix, node);
+
+    // the broker may hold values from before a reboot, send every known one
+    taskENTER_CRITICAL(&g_lock);
+    g_dirty = g_known;
+    taskEXIT_CRITICAL(&g_lock);
+    return true;
+}
+
+/**
+ * @brief Publishes the dirty state topics; a failed one stays dirty for the next attempt
+ */
+static void ha_discovery_flush(void) {
+    for (int e = 0; e < HA_ENTITY_COUNT && mqtt_is_connected(); e++) {
+        const uint32_t bit = 1u << e;
+
+        taskENTER_CRITICAL(&g_lock);
+        const bool dirty = g_dirty & bit;
+        const uint32_t value = g_values[e];
+        g_dirty &= ~bit;
+        taskEXIT_CRITICAL(&g_lock);
+        if (!dirty) continue;
+
+        char payload[16];
+        if (e == HA_ENTITY_STORM) {
+            strlcpy(payload, storm_tracker_state_name((storm_tracker_state_t)value), sizeof(payload));
+        } else {
+            snprintf(payload, sizeof(payload), "%lu", (unsigned long)value);
+        }
+        if (mqtt_publish_retained(g_state_topics[e], payload) != ESP_OK) {
+            taskENTER_CRITICAL(&g_lock);
+            g_dirty |= bit;
+            taskEXIT_CRITICAL(&g_lock);
+        }
+    }
+}
+
+static void ha_discovery_task(void *pvParameters) {
+    for (;;) {
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+
+        if (bits & HA_DISCOVERY_NOTIFY_CONNECT) {
+            g_ready = ha_discovery_announce();
+        }
+        if (g_ready) {
+            ha_discovery_flush();
+        }
+    }
+}
+
+esp_err_t ha_discovery_init(void) {
+    if (g_task) return ESP_OK;
+
+    if (xTaskCreate(ha_discovery_task, "ha_discovery", HA_DISCOVERY_TASK_STACK_SIZE, NULL,
+                    HA_DISCOVERY_TASK_PRIORITY, &g_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create discovery task");
+        g_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    storm_tracker_summary_t storm;
+    storm_tracker_get_summary(&storm);
+    ha_discovery_update(HA_ENTITY_STORM, storm.state, false);
+    ha_discovery_update(HA_ENTITY_STRIKES, 0, true);
+    ha_discovery_load_noise_level();
+    if (mqtt_is_connected()) ha_discovery_connected();    // connected before we were ready
+    return settings_subscribe(HA_DISCOVERY_NOISE_NS, HA_DISCOVERY_NOISE_KEY, ha_discovery_noise_changed, NULL);
+}
+
+void ha_discovery_connected(void) {
+    if (g_task) {
+        xTaskNotify(g_task, HA_DISCOVERY_NOTIFY_CONNECT, eSetBits);
+    }
+}
+
+void ha_discovery_record(const event_pipeline_record_t *record) {
+    if (!record || record->event_id != AS3935_INT_LIGHTNING) return;
+
+    if (record->distance_km < HA_DISCOVERY_OUT_OF_RANGE) {
+        ha_discovery_update(HA_ENTITY_DISTANCE, record->distance_km, false);
+    }
+    ha_discovery_update(HA_ENTITY_ENERGY, record->energy, false);
+    ha_discovery_update(HA_ENTITY_STRIKES, 1, true);
+}
+
+void ha_discovery_storm(storm_tracker_state_t state) {
+    ha_discovery_update(HA_ENTITY_STORM, (uint32_t)state, false);
+}
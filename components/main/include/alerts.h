@@ -0,0 +1,55 @@
+/**
+ * @file alerts.h
+ * @brief Rule-based storm alerts evaluated on the device
+ *
+ * Rules are read from the "as3935_cfg" / "alert_rules" setting, a list of
+ * name:condition pairs separated by ';'.  Names are made of letters, digits,
+ * '_' and '-'.  A condition is one or more terms joined by '&', each
+ * comparing a storm field with a constant:
+ *
+ *     severe:distance<=10&trend=approaching;busy:rate>=2;all_clear:clear>=30
+ *
+ * Fields come from the storm tracker: distance (nearest strike in the window,
+ * km), rate (strikes per minute), strikes (strikes in the window), trend
+ * (approaching, steady, receding or unknown, '=' only) and clear (minutes
+ * since the last strike).  Operators are <, <=, >, >= and =.
+ *
+ * The text is compiled once, when the setting changes, into a flat table of
+ * terms.  The table is evaluated after every lightning strike on the pipeline
+ * formatter task and every ALERTS_TICK_MS while a rule can still change
+ * without a new strike.  When a rule's condition becomes true or false an
+ * "alert" event with state "raised" or "cleared" is published on MQTT
+ * (<base>/alert) and SSE.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+// Forward-declare httpd request type to avoid ordering issues
+typedef struct httpd_req httpd_req_t;
+
+#define ALERTS_RULES_MAX        (8)
+#define ALERTS_TERMS_MAX        (24)    // terms of all rules together
+#define ALERTS_NAME_MAX         (16)
+#define ALERTS_CONDITION_MAX    (64)
+#define ALERTS_SOURCE_MAX       (256)   // rule text length
+#define ALERTS_TICK_MS          (60000)
+
+#define ALERTS_DEFAULT_RULES    "severe:distance<=10&trend=approaching;warning:distance<=20;" \
+                                "active:rate>=1;all_clear:clear>=30"
+
+/**
+ * @brief Compile the configured rules and subscribe to changes of the setting
+ */
+esp_err_t alerts_init(void);
+
+/**
+ * @brief Evaluate every rule against the current storm state; called after each strike
+ */
+void alerts_evaluate(void);
+
+/* HTTP handlers */
+esp_err_t alerts_get_handler(httpd_req_t *req);
+esp_err_t alerts_rules_handler(httpd_req_t *req);
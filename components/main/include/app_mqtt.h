@@ -1,5 +1,6 @@
 #pragma once
 #include <stdbool.h>
+#include <stddef.h>
 #include <esp_err.h>
 
 // Forward-declare httpd request type to avoid ordering issues
@@ -16,6 +17,10 @@ typedef struct {
 
 esp_err_t mqtt_init(const mqtt_config_t *cfg);
 esp_err_t mqtt_publish(const char *topic, const char *payload);
+// Same as mqtt_publish, but the broker keeps the message for new subscribers
+esp_err_t mqtt_publish_retained(const char *topic, const char *payload);
+// Binary payload of len bytes, not retained
+esp_err_t mqtt_publish_bin(const char *topic, const void *data, size_t len);
 bool mqtt_is_connected(void);
 void mqtt_stop(void);
 
@@ -123,6 +123,17 @@ esp_err_t as3935_save_addr_nvs(int i2c_addr);
  */
 esp_err_t as3935_load_addr_nvs(int *i2c_addr);
 
+/**
+ * @brief Command cores shared by the HTTP handlers and the MQTT command topics.
+ * Each writes the JSON reply into out and returns what snprintf returns.
+ */
+// Validate and apply a settings patch (PUT /api/as3935/settings body), NULL only reports the settings
+int as3935_settings_command(const char *patch, char *out, size_t len);
+// Read one register, body is {"reg":N}; 0x03 is served from the register shadow as reading it clears the interrupt
+int as3935_register_read_command(const char *body, char *out, size_t len);
+// Register shadow dump, no I2C traffic
+int as3935_registers_json(char *out, size_t len);
+
 /**
  * @brief HTTP Handlers
  */
@@ -140,6 +151,8 @@ esp_err_t as3935_calibrate_apply_handler(httpd_req_t *req);
 esp_err_t as3935_register_read_handler(httpd_req_t *req);
 esp_err_t as3935_register_write_handler(httpd_req_t *req);
 esp_err_t as3935_registers_all_handler(httpd_req_t *req);
+esp_err_t as3935_bus_stats_handler(httpd_req_t *req);
+esp_err_t as3935_irq_stats_handler(httpd_req_t *req);
 esp_err_t as3935_post_handler(httpd_req_t *req);
 esp_err_t as3935_reg_read_handler(httpd_req_t *req);
 
@@ -152,6 +165,7 @@ esp_err_t as3935_spike_rejection_handler(httpd_req_t *req);
 esp_err_t as3935_min_strikes_handler(httpd_req_t *req);
 esp_err_t as3935_disturber_handler(httpd_req_t *req);
 esp_err_t as3935_watchdog_handler(httpd_req_t *req);
+esp_err_t as3935_settings_handler(httpd_req_t *req);
 esp_err_t as3935_reboot_handler(httpd_req_t *req);
 
 /**
@@ -0,0 +1,45 @@
+/**
+ * @file cbor_writer.h
+ * @brief Streaming CBOR (RFC 8949) encoder into a caller buffer
+ *
+ * Items are appended in order with definite lengths, so maps and arrays take
+ * their element count up front.  Nothing is allocated: a write that does not
+ * fit sets the overflow flag, every later write is ignored and
+ * cbor_writer_finish() returns 0.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    uint8_t *buf;
+    size_t   size;
+    size_t   len;
+    bool     overflow;
+} cbor_writer_t;
+
+void cbor_writer_init(cbor_writer_t *w, uint8_t *buf, size_t size);
+
+void cbor_put_uint(cbor_writer_t *w, uint64_t value);
+void cbor_put_int(cbor_writer_t *w, int64_t value);
+void cbor_put_bytes(cbor_writer_t *w, const void *data, size_t len);
+void cbor_put_text(cbor_writer_t *w, const char *text);
+void cbor_put_bool(cbor_writer_t *w, bool value);
+void cbor_put_null(cbor_writer_t *w);
+
+/**
+ * @brief Start an array of count items
+ */
+void cbor_put_array(cbor_writer_t *w, size_t count);
+
+/**
+ * @brief Start a map of count key / value pairs
+ */
+void cbor_put_map(cbor_writer_t *w, size_t count);
+
+/**
+ * @brief Encoded length, 0 if the buffer overflowed
+ */
+size_t cbor_writer_finish(const cbor_writer_t *w);
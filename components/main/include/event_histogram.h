@@ -0,0 +1,69 @@
+/**
+ * @file event_histogram.h
+ * @brief Rolling 1 h / 24 h distributions of AS3935 events
+ *
+ * Each window is a ring of time slices (12 x 5 min, 24 x 1 h) holding the
+ * lightning energy histogram (log2 buckets over the 21-bit range), the
+ * distance estimate histogram and the lightning / disturber / noise counts.
+ * An event increments one counter per histogram in the current slice of each
+ * window; a slice left over from an earlier turn of the ring is cleared when
+ * it is reused, so no timer runs to age the windows and idle periods cost
+ * nothing.  Reading a window sums its live slices.
+ *
+ * A summary of both windows is published as a retained MQTT message on
+ * <base>/histogram (and a "histogram" SSE event) EVENT_HISTOGRAM_SUMMARY_MS
+ * after the first event that follows the previous summary, so nothing is
+ * published while the sensor is quiet.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <esp_err.h>
+#include "event_pipeline.h"
+
+// Forward-declare httpd request type to avoid ordering issues
+typedef struct httpd_req httpd_req_t;
+
+#define EVENT_HISTOGRAM_ENERGY_BUCKETS      (22)        // 0, then [2^(i-1), 2^i) up to 2^21
+#define EVENT_HISTOGRAM_DISTANCE_BUCKETS    (16)        // AS3935 distance estimates, out of range last
+#define EVENT_HISTOGRAM_SUMMARY_MS          (900000)    // MQTT summary delay after the first new event
+
+/**
+ * @brief Windows kept
+ */
+typedef enum {
+    EVENT_HISTOGRAM_1H = 0,
+    EVENT_HISTOGRAM_24H,
+    EVENT_HISTOGRAM_WINDOW_MAX
+} event_histogram_window_t;
+
+/**
+ * @brief Totals of one window
+ */
+typedef struct {
+    uint32_t lightning;
+    uint32_t disturber;
+    uint32_t noise;
+    uint32_t energy[EVENT_HISTOGRAM_ENERGY_BUCKETS];        // lightning only
+    uint32_t distance[EVENT_HISTOGRAM_DISTANCE_BUCKETS];    // lightning only
+} event_histogram_t;
+
+/**
+ * @brief Create the summary timer
+ */
+esp_err_t event_histogram_init(void);
+
+/**
+ * @brief Count one event; called on the pipeline formatter task
+ */
+void event_histogram_add(const event_pipeline_record_t *record);
+
+/**
+ * @brief Sum the live slices of one window
+ */
+void event_histogram_get(event_histogram_window_t window, event_histogram_t *out);
+
+const char *event_histogram_window_name(event_histogram_window_t window);
+
+/* HTTP handlers */
+esp_err_t event_histogram_handler(httpd_req_t *req);
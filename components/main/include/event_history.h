@@ -0,0 +1,75 @@
+/**
+ * @file event_history.h
+ * @brief Fixed-memory history of AS3935 events, written by the monitor task and queried over HTTP
+ *
+ * Records live in a preallocated ring of EVENT_HISTORY_DEPTH slots; the oldest
+ * record is overwritten when the ring is full.  The writer (the monitor task)
+ * never blocks or allocates: each slot carries a seqlock counter that is odd
+ * while the slot is being written, and readers copy a slot and retry if the
+ * counter moved underneath them.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+// Forward-declare httpd request type to avoid ordering issues
+typedef struct httpd_req httpd_req_t;
+
+#ifndef EVENT_HISTORY_DEPTH
+#define EVENT_HISTORY_DEPTH         (256)       // records kept, power of two
+#endif
+#define EVENT_HISTORY_ENERGY_MAX    (0x1FFFFF)  // 21-bit lightning energy
+#define EVENT_HISTORY_QUERY_LIMIT   (100)       // default ?limit= of the history endpoint
+
+/**
+ * @brief Event types stored in a record
+ */
+typedef enum {
+    EVENT_HISTORY_UNKNOWN = 0,
+    EVENT_HISTORY_LIGHTNING,
+    EVENT_HISTORY_DISTURBER,
+    EVENT_HISTORY_NOISE,
+    EVENT_HISTORY_TYPE_MAX
+} event_history_type_t;
+
+/**
+ * @brief Compact binary event record (24 bytes)
+ */
+typedef struct {
+    int64_t  timestamp_us;      // esp_timer time of the interrupt edge
+    uint32_t id;                // 1 for the first record after boot, then increasing
+    uint32_t energy      : 21;  // lightning energy, 0 for other types
+    uint32_t type        : 3;   // event_history_type_t
+    uint32_t distance_km : 8;   // lightning distance, 0x3f when out of range
+    uint8_t  r0;                // AFE gain register snapshot
+    uint8_t  r1;                // noise floor / watchdog register snapshot
+    uint8_t  r3;                // interrupt / LCO register snapshot
+    uint8_t  r8;                // tuning capacitor register snapshot
+} event_history_record_t;
+
+/**
+ * @brief Append one record from the single writer; assigns and returns its id.
+ * Never blocks and never allocates.
+ */
+uint32_t event_history_append(event_history_record_t *record);
+
+/**
+ * @brief Copy the record with the given id
+ * @return ESP_ERR_NOT_FOUND if it was never written or has been overwritten
+ */
+esp_err_t event_history_get(uint32_t id, event_history_record_t *out);
+
+/**
+ * @brief Id of the newest record, 0 while the history is empty
+ */
+uint32_t event_history_last_id(void);
+
+/**
+ * @brief Name of a type, e.g. "lightning"
+ */
+const char *event_history_type_name(event_history_type_t type);
+
+/* HTTP handlers */
+esp_err_t event_history_handler(httpd_req_t *req);
@@ -0,0 +1,76 @@
+/**
+ * @file event_log.h
+ * @brief Persistent append-only log of AS3935 events in the "evlog" data partition
+ *
+ * The partition is used as a ring of 4 KiB sectors.  Each sector starts with
+ * a header carrying a sequence number that increases every time a sector is
+ * erased and reopened, so the oldest and newest sectors are found at boot from
+ * the headers alone and every sector is erased once per trip round the ring.
+ * Records are written in CRC-protected blocks of up to one flash page, delta
+ * and varint encoded (typically 3-8 bytes per record instead of 16): the
+ * writer task collects events from the in-RAM history and writes a block when
+ * a page is full or EVENT_LOG_FLUSH_MS after the first pending event.  The
+ * sensor side only notifies the writer task and never waits on flash.
+ *
+ * Every stored record gets a log sequence number (lsn) that keeps increasing
+ * across reboots.  Timestamps are stored as Unix time once SNTP has set the
+ * clock, otherwise as time since boot.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+// Forward-declare httpd request type to avoid ordering issues
+typedef struct httpd_req httpd_req_t;
+
+#define EVENT_LOG_PARTITION_LABEL   "evlog"
+#define EVENT_LOG_PARTITION_SUBTYPE (0x40)      // custom data subtype in partitions.csv
+#define EVENT_LOG_SECTOR_SIZE       (4096)
+#define EVENT_LOG_PAGE_SIZE         (256)       // flash program page, the largest block written at once
+#define EVENT_LOG_MAX_SECTORS       (256)       // sectors indexed in RAM, 1 MiB partition at most
+#define EVENT_LOG_FLUSH_MS          (30000)     // write a partly filled page after this long
+#define EVENT_LOG_QUERY_LIMIT       (500)       // default ?limit= of the export endpoint
+
+/**
+ * @brief Log counters, including the boot-time recovery scan
+ */
+typedef struct {
+    uint32_t sectors;           // sectors in the partition
+    uint32_t sectors_used;      // sectors holding a valid header
+    uint32_t first_lsn;         // oldest record still stored
+    uint32_t next_lsn;          // lsn the next record will get
+    uint32_t pending;           // records collected but not yet written
+    uint32_t blocks_written;    // flash writes since boot
+    uint32_t records_written;   // records in those blocks
+    uint32_t bytes_written;     // flash bytes written since boot
+    uint32_t sector_erases;     // sectors erased since boot
+    uint32_t lost;              // events overwritten in the RAM history before they were persisted
+    uint32_t write_failures;    // blocks that could not be written
+    uint32_t corrupt_blocks;    // blocks with a bad CRC found at boot or during export
+    uint32_t recovery_us;       // duration of the boot-time scan
+    uint32_t recovery_reads;    // flash reads made by the boot-time scan
+} event_log_stats_t;
+
+/**
+ * @brief Find the partition, rebuild the sector index and start the writer task
+ * @return ESP_ERR_NOT_FOUND when the partition table has no evlog partition
+ */
+esp_err_t event_log_init(void);
+
+/**
+ * @brief Tell the writer task that new events are in the history; never blocks
+ */
+void event_log_notify(void);
+
+/**
+ * @brief Write pending records now (reboot, OTA)
+ */
+esp_err_t event_log_flush(void);
+
+void event_log_get_stats(event_log_stats_t *stats);
+
+/* HTTP handlers */
+esp_err_t event_log_export_handler(httpd_req_t *req);
+esp_err_t event_log_stats_handler(httpd_req_t *req);
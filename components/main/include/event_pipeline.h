@@ -0,0 +1,167 @@
+/**
+ * @file event_pipeline.h
+ * @brief Staged AS3935 event pipeline: monitor task -> SPSC ring -> formatter -> MQTT / SSE workers
+ *
+ * The monitor task only copies a compact binary record into a bounded
+ * single-producer ring and returns to the sensor.  A formatter task drains the
+ * ring, builds the JSON payload once into a pooled frame and hands the frame to
+ * one queue per publisher.  Each publisher runs in its own task, so a slow
+ * broker or browser only backs up its own queue.  No stage ever blocks the
+ * stage before it: a full ring or queue drops the event for that stage and
+ * counts it.
+ *
+ * With "mqtt" / "batch_window_ms" set, a sensor event that arrives within the
+ * window of the previous one opens a batch instead of being published; the
+ * events that follow join it until the window ends or "mqtt" / "batch_max"
+ * events are collected, and the batch goes out as one JSON array on
+ * <base>/batch.  An isolated event is still published at once.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+// Forward-declare httpd request type to avoid ordering issues
+typedef struct httpd_req httpd_req_t;
+
+#define EVENT_PIPELINE_RING_SIZE        (16)    // monitor -> formatter ring, power of two
+#define EVENT_PIPELINE_FRAME_COUNT      (8)     // formatted frames shared by the publisher stages
+#define EVENT_PIPELINE_STAGE_DEPTH      (6)     // per-publisher queue depth
+#define EVENT_PIPELINE_PAYLOAD_MAX      (768)   // formatted JSON payload size
+#define EVENT_PIPELINE_BATCH_EVENTS     (16)    // most sensor events in one MQTT batch
+#define EVENT_PIPELINE_BATCH_WINDOW_MAX (60000) // longest batch window, ms
+#define EVENT_PIPELINE_CBOR_MAX         (64)    // CBOR payload size, about 45 bytes used
+
+/*
+ * CBOR payload, published on <base>/cbor when "mqtt" / "cbor" is "1".
+ * A map with unsigned integer keys; keys are never renumbered, new ones are
+ * only added, and a decoder must skip keys it does not know.
+ */
+#define EVENT_PIPELINE_CBOR_VERSION         (1)
+#define EVENT_PIPELINE_CBOR_KEY_VERSION     (0)     // uint, EVENT_PIPELINE_CBOR_VERSION
+#define EVENT_PIPELINE_CBOR_KEY_TYPE        (1)     // uint, EVENT_PIPELINE_CBOR_TYPE_*
+#define EVENT_PIPELINE_CBOR_KEY_SEQ         (2)     // uint, pipeline sequence number
+#define EVENT_PIPELINE_CBOR_KEY_IRQ_US      (3)     // int, esp_timer time of the interrupt
+#define EVENT_PIPELINE_CBOR_KEY_EPOCH_US    (4)     // int, Unix time in us, only once SNTP has set the clock
+#define EVENT_PIPELINE_CBOR_KEY_DISTANCE    (5)     // uint, km, lightning only, 63 when out of range
+#define EVENT_PIPELINE_CBOR_KEY_ENERGY      (6)     // uint, lightning only
+#define EVENT_PIPELINE_CBOR_KEY_REGS        (7)     // bytes, r0 r1 r3 r8
+#define EVENT_PIPELINE_CBOR_KEY_EVENT_ID    (8)     // uint, raw interrupt state, unknown events only
+
+#define EVENT_PIPELINE_CBOR_TYPE_UNKNOWN    (0)     // same numbering as the event log
+#define EVENT_PIPELINE_CBOR_TYPE_LIGHTNING  (1)
+#define EVENT_PIPELINE_CBOR_TYPE_DISTURBER  (2)
+#define EVENT_PIPELINE_CBOR_TYPE_NOISE      (3)
+
+/**
+ * @brief Compact binary event record, as produced by the monitor task
+ */
+typedef struct {
+    int64_t  irq_timestamp_us;  // esp_timer time of the interrupt edge
+    uint32_t seq;               // pipeline sequence number, assigned on submit
+    uint32_t energy;            // lightning energy, 0 for other sources
+    uint8_t  event_id;          // AS3935 interrupt state, 200 when unknown
+    uint8_t  distance_km;       // lightning distance, 0x3f when out of range
+    uint8_t  r0;                // AFE gain register snapshot
+    uint8_t  r1;                // noise floor / watchdog register snapshot
+    uint8_t  r3;                // interrupt / LCO register snapshot
+    uint8_t  r8;                // tuning capacitor register snapshot
+} event_pipeline_record_t;
+
+/**
+ * @brief Pipeline stages
+ */
+typedef enum {
+    EVENT_PIPELINE_STAGE_RING = 0,  // monitor -> formatter
+    EVENT_PIPELINE_STAGE_MQTT,      // formatter -> MQTT publisher
+    EVENT_PIPELINE_STAGE_SSE,       // formatter -> SSE broadcaster
+    EVENT_PIPELINE_STAGE_MAX
+} event_pipeline_stage_t;
+
+/**
+ * @brief Per-stage counters
+ */
+typedef struct {
+    uint32_t enqueued;      // events accepted into the stage
+    uint32_t dropped;       // events refused because the stage was full
+    uint32_t processed;     // events completed by the stage worker
+    uint32_t failed;        // events the stage worker could not deliver
+    uint32_t skipped;       // events deferred because the sink was unavailable (MQTT: queued in the outbox)
+    uint32_t depth_max;     // deepest backlog observed
+} event_pipeline_stage_stats_t;
+
+/**
+ * @brief Pipeline statistics snapshot
+ */
+typedef struct {
+    event_pipeline_stage_stats_t stages[EVENT_PIPELINE_STAGE_MAX];
+    uint32_t frames_exhausted;  // events dropped by the formatter for lack of a free frame
+    uint32_t latency_max_us;    // longest interrupt-to-formatted delay observed
+    uint32_t mqtt_batches;      // MQTT batch messages published
+    uint32_t mqtt_batched;      // sensor events carried by them
+} event_pipeline_stats_t;
+
+/**
+ * @brief Record hook, called on the formatter task for every record
+ */
+typedef void (*event_pipeline_record_cb_t)(const event_pipeline_record_t *record);
+
+/**
+ * @brief Create the ring, frame pool, stage queues and worker tasks (idempotent)
+ */
+esp_err_t event_pipeline_init(void);
+
+/**
+ * @brief Submit one record from the single producer (the monitor task).
+ * Never blocks; returns ESP_ERR_NO_MEM and counts a drop when the ring is full.
+ */
+esp_err_t event_pipeline_submit(const event_pipeline_record_t *record);
+
+/**
+ * @brief Publish an event derived on the device (storm state, alerts) through
+ * the same MQTT / SSE stages as sensor events.  Never blocks.
+ * @param event_type SSE event name, static string
+ * @param topic_leaf MQTT topic level under the base topic, static string, e.g. "storm"
+ * @param payload JSON payload, copied
+ * @param retain publish as a retained MQTT message
+ * @return ESP_ERR_NO_MEM when no frame is free
+ */
+esp_err_t event_pipeline_publish(const char *event_type, const char *topic_leaf, const char *payload, bool retain);
+
+/**
+ * @brief Install a hook invoked on the formatter task for each record, after
+ * the record has been handed to the publishers
+ */
+void event_pipeline_set_record_cb(event_pipeline_record_cb_t cb);
+
+/**
+ * @brief Copy the current counters
+ */
+void event_pipeline_get_stats(event_pipeline_stats_t *stats);
+
+/**
+ * @brief Converts an esp_timer interrupt timestamp to wall-clock microseconds
+ * since the Unix epoch, 0 while the clock has not been set by SNTP
+ */
+int64_t event_pipeline_timestamp_to_epoch_us(int64_t irq_timestamp_us);
+
+/**
+ * @brief Encodes a record in the CBOR schema above into buf, no heap
+ * @return encoded length, 0 if it did not fit
+ */
+size_t event_pipeline_format_cbor(const event_pipeline_record_t *record, uint8_t *buf, size_t len);
+
+/**
+ * @brief Builds "<base>/<leaf>", where base is the event topic without its last level
+ */
+void event_pipeline_topic(const char *event_topic, const char *leaf, char *topic, size_t len);
+
+/**
+ * @brief Name of a stage, e.g. "mqtt"
+ */
+const char *event_pipeline_stage_name(event_pipeline_stage_t stage);
+
+/* HTTP handlers */
+esp_err_t event_pipeline_stats_handler(httpd_req_t *req);
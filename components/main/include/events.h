@@ -1,6 +1,48 @@
 #pragma once
 #include "esp_http_server.h"
 
+/*
+ * Server-Sent Events fan-out.  events_broadcast() formats the frame once into a
+ * shared ring and schedules one drain on the HTTP server's work queue, so its
+ * cost does not depend on the number of clients.  The drain runs on the server
+ * task and sends each client the frames it has not seen yet.  A client that
+ * falls more than EVENTS_CLIENT_BACKLOG frames behind loses its oldest frames.
+ * Sends never block: what a full socket does not take is resent on the next
+ * drain or keepalive, and a client that takes nothing for EVENTS_STALL_MS is
+ * closed.
+ *
+ * Subscribers hold a session socket but no server task: the stream handler
+ * returns after the headers and later frames are written to the socket.
+ *
+ * Every frame carries an SSE id.  The ring doubles as history: a client that
+ * reconnects with Last-Event-ID gets the frames it missed, as far back as the
+ * ring reaches, in one write before it goes live.
+ */
+
+/*
+ * Socket budget, out of CONFIG_LWIP_MAX_SOCKETS (40):
+ *   EVENTS_MAX_CLIENTS         SSE clients, each holds its session socket
+ *   EVENTS_HTTP_SOCKETS        plain requests from the UI and API next to the streams
+ *   EVENTS_HTTPD_RESERVED      httpd's own listen and control sockets; httpd_start
+ *                              demands max_open_sockets <= LWIP_MAX_SOCKETS - 3
+ *   EVENTS_OTHER_RESERVED      MQTT client, OTA download, captive portal DNS, one spare
+ * EVENTS_OPEN_SOCKETS is the web server's max_open_sockets; what the budget
+ * leaves over stays free for whatever else opens a socket.
+ */
+#define EVENTS_MAX_CLIENTS      (16)    // concurrent SSE clients
+#define EVENTS_HTTP_SOCKETS     (6)     // a browser opens up to 6 connections per host
+#define EVENTS_HTTPD_RESERVED   (3)
+#define EVENTS_OTHER_RESERVED   (4)
+#define EVENTS_OPEN_SOCKETS     (EVENTS_MAX_CLIENTS + EVENTS_HTTP_SOCKETS)
+#define EVENTS_SOCKET_BUDGET    (EVENTS_OPEN_SOCKETS + EVENTS_HTTPD_RESERVED + EVENTS_OTHER_RESERVED)
+#define EVENTS_RING_SIZE        (16)    // frames kept for fan-out and replay, power of two
+#define EVENTS_CLIENT_BACKLOG   (8)     // frames a client may lag before drop-oldest
+#define EVENTS_FRAME_MAX        (1024)  // formatted SSE frame size
+#define EVENTS_CHUNK_OVERHEAD   (24)    // "id: N\n" and the chunk framing around each frame
+#define EVENTS_KEEPALIVE_MS     (10000) // comment sent to idle clients, also retries clients with a full socket
+#define EVENTS_STALL_MS         (30000) // a client whose socket takes nothing for this long is closed
+
 void events_init(void);
 void events_broadcast(const char *event, const char *data);
+esp_err_t events_clients_handler(httpd_req_t *req);
 extern httpd_uri_t sse_uri;
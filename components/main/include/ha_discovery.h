@@ -0,0 +1,54 @@
+/**
+ * @file ha_discovery.h
+ * @brief Home Assistant MQTT discovery and retained per-value state topics
+ *
+ * With "mqtt" / "ha_discovery" set to "1", every connect publishes one
+ * retained discovery config per entity on
+ * <prefix>/sensor/<node>/<entity>/config, where prefix is "mqtt" /
+ * "ha_prefix" (default "homeassistant") and node is "as3935_" followed by
+ * the station MAC.  The configs point at retained state topics under the
+ * event topic base:
+ *
+ *   <base>/state/distance      last in-range strike distance, km
+ *   <base>/state/energy        last strike energy
+ *   <base>/state/strikes       strikes since boot
+ *   <base>/state/storm         clear, active or overhead
+ *   <base>/state/noise_level   configured noise floor level, 0-7
+ *
+ * Topics and discovery payloads are built once per connect into static
+ * buffers.  Afterwards a value that changes only marks its topic dirty; a
+ * low-priority task publishes the dirty topics, so neither the pipeline nor
+ * the MQTT client task ever waits for the broker.  Values that change while
+ * offline are coalesced and sent with the next connect.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <esp_err.h>
+#include "event_pipeline.h"
+#include "storm_tracker.h"
+
+#define HA_DISCOVERY_PREFIX_DEFAULT "homeassistant"
+#define HA_DISCOVERY_TOPIC_MAX      (160)
+#define HA_DISCOVERY_CONFIG_MAX     (640)   // one discovery payload
+
+/**
+ * @brief Create the publisher task and pick up the noise level setting
+ */
+esp_err_t ha_discovery_init(void);
+
+/**
+ * @brief Rebuild and publish the discovery configs and every known state;
+ * called from the MQTT client on every MQTT_EVENT_CONNECTED
+ */
+void ha_discovery_connected(void);
+
+/**
+ * @brief Update the strike values; called on the pipeline formatter task for every record
+ */
+void ha_discovery_record(const event_pipeline_record_t *record);
+
+/**
+ * @brief Update the storm state; called by the storm tracker when it publishes a change
+ */
+void ha_discovery_storm(storm_tracker_state_t state);
@@ -0,0 +1,42 @@
+/**
+ * @file mqtt_cmd.h
+ * @brief Remote configuration over MQTT command topics
+ *
+ * After every connect the client subscribes to <base>/cmd/#, and to
+ * <group>/cmd/# when "mqtt" / "cmd_group" is set, so one (retained) publish
+ * on the group topic reaches a whole fleet.  The last topic level names the
+ * command, the payload is its JSON body:
+ *
+ *   settings   sensor settings patch, same body and validation as
+ *              PUT /api/as3935/settings; an empty payload only reads them
+ *   register   {"reg":N}, same as POST /api/as3935/register/read; 0x03
+ *              comes from the register shadow, never the bus
+ *   dump       sensor settings and register shadow
+ *
+ * The reply goes to <base>/resp/<command> through the event pipeline, so
+ * the client task never blocks on the broker.  A string or integer "id" in
+ * the body is echoed back for correlation.  A retained request must carry
+ * an id: it runs once per id, and is skipped when it is delivered again
+ * (reconnect, reboot) with the id it last ran with, which is kept in
+ * "mqtt" / "cmd_id_<command>".  Retained requests without an id are
+ * refused, as nothing would stop them from running on every connect.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <mqtt_client.h>
+
+#define MQTT_CMD_PAYLOAD_MAX    (512)   // longest request body
+#define MQTT_CMD_ID_MAX         (40)    // longest correlation id
+
+/**
+ * @brief Subscribe to the command topics; call on every MQTT_EVENT_CONNECTED
+ */
+void mqtt_cmd_subscribe(esp_mqtt_client_handle_t client);
+
+/**
+ * @brief Run the command addressed by a received message, if it is one.
+ * Called on the MQTT client task for every MQTT_EVENT_DATA.
+ * @param total_len full payload length; fragmented payloads are rejected
+ */
+void mqtt_cmd_handle(const char *topic, int topic_len, const char *data, int data_len, int total_len, bool retained);
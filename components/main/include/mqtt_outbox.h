@@ -0,0 +1,118 @@
+/**
+ * @file mqtt_outbox.h
+ * @brief Offline queue of MQTT messages, kept in RAM and spilled to the "mqttq" flash partition
+ *
+ * The pipeline's MQTT publisher queues every message it cannot deliver, and
+ * every message that arrives while older ones are still queued, so the broker
+ * always sees messages in order.  Messages are held in a RAM ring of
+ * MQTT_OUTBOX_RAM_SIZE bytes; when the ring is full the oldest are moved to
+ * the mqttq partition, a ring of 4 KiB sectors, and the backlog survives a
+ * reboot (RAM entries are spilled on shutdown as well).  When flash is full
+ * too, the "mqtt" / "queue_policy" setting decides whether the oldest sector
+ * ("drop_oldest", default) or the new message ("drop_newest") is dropped.
+ * Without the partition the policy applies to the RAM ring.
+ *
+ * After a reconnect the backlog is replayed oldest first, at most
+ * "mqtt" / "replay_rate" messages per second.  Only the publisher task
+ * queues and dequeues; nothing here ever waits on the broker.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "event_pipeline.h"
+
+// Forward-declare httpd request type to avoid ordering issues
+typedef struct httpd_req httpd_req_t;
+
+#define MQTT_OUTBOX_PARTITION_LABEL     "mqttq"
+#define MQTT_OUTBOX_PARTITION_SUBTYPE   (0x41)      // custom data subtype in partitions.csv
+#define MQTT_OUTBOX_SECTOR_SIZE         (4096)
+#define MQTT_OUTBOX_MAX_SECTORS         (64)
+#define MQTT_OUTBOX_RAM_SIZE            (8192)      // bytes of queued messages held in RAM
+#define MQTT_OUTBOX_TOPIC_MAX           (32)        // topic level under the base topic
+#define MQTT_OUTBOX_REPLAY_RATE         (10)        // default replay rate, messages per second
+
+typedef enum {
+    MQTT_OUTBOX_DROP_OLDEST = 0,
+    MQTT_OUTBOX_DROP_NEWEST,
+} mqtt_outbox_policy_t;
+
+/**
+ * @brief One queued message
+ */
+typedef struct {
+    bool     retain;
+    bool     binary;                                // payload is len raw bytes, e.g. CBOR
+    uint16_t len;                                   // payload bytes, without the terminator
+    char     topic_leaf[MQTT_OUTBOX_TOPIC_MAX];     // empty for the event topic
+    char     payload[EVENT_PIPELINE_PAYLOAD_MAX];   // always terminated
+} mqtt_outbox_msg_t;
+
+typedef struct {
+    uint32_t ram_pending;       // messages in the RAM ring
+    uint32_t ram_bytes;         // bytes used in the RAM ring
+    uint32_t flash_pending;     // messages waiting in flash
+    uint32_t flash_sectors;     // sectors of the mqttq partition, 0 without one
+    uint32_t oldest_age_ms;     // age of the oldest queued message, 0 when empty
+    uint32_t queued;            // messages queued since boot
+    uint32_t replayed;          // queued messages published
+    uint32_t dropped;           // messages lost to the drop policy or a failed flash write
+    uint32_t spilled;           // messages moved from RAM to flash
+    uint32_t restored;          // messages found in flash at boot
+    uint32_t sector_erases;
+    uint32_t write_failures;
+} mqtt_outbox_stats_t;
+
+/**
+ * @brief Find the partition and recover the queued messages left by the previous boot
+ */
+esp_err_t mqtt_outbox_init(void);
+
+/**
+ * @brief Queue one message behind every message already queued
+ * @param topic_leaf topic level under the base topic, NULL for the event topic
+ * @return ESP_ERR_NO_MEM when the message was dropped
+ */
+esp_err_t mqtt_outbox_push(const char *topic_leaf, bool retain, const char *payload);
+
+/**
+ * @brief Same as mqtt_outbox_push() for a binary, non-retained payload
+ * @return ESP_ERR_INVALID_ARG when len does not fit a message
+ */
+esp_err_t mqtt_outbox_push_bin(const char *topic_leaf, const void *data, size_t len);
+
+/**
+ * @brief Messages queued in RAM and flash
+ */
+uint32_t mqtt_outbox_pending(void);
+
+/**
+ * @brief Copy the oldest message without removing it
+ * @return ESP_ERR_NOT_FOUND when the queue is empty
+ */
+esp_err_t mqtt_outbox_peek(mqtt_outbox_msg_t *msg);
+
+/**
+ * @brief Remove the oldest message once it has been published
+ */
+void mqtt_outbox_pop(void);
+
+/**
+ * @brief Delay between two replayed messages, from the replay_rate setting
+ */
+uint32_t mqtt_outbox_replay_interval_ms(void);
+
+/**
+ * @brief Move the RAM ring to flash (reboot, OTA)
+ */
+esp_err_t mqtt_outbox_flush(void);
+
+void mqtt_outbox_get_stats(mqtt_outbox_stats_t *stats);
+
+const char *mqtt_outbox_policy_name(mqtt_outbox_policy_t policy);
+
+/* HTTP handlers */
+esp_err_t mqtt_outbox_stats_handler(httpd_req_t *req);
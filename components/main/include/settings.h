@@ -1,8 +1,83 @@
 #pragma once
 #include <esp_err.h>
 #include <stddef.h>
+#include <stdint.h>
+
+// Forward-declare httpd request type to avoid ordering issues
+typedef struct httpd_req httpd_req_t;
+
+/*
+ * Settings service.  The managed namespaces (wifi, mqtt, as3935_cfg) are read
+ * from NVS once in settings_init() and served from an immutable in-RAM
+ * snapshot afterwards, so reads never touch flash.  Writes update the snapshot
+ * and notify subscribers at once; NVS is written behind: changed keys are
+ * coalesced and committed together once no further change has arrived for
+ * SETTINGS_COMMIT_QUIET_MS.  settings_flush() commits immediately and also
+ * runs on esp_restart().  Other namespaces fall back to direct NVS access in
+ * the save, load and get calls; snapshots only hold the managed namespaces.
+ */
+
+#define SETTINGS_SUBSCRIBERS_MAX        (8)
+#define SETTINGS_DIRTY_MAX              (32)    // keys that may wait for a commit
+#define SETTINGS_COMMIT_QUIET_MS        (2000)  // commit after this long without changes
+#define SETTINGS_COMMIT_MAX_DELAY_MS    (10000) // but never hold a change longer than this
+#define SETTINGS_NVS_ENTRY_SIZE         (32)    // NVS entry size, used for wear accounting
+#define SETTINGS_NVS_ENTRIES_PER_PAGE   (126)   // NVS entries per 4 KiB flash page
+
+/**
+ * @brief Write-behind and flash wear counters
+ */
+typedef struct {
+    uint32_t writes;            // write requests to managed namespaces
+    uint32_t unchanged;         // writes skipped because the value was already current
+    uint32_t coalesced;         // writes that replaced a value still waiting for commit
+    uint32_t pending;           // keys waiting for the next commit
+    uint32_t commits;           // nvs_commit calls
+    uint32_t keys_written;      // keys written to flash
+    uint32_t entries_written;   // 32-byte NVS entries written
+    uint32_t bytes_written;     // flash bytes written, entries_written * 32
+    uint32_t page_erases_est;   // pages filled, each one eventually costs an erase
+    uint32_t flush_failures;    // commits that failed and will be retried
+} settings_stats_t;
+
+typedef struct settings_snapshot_s settings_snapshot_t;
+
+/**
+ * @brief Change callback, runs on the writer's task after the new snapshot is published
+ */
+typedef void (*settings_change_cb_t)(const char *ns, const char *key, void *arg);
 
 esp_err_t settings_init(void);
 esp_err_t settings_save_str(const char *ns, const char *key, const char *value);
 esp_err_t settings_load_str(const char *ns, const char *key, char *out, size_t len);
 esp_err_t settings_erase_key(const char *ns, const char *key);
+
+/* Typed accessors for integer keys */
+esp_err_t settings_save_i32(const char *ns, const char *key, int32_t value);
+esp_err_t settings_save_u8(const char *ns, const char *key, uint8_t value);
+esp_err_t settings_get_i32(const char *ns, const char *key, int32_t *out);
+esp_err_t settings_get_u8(const char *ns, const char *key, uint8_t *out);
+
+/*
+ * Snapshots: acquire a reference, read any number of keys without copying,
+ * release.  Values returned by a snapshot stay valid until it is released.
+ */
+const settings_snapshot_t *settings_snapshot_acquire(void);
+void settings_snapshot_release(const settings_snapshot_t *snap);
+uint32_t settings_snapshot_generation(const settings_snapshot_t *snap);
+const char *settings_snapshot_get_str(const settings_snapshot_t *snap, const char *ns, const char *key);
+esp_err_t settings_snapshot_get_i32(const settings_snapshot_t *snap, const char *ns, const char *key, int32_t *out);
+
+/**
+ * @brief Commit every pending change now (reboot, OTA)
+ */
+esp_err_t settings_flush(void);
+void settings_get_stats(settings_stats_t *stats);
+
+/**
+ * @brief Subscribe to changes of one key, or of a whole namespace when key is NULL
+ */
+esp_err_t settings_subscribe(const char *ns, const char *key, settings_change_cb_t cb, void *arg);
+
+/* HTTP handlers */
+esp_err_t settings_stats_handler(httpd_req_t *req);
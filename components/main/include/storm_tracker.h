@@ -0,0 +1,86 @@
+/**
+ * @file storm_tracker.h
+ * @brief On-device storm state derived from lightning strikes
+ *
+ * Strikes are kept in a fixed ring covering the last STORM_TRACKER_WINDOW_S
+ * seconds.  Everything reported is maintained incrementally as strikes enter
+ * and leave the window: strike rate, a histogram of the AS3935 distance
+ * estimates (min and median), the mean distance and the running sums of a
+ * least-squares fit of distance over time, whose slope tells whether the
+ * storm is approaching or receding.  Each strike costs O(1) time and no
+ * memory is allocated.
+ *
+ * The compact state is published as a retained "storm" message on MQTT
+ * (<base>/storm) and as a "storm" SSE event, only when the state, the trend
+ * or the min / median distance changes.  A timer ages strikes out of the
+ * window while a storm is active and is stopped once the sky is clear.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+// Forward-declare httpd request type to avoid ordering issues
+typedef struct httpd_req httpd_req_t;
+
+#ifndef STORM_TRACKER_WINDOW_S
+#define STORM_TRACKER_WINDOW_S      (1800)  // sliding window, seconds
+#endif
+#ifndef STORM_TRACKER_MAX_STRIKES
+#define STORM_TRACKER_MAX_STRIKES   (128)   // strikes kept; the oldest leave early when a storm is busier
+#endif
+#define STORM_TRACKER_TICK_MS       (60000) // window ageing period while a storm is active
+#define STORM_TRACKER_TREND_MIN     (4)     // ranged strikes needed before a trend is reported
+#define STORM_TRACKER_TREND_KM_MIN  (0.2f)  // slope, km/min, above which the storm counts as moving
+#define STORM_TRACKER_OVERHEAD_KM   (5)     // nearest strike at or below this distance means overhead
+
+typedef enum {
+    STORM_TRACKER_CLEAR = 0,    // no strike in the window
+    STORM_TRACKER_ACTIVE,       // strikes in the window
+    STORM_TRACKER_OVERHEAD,     // strikes within STORM_TRACKER_OVERHEAD_KM
+} storm_tracker_state_t;
+
+typedef enum {
+    STORM_TRACKER_TREND_UNKNOWN = 0,    // not enough ranged strikes, or all at the same time
+    STORM_TRACKER_TREND_APPROACHING,
+    STORM_TRACKER_TREND_STEADY,
+    STORM_TRACKER_TREND_RECEDING,
+} storm_tracker_trend_t;
+
+/**
+ * @brief Storm summary; distances are 0 when no strike in the window was in range
+ */
+typedef struct {
+    storm_tracker_state_t state;
+    storm_tracker_trend_t trend;
+    uint32_t strikes;           // strikes in the window, including out of range ones
+    uint32_t ranged;            // strikes with a distance estimate
+    float    rate_per_min;      // strike rate over the window
+    uint8_t  min_km;
+    uint8_t  median_km;
+    float    mean_km;
+    float    slope_km_per_min;  // negative while approaching, 0 when the trend is unknown
+    int64_t  last_strike_us;    // esp_timer time of the newest strike, 0 if none
+    uint32_t updates;           // state changes published since boot
+} storm_tracker_summary_t;
+
+/**
+ * @brief Create the ageing timer
+ */
+esp_err_t storm_tracker_init(void);
+
+/**
+ * @brief Add one lightning strike; called on the pipeline formatter task
+ * @param timestamp_us esp_timer time of the strike
+ * @param distance_km AS3935 distance estimate, 0x3f when out of range
+ */
+void storm_tracker_add_strike(int64_t timestamp_us, uint8_t distance_km);
+
+void storm_tracker_get_summary(storm_tracker_summary_t *summary);
+
+const char *storm_tracker_state_name(storm_tracker_state_t state);
+const char *storm_tracker_trend_name(storm_tracker_trend_t trend);
+
+/* HTTP handlers */
+esp_err_t storm_tracker_handler(httpd_req_t *req);
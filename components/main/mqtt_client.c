@@ -3,6 +3,9 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include "app_mqtt.h"
+#include "event_pipeline.h"
+#include "mqtt_cmd.h"
+#include "ha_discovery.h"
 #include "esp_http_server.h"
 #include <mqtt_client.h>  // use system header
 #include "esp_log.h"
@@ -42,6 +45,15 @@ static void publish_availability_task(void *pvParameters) {
 	vTaskDelete(NULL);
 }
 
+// Re-announce availability when the topic changes, so subscribers on the new topic see 'online'
+// without waiting for the next reconnect
+static void availability_topic_changed(const char *ns, const char *key, void *arg)
+{
+	if (client && mqtt_connected && availability_task == NULL) {
+		xTaskCreate(publish_availability_task, "mqtt_avail", 2048, NULL, 5, &availability_task);
+	}
+}
+
 static esp_err_t mqtt_stop_internal(void)
 {
 	if (client) {
@@ -67,11 +79,21 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
 		if (availability_task == NULL) {
 			xTaskCreate(publish_availability_task, "mqtt_avail", 2048, NULL, 5, &availability_task);
 		}
+		// the session is clean, so subscriptions are renewed on every connect
+		mqtt_cmd_subscribe(event->client);
+		ha_discovery_connected();
 		break;
 	case MQTT_EVENT_DISCONNECTED:
 		mqtt_connected = false;
 		ESP_LOGI(TAG, "MQTT disconnected - LWT will publish 'offline' to as3935/availability");
 		break;
+	case MQTT_EVENT_DATA:
+		// later fragments of a long payload carry no topic; mqtt_cmd rejects those requests
+		if (event->current_data_offset == 0) {
+			mqtt_cmd_handle(event->topic, event->topic_len, event->data, event->data_len,
+			                event->total_data_len, event->retain);
+		}
+		break;
 		case MQTT_EVENT_ERROR:
 			mqtt_connected = false;
 			ESP_LOGW(TAG, "MQTT error: error_type=%d", event->error_handle->error_type);
@@ -94,6 +116,11 @@ esp_err_t mqtt_init(const mqtt_config_t *cfg)
 {
 	if (!cfg) return ESP_ERR_INVALID_ARG;
 
+	static bool subscribed = false;
+	if (!subscribed && settings_subscribe("mqtt", "availability_topic", availability_topic_changed, NULL) == ESP_OK) {
+		subscribed = true;
+	}
+
 	// stop previous client if exists
 	mqtt_stop_internal();
 	
@@ -147,17 +174,22 @@ esp_err_t mqtt_init(const mqtt_config_t *cfg)
 	return err;
 }
 
-esp_err_t mqtt_publish(const char *topic, const char *payload)
+static esp_err_t mqtt_publish_msg(const char *topic, const char *payload, int len, int retain)
 {
 	if (!client) {
 		ESP_LOGW(TAG, "[MQTT-PUB] MQTT client not initialized");
 		return ESP_ERR_INVALID_STATE;
 	}
 	
-	ESP_LOGI(TAG, "[MQTT-PUB] Attempting publish: connected=%d, topic='%s', payload='%s'", 
-	         mqtt_connected, topic, payload);
+	if (len) {
+		ESP_LOGI(TAG, "[MQTT-PUB] Attempting publish: connected=%d, topic='%s', %d bytes",
+		         mqtt_connected, topic, len);
+	} else {
+		ESP_LOGI(TAG, "[MQTT-PUB] Attempting publish: connected=%d, topic='%s', payload='%s'", 
+		         mqtt_connected, topic, payload);
+	}
 	
-	int msg_id = esp_mqtt_client_publish(client, topic, payload, 0, 1, 0);
+	int msg_id = esp_mqtt_client_publish(client, topic, payload, len, 1, retain);
 	if (msg_id < 0) {
 		ESP_LOGW(TAG, "[MQTT-PUB] Failed: msg_id=%d (client may not be connected yet, connected=%d)", 
 		         msg_id, mqtt_connected);
@@ -168,6 +200,22 @@ esp_err_t mqtt_publish(const char *topic, const char *payload)
 	return ESP_OK;
 }
 
+esp_err_t mqtt_publish(const char *topic, const char *payload)
+{
+	return mqtt_publish_msg(topic, payload, 0, 0);
+}
+
+esp_err_t mqtt_publish_retained(const char *topic, const char *payload)
+{
+	return mqtt_publish_msg(topic, payload, 0, 1);
+}
+
+esp_err_t mqtt_publish_bin(const char *topic, const void *data, size_t len)
+{
+	if (!data || len == 0) return ESP_ERR_INVALID_ARG;
+	return mqtt_publish_msg(topic, (const char *)data, (int)len, 0);
+}
+
 bool mqtt_is_connected(void)
 {
 	return mqtt_connected;
@@ -199,7 +247,38 @@ esp_err_t mqtt_save_handler(httpd_req_t *req)
 	const cJSON *ca_cert = cJSON_GetObjectItemCaseSensitive(root, "ca_cert");
 	const cJSON *topic = cJSON_GetObjectItemCaseSensitive(root, "topic");
 	const cJSON *availability_topic = cJSON_GetObjectItemCaseSensitive(root, "availability_topic");
+	const cJSON *queue_policy = cJSON_GetObjectItemCaseSensitive(root, "queue_policy");
+	const cJSON *replay_rate = cJSON_GetObjectItemCaseSensitive(root, "replay_rate");
+	const cJSON *batch_window_ms = cJSON_GetObjectItemCaseSensitive(root, "batch_window_ms");
+	const cJSON *batch_max = cJSON_GetObjectItemCaseSensitive(root, "batch_max");
+	const cJSON *cbor = cJSON_GetObjectItemCaseSensitive(root, "cbor");
+	const cJSON *cmd_group = cJSON_GetObjectItemCaseSensitive(root, "cmd_group");
+	const cJSON *ha_discovery = cJSON_GetObjectItemCaseSensitive(root, "ha_discovery");
+	const cJSON *ha_prefix = cJSON_GetObjectItemCaseSensitive(root, "ha_prefix");
 	if (!cJSON_IsString(uri) || (uri->valuestring == NULL)) { cJSON_Delete(root); http_helpers_send_400(req); return ESP_FAIL; }
+	// offline queue options are optional, but rejected when malformed
+	if (queue_policy && (!cJSON_IsString(queue_policy) || !queue_policy->valuestring ||
+	    (strcmp(queue_policy->valuestring, "drop_oldest") != 0 && strcmp(queue_policy->valuestring, "drop_newest") != 0))) {
+		cJSON_Delete(root); http_helpers_send_400(req); return ESP_FAIL;
+	}
+	if (replay_rate && (!cJSON_IsNumber(replay_rate) || replay_rate->valuedouble < 1 || replay_rate->valuedouble > 100)) {
+		cJSON_Delete(root); http_helpers_send_400(req); return ESP_FAIL;
+	}
+	if (batch_window_ms && (!cJSON_IsNumber(batch_window_ms) || batch_window_ms->valuedouble < 0 ||
+	    batch_window_ms->valuedouble > EVENT_PIPELINE_BATCH_WINDOW_MAX)) {
+		cJSON_Delete(root); http_helpers_send_400(req); return ESP_FAIL;
+	}
+	if (batch_max && (!cJSON_IsNumber(batch_max) || batch_max->valuedouble < 2 || batch_max->valuedouble > EVENT_PIPELINE_BATCH_EVENTS)) {
+		cJSON_Delete(root); http_helpers_send_400(req); return ESP_FAIL;
+	}
+	// the group is a topic prefix, wildcards would subscribe to foreign commands
+	if (cmd_group && (!cJSON_IsString(cmd_group) || !cmd_group->valuestring || strpbrk(cmd_group->valuestring, "#+"))) {
+		cJSON_Delete(root); http_helpers_send_400(req); return ESP_FAIL;
+	}
+	if (ha_prefix && (!cJSON_IsString(ha_prefix) || !ha_prefix->valuestring || strpbrk(ha_prefix->valuestring, "#+") ||
+	    strlen(ha_prefix->valuestring) >= 64)) {
+		cJSON_Delete(root); http_helpers_send_400(req); return ESP_FAIL;
+	}
 	settings_save_str("mqtt", "uri", uri->valuestring);
 	if (cJSON_IsString(username) && username->valuestring) settings_save_str("mqtt", "username", username->valuestring);
 	if (cJSON_IsString(password) && password->valuestring) settings_save_str("mqtt", "password", password->valuestring);
@@ -219,6 +298,18 @@ esp_err_t mqtt_save_handler(httpd_req_t *req)
 		// Set default availability topic if not provided
 		settings_save_str("mqtt", "availability_topic", "as3935/availability");
 	}
+	if (queue_policy) settings_save_str("mqtt", "queue_policy", queue_policy->valuestring);
+	if (replay_rate) settings_save_i32("mqtt", "replay_rate", (int32_t)replay_rate->valuedouble);
+	if (batch_window_ms) settings_save_i32("mqtt", "batch_window_ms", (int32_t)batch_window_ms->valuedouble);
+	if (batch_max) settings_save_i32("mqtt", "batch_max", (int32_t)batch_max->valuedouble);
+	if (cJSON_IsBool(cbor)) {
+		settings_save_str("mqtt", "cbor", cJSON_IsTrue(cbor) ? "1" : "0");
+	}
+	if (cmd_group) settings_save_str("mqtt", "cmd_group", cmd_group->valuestring);   // "" leaves the group
+	if (cJSON_IsBool(ha_discovery)) {
+		settings_save_str("mqtt", "ha_discovery", cJSON_IsTrue(ha_discovery) ? "1" : "0");
+	}
+	if (ha_prefix) settings_save_str("mqtt", "ha_prefix", ha_prefix->valuestring);   // "" for the default
 	cJSON_Delete(root);
 
 	// apply immediately
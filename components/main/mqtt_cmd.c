@@ -0,0 +1,181 @@
+/**
+ * @file mqtt_cmd.c
+ * @brief Remote configuration over MQTT command topics
+ */
+
+#include "mqtt_cmd.h"
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "cJSON.h"
+#include "settings.h"
+#include "event_pipeline.h"
+#include "as3935_adapter.h"
+
+static const char *TAG = "mqtt_cmd";
+
+#define MQTT_CMD_TOPIC_MAX      (128)
+#define MQTT_CMD_RESULT_MAX     (640)
+
+typedef int (*mqtt_cmd_fn_t)(const char *body, char *out, size_t len);
+
+static int mqtt_cmd_settings(const char *body, char *out, size_t len);
+static int mqtt_cmd_register(const char *body, char *out, size_t len);
+static int mqtt_cmd_dump(const char *body, char *out, size_t len);
+
+static const struct {
+    const char     *name;
+    const char     *reply_leaf;     // static, the pipeline keeps the pointer
+    const char     *id_key;         // "mqtt" settings key holding the id a retained request last ran with
+    mqtt_cmd_fn_t   run;
+} g_commands[] = {
+    { "settings", "resp/settings", "cmd_id_settings", mqtt_cmd_settings },
+    { "register", "resp/register", "cmd_id_register", mqtt_cmd_register },
+    { "dump",     "resp/dump",     "cmd_id_dump",     mqtt_cmd_dump },
+};
+#define MQTT_CMD_COUNT  (sizeof(g_commands) / sizeof(g_commands[0]))
+
+// only the MQTT client task calls in, so the buffers need no lock
+static char g_body[MQTT_CMD_PAYLOAD_MAX + 1];
+static char g_result[MQTT_CMD_RESULT_MAX];
+static char g_reply[EVENT_PIPELINE_PAYLOAD_MAX];
+
+static int mqtt_cmd_settings(const char *body, char *out, size_t len) {
+    return as3935_settings_command(body[0] ? body : NULL, out, len);
+}
+
+static int mqtt_cmd_register(const char *body, char *out, size_t len) {
+    return as3935_register_read_command(body, out, len);
+}
+
+static int mqtt_cmd_dump(const char *body, char *out, size_t len) {
+    (void)body;
+    int pos = snprintf(out, len, "{\"status\":\"ok\",\"settings\":");
+    if (pos < (int)len) pos += as3935_settings_command(NULL, out + pos, len - pos);
+    if (pos < (int)len) pos += snprintf(out + pos, len - pos, ",\"registers\":");
+    if (pos < (int)len) pos += as3935_registers_json(out + pos, len - pos);
+    if (pos < (int)len) pos += snprintf(out + pos, len - pos, "}");
+    return pos;
+}
+
+/**
+ * @brief Copies "<prefix>/cmd/" for the event topic base, or for the group when group is set
+ */
+static bool mqtt_cmd_prefix(bool group, char *out, size_t len) {
+    const settings_snapshot_t *snap = settings_snapshot_acquire();
+    const char *topic = settings_snapshot_get_str(snap, "mqtt", "topic");
+    const char *group_topic = settings_snapshot_get_str(snap, "mqtt", "cmd_group");
+    bool ok = true;
+    if (group) {
+        ok = group_topic && group_topic[0];
+        if (ok) snprintf(out, len, "%s/cmd/", group_topic);
+    } else {
+        event_pipeline_topic(topic ? topic : "as3935/lightning", "cmd/", out, len);
+    }
+    settings_snapshot_release(snap);
+    return ok;
+}
+
+/**
+ * @brief Copies the request "id" as a JSON value: a short string without
+ * characters that need escaping, or an integer; "null" otherwise
+ */
+static void mqtt_cmd_id(const char *body, char *out, size_t len) {
+    snprintf(out, len, "null");
+    cJSON *root = cJSON_Parse(body);
+    if (!root) return;
+
+    const cJSON *id = cJSON_GetObjectItemCaseSensitive(root, "id");
+    if (cJSON_IsString(id) && id->valuestring && strlen(id->valuestring) + 3 <= len &&
+        !strpbrk(id->valuestring, "\"\\")) {
+        snprintf(out, len, "\"%s\"", id->valuestring);
+    } else if (cJSON_IsNumber(id)) {
+        snprintf(out, len, "%d", id->valueint);
+    }
+    cJSON_Delete(root);
+}
+
+static void mqtt_cmd_reply(const char *leaf, const char *command, const char *id, const char *result) {
+    const int n = snprintf(g_reply, sizeof(g_reply), "{\"id\":%s,\"command\":\"%s\",\"result\":%s}", id, command, result);
+    if (n >= (int)sizeof(g_reply)) {
+        snprintf(g_reply, sizeof(g_reply), "{\"id\":%s,\"command\":\"%s\",\"result\":"
+                 "{\"status\":\"error\",\"msg\":\"reply_too_large\"}}", id, command);
+    }
+    if (event_pipeline_publish("command", leaf, g_reply, false) != ESP_OK) {
+        ESP_LOGW(TAG, "Reply to %s dropped", command);
+    }
+}
+
+void mqtt_cmd_subscribe(esp_mqtt_client_handle_t client) {
+    for (int group = 0; group < 2; group++) {
+        char filter[MQTT_CMD_TOPIC_MAX];
+        if (!mqtt_cmd_prefix(group, filter, sizeof(filter) - 1)) continue;
+        const size_t n = strlen(filter);    // one byte was held back for the wildcard
+        filter[n] = '#';
+        filter[n + 1] = '\0';
+        if (esp_mqtt_client_subscribe(client, filter, 1) < 0) {
+            ESP_LOGW(TAG, "Subscribe to %s failed", filter);
+        } else {
+            ESP_LOGI(TAG, "Listening for commands on %s", filter);
+        }
+    }
+}
+
+void mqtt_cmd_handle(const char *topic, int topic_len, const char *data, int data_len, int total_len, bool retained) {
+    if (!topic || topic_len <= 0) return;
+
+    // find the command name after one of the prefixes
+    char name[32] = { 0 };
+    for (int group = 0; group < 2 && !name[0]; group++) {
+        char prefix[MQTT_CMD_TOPIC_MAX];
+        if (!mqtt_cmd_prefix(group, prefix, sizeof(prefix))) continue;
+        const int prefix_len = (int)strlen(prefix);
+        const int name_len = topic_len - prefix_len;
+        if (name_len <= 0 || name_len >= (int)sizeof(name) || strncmp(topic, prefix, prefix_len) != 0) continue;
+        memcpy(name, topic + prefix_len, name_len);
+    }
+    if (!name[0]) return;
+
+    size_t cmd = 0;
+    while (cmd < MQTT_CMD_COUNT && strcmp(g_commands[cmd].name, name) != 0) cmd++;
+    if (cmd == MQTT_CMD_COUNT) {
+        ESP_LOGW(TAG, "Unknown command '%s'", name);
+        return;
+    }
+
+    if (total_len > MQTT_CMD_PAYLOAD_MAX || data_len != total_len) {
+        mqtt_cmd_reply(g_commands[cmd].reply_leaf, name, "null", "{\"status\":\"error\",\"msg\":\"payload_too_large\"}");
+        return;
+    }
+    memcpy(g_body, data, data_len);
+    g_body[data_len] = '\0';
+
+    char id[MQTT_CMD_ID_MAX];
+    mqtt_cmd_id(g_body, id, sizeof(id));
+    if (retained) {
+        // the broker delivers a retained request again on every connect; only the id tells them apart
+        if (strcmp(id, "null") == 0) {
+            ESP_LOGW(TAG, "Retained %s without an id ignored", name);
+            mqtt_cmd_reply(g_commands[cmd].reply_leaf, name, id, "{\"status\":\"error\",\"msg\":\"retained_needs_id\"}");
+            return;
+        }
+        const settings_snapshot_t *snap = settings_snapshot_acquire();
+        const char *last = settings_snapshot_get_str(snap, "mqtt", g_commands[cmd].id_key);
+        const bool seen = last && strcmp(last, id) == 0;
+        settings_snapshot_release(snap);
+        if (seen) {
+            ESP_LOGD(TAG, "Retained %s %s already applied", name, id);
+            return;
+        }
+        // kept across reboots, so a restart does not run it again either
+        if (settings_save_str("mqtt", g_commands[cmd].id_key, id) != ESP_OK) {
+            ESP_LOGW(TAG, "Could not record id of retained %s, it may run again after a reboot", name);
+        }
+    }
+
+    ESP_LOGI(TAG, "Command %s id=%s%s", name, id, retained ? " (retained)" : "");
+    if (g_commands[cmd].run(g_body, g_result, sizeof(g_result)) >= (int)sizeof(g_result)) {
+        strlcpy(g_result, "{\"status\":\"error\",\"msg\":\"reply_too_large\"}", sizeof(g_result));
+    }
+    mqtt_cmd_reply(g_commands[cmd].reply_leaf, name, id, g_result);
+}
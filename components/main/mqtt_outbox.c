@@ -0,0 +1,586 @@
+/**
+ * @file mqtt_outbox.c
+ * @brief Offline queue of MQTT messages, kept in RAM and spilled to the "mqttq" flash partition
+ */
+
+#include "mqtt_outbox.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_http_server.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "http_helpers.h"
+#include "app_mqtt.h"
+#include "settings.h"
+
+static const char *TAG = "mqtt_outbox";
+
+#define MQTT_OUTBOX_SECTOR_MAGIC    (0x3151514D)    // "MQQ1"
+#define MQTT_OUTBOX_RECORD_MAGIC    (0x5151)
+#define MQTT_OUTBOX_STATE_PENDING   (0xFF)          // as erased
+#define MQTT_OUTBOX_STATE_SENT      (0x00)          // programmed in place once published
+#define MQTT_OUTBOX_FLAG_RETAIN     (1 << 0)
+#define MQTT_OUTBOX_FLAG_EPOCH      (1 << 1)        // queued_us is Unix time, not time since boot
+#define MQTT_OUTBOX_FLAG_BINARY     (1 << 2)        // payload is not text
+#define MQTT_OUTBOX_REPLAY_RATE_MAX (100)
+
+/**
+ * @brief Sector header, written right after the sector is erased
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;           // increases every time a sector is opened, 0 never used
+    uint32_t crc;           // crc32 of the fields above
+} mqtt_outbox_sector_hdr_t;
+
+/**
+ * @brief Message header, followed by the topic leaf and the payload (no terminators), padded to 4 bytes.
+ * RAM entries and flash records share the layout, so spilling is a plain copy.
+ */
+typedef struct {
+    uint16_t magic;
+    uint16_t len;           // payload bytes
+    uint8_t  leaf_len;
+    uint8_t  flags;         // MQTT_OUTBOX_FLAG_*
+    uint8_t  state;         // MQTT_OUTBOX_STATE_*, not covered by the crc
+    uint8_t  reserved;
+    int64_t  queued_us;
+    uint32_t crc;           // crc32 of the header with state pending and crc 0, then leaf and payload
+    uint32_t reserved2;
+} mqtt_outbox_record_hdr_t;
+
+_Static_assert(sizeof(mqtt_outbox_record_hdr_t) == 24, "record header must stay 24 bytes");
+
+#define MQTT_OUTBOX_RECORD_MAX  ((sizeof(mqtt_outbox_record_hdr_t) + MQTT_OUTBOX_TOPIC_MAX + EVENT_PIPELINE_PAYLOAD_MAX + 3) & ~3u)
+
+static SemaphoreHandle_t g_lock = NULL;             // protects everything below
+
+// RAM ring; entries never wrap, g_ram_end marks where the entries before the wrap stop
+static uint8_t g_ram[MQTT_OUTBOX_RAM_SIZE] __attribute__((aligned(4)));
+static uint32_t g_ram_head = 0;
+static uint32_t g_ram_tail = 0;
+static uint32_t g_ram_end = MQTT_OUTBOX_RAM_SIZE;
+static uint32_t g_ram_count = 0;
+
+// flash ring; every flash record is older than every RAM entry
+static const esp_partition_t *g_part = NULL;
+static uint32_t g_sector_count = 0;
+static uint16_t g_sector_pending[MQTT_OUTBOX_MAX_SECTORS];
+static int g_head = -1;                             // sector being written, -1 before the first write
+static uint32_t g_seq = 0;                          // seq of the head sector
+static uint32_t g_write_offset = MQTT_OUTBOX_SECTOR_SIZE;
+static uint32_t g_read_sector = 0;                  // next record to replay, valid while g_flash_pending
+static uint32_t g_read_offset = 0;
+static uint32_t g_flash_pending = 0;
+static uint8_t g_io[MQTT_OUTBOX_RECORD_MAX] __attribute__((aligned(4)));
+
+static mqtt_outbox_stats_t g_stats = { 0 };
+
+static inline uint32_t mqtt_outbox_record_size(const mqtt_outbox_record_hdr_t *hdr) {
+    return (sizeof(*hdr) + hdr->leaf_len + hdr->len + 3) & ~3u;
+}
+
+static bool mqtt_outbox_record_valid(const mqtt_outbox_record_hdr_t *hdr) {
+    return hdr->magic == MQTT_OUTBOX_RECORD_MAGIC && hdr->leaf_len < MQTT_OUTBOX_TOPIC_MAX &&
+           hdr->len < EVENT_PIPELINE_PAYLOAD_MAX;
+}
+
+static uint32_t mqtt_outbox_record_crc(const mqtt_outbox_record_hdr_t *hdr, const uint8_t *data) {
+    mqtt_outbox_record_hdr_t fields = *hdr;
+    fields.state = MQTT_OUTBOX_STATE_PENDING;
+    fields.crc = 0;
+    const uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&fields, sizeof(fields));
+    return esp_rom_crc32_le(crc, data, hdr->leaf_len + hdr->len);
+}
+
+static uint32_t mqtt_outbox_sector_crc(const mqtt_outbox_sector_hdr_t *hdr) {
+    return esp_rom_crc32_le(0, (const uint8_t *)hdr, offsetof(mqtt_outbox_sector_hdr_t, crc));
+}
+
+static mqtt_outbox_policy_t mqtt_outbox_policy(void) {
+    const settings_snapshot_t *snap = settings_snapshot_acquire();
+    const char *policy = settings_snapshot_get_str(snap, "mqtt", "queue_policy");
+    const mqtt_outbox_policy_t result = policy && strcmp(policy, "drop_newest") == 0 ?
+                                        MQTT_OUTBOX_DROP_NEWEST : MQTT_OUTBOX_DROP_OLDEST;
+    settings_snapshot_release(snap);
+    return result;
+}
+
+/* RAM ring (lock held) */
+
+static bool mqtt_outbox_ram_reserve(uint32_t size, uint32_t *offset) {
+    if (g_ram_count == 0) {
+        g_ram_head = g_ram_tail = 0;
+        g_ram_end = MQTT_OUTBOX_RAM_SIZE;
+    }
+
+    if (g_ram_count == 0 || g_ram_head > g_ram_tail) {
+        if (MQTT_OUTBOX_RAM_SIZE - g_ram_head >= size) {
+            *offset = g_ram_head;
+            return true;
+        }
+        if (g_ram_tail >= size) {
+            g_ram_end = g_ram_head;
+            *offset = 0;
+            return true;
+        }
+        return false;
+    }
+
+    // wrapped: the free space lies between head and tail
+    if (g_ram_tail - g_ram_head >= size) {
+        *offset = g_ram_head;
+        return true;
+    }
+    return false;
+}
+
+static void mqtt_outbox_ram_pop(void) {
+    mqtt_outbox_record_hdr_t hdr;
+    memcpy(&hdr, &g_ram[g_ram_tail], sizeof(hdr));
+    const uint32_t size = mqtt_outbox_record_size(&hdr);
+
+    g_ram_tail += size;
+    g_ram_count--;
+    g_stats.ram_bytes -= size;
+    if (g_ram_count == 0) {
+        g_ram_head = g_ram_tail = 0;
+        g_ram_end = MQTT_OUTBOX_RAM_SIZE;
+    } else if (g_ram_tail == g_ram_end) {
+        g_ram_tail = 0;
+        g_ram_end = MQTT_OUTBOX_RAM_SIZE;
+    }
+}
+
+/* Flash ring (lock held) */
+
+static esp_err_t mqtt_outbox_open_sector(uint32_t idx) {
+    esp_err_t err = esp_partition_erase_range(g_part, idx * MQTT_OUTBOX_SECTOR_SIZE, MQTT_OUTBOX_SECTOR_SIZE);
+    if (err != ESP_OK) return err;
+    g_stats.sector_erases++;
+
+    mqtt_outbox_sector_hdr_t hdr = {
+        .magic = MQTT_OUTBOX_SECTOR_MAGIC,
+        .seq = g_seq + 1,
+    };
+    hdr.crc = mqtt_outbox_sector_crc(&hdr);
+    err = esp_partition_write(g_part, idx * MQTT_OUTBOX_SECTOR_SIZE, &hdr, sizeof(hdr));
+    if (err != ESP_OK) return err;
+
+    g_seq = hdr.seq;
+    g_head = (int)idx;
+    g_write_offset = sizeof(hdr);
+    return ESP_OK;
+}
+
+/**
+ * @brief Append one record; ESP_ERR_NO_MEM when flash is full and the policy keeps the old records
+ */
+static esp_err_t mqtt_outbox_flash_append(const uint8_t *record, uint32_t size) {
+    if (g_head < 0 || g_write_offset + size > MQTT_OUTBOX_SECTOR_SIZE) {
+        const uint32_t next = g_head < 0 ? 0 : (g_head + 1) % g_sector_count;
+        if (g_sector_pending[next]) {
+            if (mqtt_outbox_policy() == MQTT_OUTBOX_DROP_NEWEST) return ESP_ERR_NO_MEM;
+
+            // the oldest sector is the next one round the ring
+            ESP_LOGW(TAG, "Queue full, dropping %u oldest messages", g_sector_pending[next]);
+            g_stats.dropped += g_sector_pending[next];
+            g_flash_pending -= g_sector_pending[next];
+            g_sector_pending[next] = 0;
+        }
+        // the reader may still sit in the sector, even when everything in it was sent;
+        // the next pending record is past it
+        if (g_read_sector == next) {
+            g_read_sector = (next + 1) % g_sector_count;
+            g_read_offset = sizeof(mqtt_outbox_sector_hdr_t);
+        }
+        esp_err_t err = mqtt_outbox_open_sector(next);
+        if (err != ESP_OK) return err;
+    }
+
+    if (g_flash_pending == 0) {
+        g_read_sector = (uint32_t)g_head;
+        g_read_offset = g_write_offset;
+    }
+
+    const esp_err_t err = esp_partition_write(g_part, g_head * MQTT_OUTBOX_SECTOR_SIZE + g_write_offset, record, size);
+    // a failed write may have left partial data behind, never write over it
+    g_write_offset += size;
+    if (err != ESP_OK) return err;
+
+    g_sector_pending[g_head]++;
+    g_flash_pending++;
+    return ESP_OK;
+}
+
+/**
+ * @brief Moves the oldest RAM entry to flash; a write failure loses it
+ */
+static esp_err_t mqtt_outbox_spill(void) {
+    mqtt_outbox_record_hdr_t hdr;
+    memcpy(&hdr, &g_ram[g_ram_tail], sizeof(hdr));
+
+    const esp_err_t err = mqtt_outbox_flash_append(&g_ram[g_ram_tail], mqtt_outbox_record_size(&hdr));
+    if (err == ESP_ERR_NO_MEM) return err;
+    if (err == ESP_OK) {
+        g_stats.spilled++;
+    } else {
+        ESP_LOGW(TAG, "Spill failed (%s), message lost", esp_err_to_name(err));
+        g_stats.write_failures++;
+        g_stats.dropped++;
+    }
+    mqtt_outbox_ram_pop();
+    return ESP_OK;
+}
+
+/**
+ * @brief Leaves the read sector; pending records left in it are unreadable and counted as dropped
+ */
+static void mqtt_outbox_next_read_sector(void) {
+    if (g_sector_pending[g_read_sector]) {
+        g_stats.dropped += g_sector_pending[g_read_sector];
+        g_flash_pending -= g_sector_pending[g_read_sector];
+        g_sector_pending[g_read_sector] = 0;
+    }
+    g_read_sector = (g_read_sector + 1) % g_sector_count;
+    g_read_offset = sizeof(mqtt_outbox_sector_hdr_t);
+}
+
+/**
+ * @brief Moves the read position to the oldest pending flash record and reads its header
+ */
+static bool mqtt_outbox_flash_seek(mqtt_outbox_record_hdr_t *hdr) {
+    for (uint32_t hops = 0; g_flash_pending && hops <= g_sector_count; ) {
+        const uint32_t base = g_read_sector * MQTT_OUTBOX_SECTOR_SIZE;
+        if (g_read_offset + sizeof(*hdr) <= MQTT_OUTBOX_SECTOR_SIZE &&
+            esp_partition_read(g_part, base + g_read_offset, hdr, sizeof(*hdr)) == ESP_OK &&
+            mqtt_outbox_record_valid(hdr) && g_read_offset + mqtt_outbox_record_size(hdr) <= MQTT_OUTBOX_SECTOR_SIZE) {
+            if (hdr->state == MQTT_OUTBOX_STATE_PENDING) return true;
+            g_read_offset += mqtt_outbox_record_size(hdr);
+            continue;
+        }
+
+        // end of the records in this sector
+        if (g_read_sector == (uint32_t)g_head) break;
+        mqtt_outbox_next_read_sector();
+        hops++;
+    }
+
+    if (g_flash_pending) {
+        // the counters disagree with flash, forget what cannot be found
+        g_stats.dropped += g_flash_pending;
+        g_flash_pending = 0;
+        memset(g_sector_pending, 0, sizeof(g_sector_pending));
+    }
+    return false;
+}
+
+static void mqtt_outbox_flash_mark_sent(const mqtt_outbox_record_hdr_t *hdr) {
+    const uint8_t sent = MQTT_OUTBOX_STATE_SENT;
+    esp_partition_write(g_part, g_read_sector * MQTT_OUTBOX_SECTOR_SIZE + g_read_offset +
+                        offsetof(mqtt_outbox_record_hdr_t, state), &sent, sizeof(sent));
+    g_read_offset += mqtt_outbox_record_size(hdr);
+    if (g_sector_pending[g_read_sector]) g_sector_pending[g_read_sector]--;
+    g_flash_pending--;
+}
+
+static void mqtt_outbox_unpack(const uint8_t *record, mqtt_outbox_msg_t *msg) {
+    mqtt_outbox_record_hdr_t hdr;
+    memcpy(&hdr, record, sizeof(hdr));
+    msg->retain = hdr.flags & MQTT_OUTBOX_FLAG_RETAIN;
+    msg->binary = hdr.flags & MQTT_OUTBOX_FLAG_BINARY;
+    msg->len = hdr.len;
+    memcpy(msg->topic_leaf, record + sizeof(hdr), hdr.leaf_len);
+    msg->topic_leaf[hdr.leaf_len] = '\0';
+    memcpy(msg->payload, record + sizeof(hdr) + hdr.leaf_len, hdr.len);
+    msg->payload[hdr.len] = '\0';
+}
+
+/**
+ * @brief Rebuild the flash ring from the sector headers and the record headers
+ */
+static void mqtt_outbox_recover(void) {
+    uint32_t seqs[MQTT_OUTBOX_MAX_SECTORS] = { 0 };
+    for (uint32_t idx = 0; idx < g_sector_count; idx++) {
+        mqtt_outbox_sector_hdr_t hdr;
+        if (esp_partition_read(g_part, idx * MQTT_OUTBOX_SECTOR_SIZE, &hdr, sizeof(hdr)) != ESP_OK ||
+            hdr.magic != MQTT_OUTBOX_SECTOR_MAGIC || hdr.crc != mqtt_outbox_sector_crc(&hdr) || hdr.seq == 0) {
+            continue;
+        }
+        seqs[idx] = hdr.seq;
+        if (hdr.seq > g_seq) {
+            g_seq = hdr.seq;
+            g_head = (int)idx;
+        }
+    }
+    if (g_head < 0) return;
+
+    // walk the ring from the sector after the head, the oldest, round to the head
+    bool found = false;
+    for (uint32_t i = 1; i <= g_sector_count; i++) {
+        const uint32_t idx = (g_head + i) % g_sector_count;
+        if (!seqs[idx]) continue;
+
+        uint32_t offset = sizeof(mqtt_outbox_sector_hdr_t);
+        while (offset + sizeof(mqtt_outbox_record_hdr_t) <= MQTT_OUTBOX_SECTOR_SIZE) {
+            mqtt_outbox_record_hdr_t hdr;
+            if (esp_partition_read(g_part, idx * MQTT_OUTBOX_SECTOR_SIZE + offset, &hdr, sizeof(hdr)) != ESP_OK ||
+                !mqtt_outbox_record_valid(&hdr) || offset + mqtt_outbox_record_size(&hdr) > MQTT_OUTBOX_SECTOR_SIZE) {
+                // erased space, or a torn write: never write over anything but erased flash
+                if (hdr.magic != 0xFFFF) offset = MQTT_OUTBOX_SECTOR_SIZE;
+                break;
+            }
+            if (hdr.state == MQTT_OUTBOX_STATE_PENDING) {
+                if (!found) {
+                    g_read_sector = idx;
+                    g_read_offset = offset;
+                    found = true;
+                }
+                g_sector_pending[idx]++;
+                g_flash_pending++;
+            }
+            offset += mqtt_outbox_record_size(&hdr);
+        }
+        if (idx == (uint32_t)g_head) g_write_offset = offset;
+    }
+
+    g_stats.restored = g_flash_pending;
+}
+
+static void mqtt_outbox_shutdown_handler(void) {
+    mqtt_outbox_flush();
+}
+
+esp_err_t mqtt_outbox_init(void) {
+    if (g_lock) return ESP_OK;
+
+    g_lock = xSemaphoreCreateMutex();
+    if (!g_lock) return ESP_ERR_NO_MEM;
+
+    g_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, MQTT_OUTBOX_PARTITION_SUBTYPE, MQTT_OUTBOX_PARTITION_LABEL);
+    if (g_part) {
+        g_sector_count = g_part->size / MQTT_OUTBOX_SECTOR_SIZE;
+        if (g_sector_count > MQTT_OUTBOX_MAX_SECTORS) g_sector_count = MQTT_OUTBOX_MAX_SECTORS;
+        if (g_sector_count < 2) g_part = NULL;
+    }
+    if (!g_part) {
+        ESP_LOGW(TAG, "No '%s' partition, offline queue limited to %d bytes of RAM",
+                 MQTT_OUTBOX_PARTITION_LABEL, MQTT_OUTBOX_RAM_SIZE);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    g_stats.flash_sectors = g_sector_count;
+    mqtt_outbox_recover();
+    esp_register_shutdown_handler(mqtt_outbox_shutdown_handler);
+
+    ESP_LOGI(TAG, "Offline queue: %lu sectors, %lu messages from the previous boot",
+             (unsigned long)g_sector_count, (unsigned long)g_flash_pending);
+    return ESP_OK;
+}
+
+static esp_err_t mqtt_outbox_enqueue(const char *topic_leaf, uint8_t flags, const void *payload, size_t len) {
+    if (!g_lock) return ESP_ERR_INVALID_STATE;
+    if (!topic_leaf) topic_leaf = "";
+
+    const int64_t now_us = esp_timer_get_time();
+    const int64_t epoch_us = event_pipeline_timestamp_to_epoch_us(now_us);
+    mqtt_outbox_record_hdr_t hdr = {
+        .magic = MQTT_OUTBOX_RECORD_MAGIC,
+        .len = (uint16_t)len,
+        .leaf_len = (uint8_t)strnlen(topic_leaf, MQTT_OUTBOX_TOPIC_MAX - 1),
+        .flags = flags | (epoch_us ? MQTT_OUTBOX_FLAG_EPOCH : 0),
+        .state = MQTT_OUTBOX_STATE_PENDING,
+        .reserved = 0xFF,
+        .queued_us = epoch_us ? epoch_us : now_us,
+        .reserved2 = 0xFFFFFFFF,
+    };
+    const uint32_t size = mqtt_outbox_record_size(&hdr);
+
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    g_stats.queued++;
+
+    uint32_t offset;
+    while (!mqtt_outbox_ram_reserve(size, &offset)) {
+        esp_err_t err = ESP_ERR_NO_MEM;
+        if (g_part) {
+            err = mqtt_outbox_spill();
+        } else if (mqtt_outbox_policy() == MQTT_OUTBOX_DROP_OLDEST) {
+            mqtt_outbox_ram_pop();
+            g_stats.dropped++;
+            err = ESP_OK;
+        }
+        if (err != ESP_OK) {
+            g_stats.dropped++;
+            xSemaphoreGive(g_lock);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    uint8_t *entry = &g_ram[offset];
+    memcpy(entry + sizeof(hdr), topic_leaf, hdr.leaf_len);
+    memcpy(entry + sizeof(hdr) + hdr.leaf_len, payload, hdr.len);
+    hdr.crc = mqtt_outbox_record_crc(&hdr, entry + sizeof(hdr));
+    memcpy(entry, &hdr, sizeof(hdr));
+    memset(entry + sizeof(hdr) + hdr.leaf_len + hdr.len, 0xFF, size - sizeof(hdr) - hdr.leaf_len - hdr.len);
+
+    g_ram_head = offset + size;
+    g_ram_count++;
+    g_stats.ram_bytes += size;
+    xSemaphoreGive(g_lock);
+    return ESP_OK;
+}
+
+esp_err_t mqtt_outbox_push(const char *topic_leaf, bool retain, const char *payload) {
+    if (!payload) return ESP_ERR_INVALID_ARG;
+    return mqtt_outbox_enqueue(topic_leaf, retain ? MQTT_OUTBOX_FLAG_RETAIN : 0, payload,
+                               strnlen(payload, EVENT_PIPELINE_PAYLOAD_MAX - 1));
+}
+
+esp_err_t mqtt_outbox_push_bin(const char *topic_leaf, const void *data, size_t len) {
+    if (!data || len == 0 || len >= EVENT_PIPELINE_PAYLOAD_MAX) return ESP_ERR_INVALID_ARG;
+    return mqtt_outbox_enqueue(topic_leaf, MQTT_OUTBOX_FLAG_BINARY, data, len);
+}
+
+uint32_t mqtt_outbox_pending(void) {
+    return g_flash_pending + g_ram_count;
+}
+
+esp_err_t mqtt_outbox_peek(mqtt_outbox_msg_t *msg) {
+    if (!msg) return ESP_ERR_INVALID_ARG;
+    if (!g_lock) return ESP_ERR_NOT_FOUND;
+
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    mqtt_outbox_record_hdr_t hdr;
+    while (mqtt_outbox_flash_seek(&hdr)) {
+        const uint32_t base = g_read_sector * MQTT_OUTBOX_SECTOR_SIZE + g_read_offset;
+        if (esp_partition_read(g_part, base, g_io, mqtt_outbox_record_size(&hdr)) == ESP_OK &&
+            mqtt_outbox_record_crc(&hdr, g_io + sizeof(hdr)) == hdr.crc) {
+            mqtt_outbox_unpack(g_io, msg);
+            xSemaphoreGive(g_lock);
+            return ESP_OK;
+        }
+        // torn or damaged record, skip it for good
+        ESP_LOGW(TAG, "Dropping corrupt queued message in sector %lu", (unsigned long)g_read_sector);
+        g_stats.dropped++;
+        mqtt_outbox_flash_mark_sent(&hdr);
+    }
+
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    if (g_ram_count) {
+        mqtt_outbox_unpack(&g_ram[g_ram_tail], msg);
+        err = ESP_OK;
+    }
+    xSemaphoreGive(g_lock);
+    return err;
+}
+
+void mqtt_outbox_pop(void) {
+    if (!g_lock) return;
+
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    mqtt_outbox_record_hdr_t hdr;
+    if (mqtt_outbox_flash_seek(&hdr)) {
+        mqtt_outbox_flash_mark_sent(&hdr);
+        g_stats.replayed++;
+    } else if (g_ram_count) {
+        mqtt_outbox_ram_pop();
+        g_stats.replayed++;
+    }
+    xSemaphoreGive(g_lock);
+}
+
+uint32_t mqtt_outbox_replay_interval_ms(void) {
+    int32_t rate = MQTT_OUTBOX_REPLAY_RATE;
+    const settings_snapshot_t *snap = settings_snapshot_acquire();
+    settings_snapshot_get_i32(snap, "mqtt", "replay_rate", &rate);
+    settings_snapshot_release(snap);
+
+    if (rate < 1) rate = 1;
+    if (rate > MQTT_OUTBOX_REPLAY_RATE_MAX) rate = MQTT_OUTBOX_REPLAY_RATE_MAX;
+    return 1000 / rate;
+}
+
+esp_err_t mqtt_outbox_flush(void) {
+    if (!g_lock || !g_part) return ESP_ERR_INVALID_STATE;
+    if (xSemaphoreTake(g_lock, pdMS_TO_TICKS(1000)) != pdTRUE) return ESP_ERR_TIMEOUT;
+
+    esp_err_t err = ESP_OK;
+    while (g_ram_count && err == ESP_OK) {
+        err = mqtt_outbox_spill();
+    }
+    xSemaphoreGive(g_lock);
+    return err;
+}
+
+void mqtt_outbox_get_stats(mqtt_outbox_stats_t *stats) {
+    if (!stats) return;
+    if (!g_lock) {
+        *stats = g_stats;
+        return;
+    }
+
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    *stats = g_stats;
+    stats->ram_pending = g_ram_count;
+    stats->flash_pending = g_flash_pending;
+
+    mqtt_outbox_record_hdr_t hdr;
+    bool have_oldest = mqtt_outbox_flash_seek(&hdr);
+    if (!have_oldest && g_ram_count) {
+        memcpy(&hdr, &g_ram[g_ram_tail], sizeof(hdr));
+        have_oldest = true;
+    }
+    xSemaphoreGive(g_lock);
+
+    stats->oldest_age_ms = 0;
+    if (have_oldest) {
+        const int64_t now_us = esp_timer_get_time();
+        int64_t age_us = 0;
+        if (hdr.flags & MQTT_OUTBOX_FLAG_EPOCH) {
+            const int64_t epoch_us = event_pipeline_timestamp_to_epoch_us(now_us);
+            if (epoch_us) age_us = epoch_us - hdr.queued_us;
+        } else if (hdr.queued_us <= now_us) {
+            // queued before the clock was set; exact only for this boot
+            age_us = now_us - hdr.queued_us;
+        }
+        if (age_us > 0) stats->oldest_age_ms = (uint32_t)(age_us / 1000);
+    }
+}
+
+const char *mqtt_outbox_policy_name(mqtt_outbox_policy_t policy) {
+    return policy == MQTT_OUTBOX_DROP_NEWEST ? "drop_newest" : "drop_oldest";
+}
+
+/**
+ * @brief GET /api/mqtt/queue - offline queue depth, oldest message age and counters
+ */
+esp_err_t mqtt_outbox_stats_handler(httpd_req_t *req) {
+    mqtt_outbox_stats_t stats;
+    mqtt_outbox_get_stats(&stats);
+    const uint32_t interval_ms = mqtt_outbox_replay_interval_ms();
+
+    char response[640];
+    snprintf(response, sizeof(response),
+        "{\"status\":\"ok\",\"connected\":%s,\"policy\":\"%s\",\"replay_rate\":%lu,"
+        "\"pending\":%lu,\"ram_pending\":%lu,\"ram_bytes\":%lu,\"ram_size\":%d,"
+        "\"flash\":%s,\"flash_pending\":%lu,\"flash_sectors\":%lu,\"oldest_age_ms\":%lu,"
+        "\"queued\":%lu,\"replayed\":%lu,\"dropped\":%lu,\"spilled\":%lu,\"restored\":%lu,"
+        "\"sector_erases\":%lu,\"write_failures\":%lu}",
+        mqtt_is_connected() ? "true" : "false", mqtt_outbox_policy_name(mqtt_outbox_policy()),
+        (unsigned long)(1000 / interval_ms),
+        (unsigned long)(stats.ram_pending + stats.flash_pending), (unsigned long)stats.ram_pending,
+        (unsigned long)stats.ram_bytes, MQTT_OUTBOX_RAM_SIZE,
+        g_part ? "true" : "false", (unsigned long)stats.flash_pending, (unsigned long)stats.flash_sectors,
+        (unsigned long)stats.oldest_age_ms,
+        (unsigned long)stats.queued, (unsigned long)stats.replayed, (unsigned long)stats.dropped,
+        (unsigned long)stats.spilled, (unsigned long)stats.restored,
+        (unsigned long)stats.sector_erases, (unsigned long)stats.write_failures);
+
+    return http_reply_json(req, response);
+}
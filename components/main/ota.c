@@ -108,6 +108,7 @@ static void ota_task(void *pv)
             if (err == ESP_OK) {
                 snprintf(payload, sizeof(payload), "{\"status\":\"done\", \"written\":%d}", total_written);
                 events_broadcast("ota_progress", payload);
+                settings_flush();
                 vTaskDelay(pdMS_TO_TICKS(500));
                 esp_restart();
             } else {
@@ -1,52 +1,638 @@
 #include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
 #include "nvs.h"
 #include "nvs_flash.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_system.h"
+#include "esp_http_server.h"
+#include "http_helpers.h"
 #include "settings.h"
 
 static const char *TAG = "settings";
 
-esp_err_t settings_init(void)
+// Namespaces served from RAM; anything else goes straight to NVS
+static const char *const s_namespaces[] = { "wifi", "mqtt", "as3935_cfg" };
+#define SETTINGS_NAMESPACE_COUNT (sizeof(s_namespaces) / sizeof(s_namespaces[0]))
+
+typedef struct {
+    uint8_t     ns;                         // index into s_namespaces
+    nvs_type_t  type;                       // NVS_TYPE_STR, NVS_TYPE_I32 or NVS_TYPE_U8
+    char        key[NVS_KEY_NAME_MAX_SIZE];
+    int32_t     value;                      // integer value
+    const char *str;                        // string value, points into the snapshot's string pool
+} settings_entry_t;
+
+// Immutable once published; the string pool follows the entries in the same allocation
+struct settings_snapshot_s {
+    uint32_t         refs;
+    uint32_t         generation;
+    size_t           count;
+    settings_entry_t entries[];
+};
+
+// Key whose RAM value has not been committed yet; the value itself is read from the snapshot at flush time
+typedef struct {
+    uint8_t ns;
+    char    key[NVS_KEY_NAME_MAX_SIZE];
+} settings_dirty_t;
+
+typedef struct {
+    settings_change_cb_t cb;
+    void                *arg;
+    uint8_t              ns;
+    char                 key[NVS_KEY_NAME_MAX_SIZE];   // empty for the whole namespace
+} settings_subscriber_t;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;     // protects s_current and snapshot refs
+static settings_snapshot_t *s_current = NULL;
+static SemaphoreHandle_t s_write_mutex = NULL;                  // serializes writers and the subscriber table
+static settings_subscriber_t s_subscribers[SETTINGS_SUBSCRIBERS_MAX];
+static size_t s_subscriber_count = 0;
+static settings_dirty_t s_dirty[SETTINGS_DIRTY_MAX];           // protected by s_write_mutex
+static size_t s_dirty_count = 0;
+static TaskHandle_t s_flush_task = NULL;
+static settings_stats_t s_stats = { 0 };                        // protected by s_write_mutex
+
+/**
+ * @brief Accounts one NVS write: a 32-byte entry header, plus the data span for strings
+ */
+static void settings_account_write(nvs_type_t type, const char *str)
 {
-    esp_err_t ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
+    uint32_t entries = 1;
+    if (type == NVS_TYPE_STR && str) {
+        entries += (uint32_t)((strlen(str) + 1 + SETTINGS_NVS_ENTRY_SIZE - 1) / SETTINGS_NVS_ENTRY_SIZE);
     }
-    return ret;
+    s_stats.keys_written++;
+    s_stats.entries_written += entries;
+    s_stats.bytes_written += entries * SETTINGS_NVS_ENTRY_SIZE;
+    s_stats.page_erases_est = s_stats.entries_written / SETTINGS_NVS_ENTRIES_PER_PAGE;
 }
 
-esp_err_t settings_save_str(const char *ns, const char *key, const char *value)
+static int settings_ns_index(const char *ns)
+{
+    for (size_t i = 0; i < SETTINGS_NAMESPACE_COUNT; i++) {
+        if (strcmp(ns, s_namespaces[i]) == 0) return (int)i;
+    }
+    return -1;
+}
+
+static const settings_entry_t *settings_find(const settings_snapshot_t *snap, int ns, const char *key)
+{
+    if (!snap || ns < 0) return NULL;
+    for (size_t i = 0; i < snap->count; i++) {
+        if (snap->entries[i].ns == ns && strcmp(snap->entries[i].key, key) == 0) return &snap->entries[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Copies old into a new snapshot with change applied (replaced, added or, with erase, removed)
+ */
+static settings_snapshot_t *settings_snapshot_build(const settings_snapshot_t *old, const settings_entry_t *change, bool erase)
+{
+    const size_t old_count = old ? old->count : 0;
+    size_t count = 0;
+    size_t pool = 0;
+
+    for (size_t i = 0; i < old_count; i++) {
+        const settings_entry_t *e = &old->entries[i];
+        if (e->ns == change->ns && strcmp(e->key, change->key) == 0) continue;
+        count++;
+        if (e->type == NVS_TYPE_STR) pool += strlen(e->str) + 1;
+    }
+    if (!erase) {
+        count++;
+        if (change->type == NVS_TYPE_STR) pool += strlen(change->str) + 1;
+    }
+
+    settings_snapshot_t *snap = malloc(sizeof(settings_snapshot_t) + count * sizeof(settings_entry_t) + pool);
+    if (!snap) return NULL;
+    snap->refs = 1;
+    snap->generation = 0;
+    snap->count = 0;
+
+    char *strings = (char *)&snap->entries[count];
+    for (size_t i = 0; i <= old_count; i++) {
+        const settings_entry_t *e;
+        if (i < old_count) {
+            e = &old->entries[i];
+            if (e->ns == change->ns && strcmp(e->key, change->key) == 0) continue;
+        } else if (!erase) {
+            e = change;
+        } else {
+            break;
+        }
+
+        settings_entry_t *dst = &snap->entries[snap->count++];
+        *dst = *e;
+        if (e->type == NVS_TYPE_STR) {
+            const size_t len = strlen(e->str) + 1;
+            memcpy(strings, e->str, len);
+            dst->str = strings;
+            strings += len;
+        } else {
+            dst->str = NULL;
+        }
+    }
+
+    return snap;
+}
+
+static void settings_publish(settings_snapshot_t *snap)
+{
+    taskENTER_CRITICAL(&s_lock);
+    settings_snapshot_t *old = s_current;
+    snap->generation = old ? old->generation + 1 : 1;
+    s_current = snap;
+    taskEXIT_CRITICAL(&s_lock);
+
+    settings_snapshot_release(old);
+}
+
+static void settings_notify(int ns, const char *key)
+{
+    settings_subscriber_t subscribers[SETTINGS_SUBSCRIBERS_MAX];
+    size_t count;
+
+    xSemaphoreTake(s_write_mutex, portMAX_DELAY);
+    count = s_subscriber_count;
+    memcpy(subscribers, s_subscribers, count * sizeof(settings_subscriber_t));
+    xSemaphoreGive(s_write_mutex);
+
+    for (size_t i = 0; i < count; i++) {
+        if (subscribers[i].ns != ns) continue;
+        if (subscribers[i].key[0] && strcmp(subscribers[i].key, key) != 0) continue;
+        subscribers[i].cb(s_namespaces[ns], key, subscribers[i].arg);
+    }
+}
+
+static bool settings_entry_equals(const settings_entry_t *e, nvs_type_t type, int32_t value, const char *str)
+{
+    if (e->type != type) return false;
+    return type == NVS_TYPE_STR ? strcmp(e->str, str) == 0 : e->value == value;
+}
+
+/**
+ * @brief Writes one key straight to NVS with its own commit, used for unmanaged namespaces
+ */
+static esp_err_t settings_write_through(const char *ns, const char *key, nvs_type_t type, int32_t value, const char *str, bool erase)
 {
     nvs_handle_t h;
     esp_err_t err = nvs_open(ns, NVS_READWRITE, &h);
     if (err != ESP_OK) return err;
-    err = nvs_set_str(h, key, value);
+
+    if (erase) {
+        err = nvs_erase_key(h, key);
+    } else if (type == NVS_TYPE_STR) {
+        err = nvs_set_str(h, key, str);
+    } else if (type == NVS_TYPE_U8) {
+        err = nvs_set_u8(h, key, (uint8_t)value);
+    } else {
+        err = nvs_set_i32(h, key, value);
+    }
     if (err == ESP_OK) err = nvs_commit(h);
     nvs_close(h);
-    ESP_LOGI(TAG, "Saved %s/%s", ns, key);
+
+    if (s_write_mutex) xSemaphoreTake(s_write_mutex, portMAX_DELAY);
+    if (err == ESP_OK) {
+        s_stats.commits++;
+        if (!erase) settings_account_write(type, str);
+    } else {
+        s_stats.flush_failures++;
+    }
+    if (s_write_mutex) xSemaphoreGive(s_write_mutex);
     return err;
 }
 
-esp_err_t settings_load_str(const char *ns, const char *key, char *out, size_t len)
+/**
+ * @brief Commits every dirty key, one nvs_open/nvs_commit per namespace.  Keys of a
+ * namespace that fails stay dirty and are retried on the next flush.  Caller holds s_write_mutex.
+ */
+static esp_err_t settings_flush_locked(void)
+{
+    esp_err_t result = ESP_OK;
+
+    for (size_t ns = 0; ns < SETTINGS_NAMESPACE_COUNT && s_dirty_count; ns++) {
+        bool any = false;
+        for (size_t i = 0; i < s_dirty_count && !any; i++) any = s_dirty[i].ns == ns;
+        if (!any) continue;
+
+        nvs_handle_t h;
+        esp_err_t err = nvs_open(s_namespaces[ns], NVS_READWRITE, &h);
+        const bool opened = err == ESP_OK;
+        for (size_t i = 0; i < s_dirty_count && err == ESP_OK; i++) {
+            if (s_dirty[i].ns != ns) continue;
+            const settings_entry_t *e = settings_find(s_current, (int)ns, s_dirty[i].key);
+            if (!e) {
+                err = nvs_erase_key(h, s_dirty[i].key);
+                if (err == ESP_ERR_NVS_NOT_FOUND) err = ESP_OK;
+            } else if (e->type == NVS_TYPE_STR) {
+                err = nvs_set_str(h, e->key, e->str);
+            } else if (e->type == NVS_TYPE_U8) {
+                err = nvs_set_u8(h, e->key, (uint8_t)e->value);
+            } else {
+                err = nvs_set_i32(h, e->key, e->value);
+            }
+        }
+        if (err == ESP_OK) err = nvs_commit(h);
+        if (opened) nvs_close(h);
+
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Commit of namespace %s failed: %s", s_namespaces[ns], esp_err_to_name(err));
+            s_stats.flush_failures++;
+            result = err;
+            continue;
+        }
+
+        // drop the committed keys from the dirty table
+        size_t kept = 0;
+        for (size_t i = 0; i < s_dirty_count; i++) {
+            if (s_dirty[i].ns == ns) {
+                const settings_entry_t *e = settings_find(s_current, (int)ns, s_dirty[i].key);
+                if (e) settings_account_write(e->type, e->str);
+                continue;
+            }
+            s_dirty[kept++] = s_dirty[i];
+        }
+        s_dirty_count = kept;
+        s_stats.commits++;
+    }
+
+    s_stats.pending = (uint32_t)s_dirty_count;
+    return result;
+}
+
+/**
+ * @brief Updates one key in RAM, publishes a new snapshot, queues the key for the next
+ * coalesced commit and notifies subscribers
+ */
+static esp_err_t settings_write(const char *ns, const char *key, nvs_type_t type, int32_t value, const char *str, bool erase)
+{
+    if (!ns || !key) return ESP_ERR_INVALID_ARG;
+    if (strlen(key) >= NVS_KEY_NAME_MAX_SIZE) return ESP_ERR_NVS_KEY_TOO_LONG;
+
+    const int idx = settings_ns_index(ns);
+    if (idx < 0 || !s_write_mutex) {
+        return settings_write_through(ns, key, type, value, str, erase);
+    }
+
+    xSemaphoreTake(s_write_mutex, portMAX_DELAY);
+    s_stats.writes++;
+
+    const settings_entry_t *current = settings_find(s_current, idx, key);
+    if (erase ? current == NULL : (current && settings_entry_equals(current, type, value, str))) {
+        // nothing to persist and nothing to tell subscribers
+        s_stats.unchanged++;
+        xSemaphoreGive(s_write_mutex);
+        return erase ? ESP_ERR_NVS_NOT_FOUND : ESP_OK;
+    }
+
+    size_t slot = 0;
+    while (slot < s_dirty_count && !(s_dirty[slot].ns == idx && strcmp(s_dirty[slot].key, key) == 0)) slot++;
+    if (slot < s_dirty_count) {
+        // already waiting for the next commit, the new value simply replaces it
+        s_stats.coalesced++;
+    } else if (s_dirty_count == SETTINGS_DIRTY_MAX) {
+        // dirty table full: commit what is pending now rather than lose track of a key
+        if (settings_flush_locked() != ESP_OK) {
+            xSemaphoreGive(s_write_mutex);
+            return ESP_ERR_NO_MEM;
+        }
+        slot = s_dirty_count;
+    }
+
+    settings_entry_t change = { .ns = (uint8_t)idx, .type = type, .value = value, .str = str };
+    strlcpy(change.key, key, sizeof(change.key));
+    settings_snapshot_t *snap = settings_snapshot_build(s_current, &change, erase);
+    if (!snap) {
+        xSemaphoreGive(s_write_mutex);
+        return ESP_ERR_NO_MEM;
+    }
+    settings_publish(snap);
+
+    if (slot == s_dirty_count) {
+        s_dirty[s_dirty_count].ns = (uint8_t)idx;
+        strlcpy(s_dirty[s_dirty_count].key, key, sizeof(s_dirty[s_dirty_count].key));
+        s_dirty_count++;
+    }
+    s_stats.pending = (uint32_t)s_dirty_count;
+    xSemaphoreGive(s_write_mutex);
+
+    if (s_flush_task) xTaskNotifyGive(s_flush_task);
+    settings_notify(idx, key);
+    return ESP_OK;
+}
+
+/**
+ * @brief Waits for the first change, then for a quiet window with no further changes
+ * (bounded by SETTINGS_COMMIT_MAX_DELAY_MS), and commits everything in one go
+ */
+static void settings_flush_task(void *pvParameters)
+{
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        const TickType_t first = xTaskGetTickCount();
+        while (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SETTINGS_COMMIT_QUIET_MS)) > 0 &&
+               (xTaskGetTickCount() - first) < pdMS_TO_TICKS(SETTINGS_COMMIT_MAX_DELAY_MS)) {
+            // another change arrived inside the window, keep coalescing
+        }
+
+        settings_flush();
+    }
+}
+
+static void settings_shutdown_handler(void)
+{
+    settings_flush();
+}
+
+/**
+ * @brief Reads every string and integer key of one managed namespace into snap
+ */
+static settings_snapshot_t *settings_load_namespace(settings_snapshot_t *snap, int idx)
 {
     nvs_handle_t h;
-    esp_err_t err = nvs_open(ns, NVS_READONLY, &h);
-    if (err != ESP_OK) return err;
-    size_t required = len;
-    err = nvs_get_str(h, key, out, &required);
+    if (nvs_open(s_namespaces[idx], NVS_READONLY, &h) != ESP_OK) {
+        return snap;  // namespace not created yet
+    }
+
+    nvs_iterator_t it = NULL;
+    esp_err_t res = nvs_entry_find(NVS_DEFAULT_PART_NAME, s_namespaces[idx], NVS_TYPE_ANY, &it);
+    while (res == ESP_OK) {
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+
+        settings_entry_t entry = { .ns = (uint8_t)idx, .type = info.type };
+        strlcpy(entry.key, info.key, sizeof(entry.key));
+
+        char *str = NULL;
+        esp_err_t err = ESP_ERR_NOT_SUPPORTED;
+        if (info.type == NVS_TYPE_STR) {
+            size_t len = 0;
+            err = nvs_get_str(h, info.key, NULL, &len);
+            if (err == ESP_OK && (str = malloc(len)) != NULL) {
+                err = nvs_get_str(h, info.key, str, &len);
+                entry.str = str;
+            } else if (err == ESP_OK) {
+                err = ESP_ERR_NO_MEM;
+            }
+        } else if (info.type == NVS_TYPE_I32) {
+            err = nvs_get_i32(h, info.key, &entry.value);
+        } else if (info.type == NVS_TYPE_U8) {
+            uint8_t u8 = 0;
+            err = nvs_get_u8(h, info.key, &u8);
+            entry.value = u8;
+        }
+
+        if (err == ESP_OK) {
+            settings_snapshot_t *next = settings_snapshot_build(snap, &entry, false);
+            if (next) {
+                free(snap);
+                snap = next;
+            }
+        } else {
+            ESP_LOGD(TAG, "Not caching %s/%s (type 0x%02x): %s", s_namespaces[idx], info.key, info.type, esp_err_to_name(err));
+        }
+        free(str);
+
+        res = nvs_entry_next(&it);
+    }
+    nvs_release_iterator(it);
     nvs_close(h);
+
+    return snap;
+}
+
+esp_err_t settings_init(void)
+{
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    if (ret != ESP_OK || s_write_mutex) return ret;
+
+    s_write_mutex = xSemaphoreCreateMutex();
+    if (!s_write_mutex) return ESP_ERR_NO_MEM;
+
+    settings_snapshot_t *snap = calloc(1, sizeof(settings_snapshot_t));
+    if (!snap) return ESP_ERR_NO_MEM;
+    snap->refs = 1;
+    for (size_t i = 0; i < SETTINGS_NAMESPACE_COUNT; i++) {
+        snap = settings_load_namespace(snap, (int)i);
+    }
+    settings_publish(snap);
+
+    if (xTaskCreate(settings_flush_task, "settings_flush", 3072, NULL, 3, &s_flush_task) != pdPASS) {
+        ESP_LOGW(TAG, "No flush task, settings will be committed on flush only");
+    }
+    esp_register_shutdown_handler(settings_shutdown_handler);
+
+    ESP_LOGI(TAG, "Loaded %u keys from %u namespaces into RAM", (unsigned)snap->count, (unsigned)SETTINGS_NAMESPACE_COUNT);
+    return ESP_OK;
+}
+
+esp_err_t settings_save_str(const char *ns, const char *key, const char *value)
+{
+    if (!value) return ESP_ERR_INVALID_ARG;
+    esp_err_t err = settings_write(ns, key, NVS_TYPE_STR, 0, value, false);
+    ESP_LOGI(TAG, "Saved %s/%s", ns, key);
     return err;
 }
 
+esp_err_t settings_save_i32(const char *ns, const char *key, int32_t value)
+{
+    return settings_write(ns, key, NVS_TYPE_I32, value, NULL, false);
+}
+
+esp_err_t settings_save_u8(const char *ns, const char *key, uint8_t value)
+{
+    return settings_write(ns, key, NVS_TYPE_U8, value, NULL, false);
+}
+
 esp_err_t settings_erase_key(const char *ns, const char *key)
 {
-    nvs_handle_t h;
-    esp_err_t err = nvs_open(ns, NVS_READWRITE, &h);
-    if (err != ESP_OK) return err;
-    err = nvs_erase_key(h, key);
-    if (err == ESP_OK) err = nvs_commit(h);
-    nvs_close(h);
+    return settings_write(ns, key, NVS_TYPE_ANY, 0, NULL, true);
+}
+
+esp_err_t settings_load_str(const char *ns, const char *key, char *out, size_t len)
+{
+    if (!ns || !key || !out) return ESP_ERR_INVALID_ARG;
+
+    const int idx = settings_ns_index(ns);
+    if (idx < 0 || !s_current) {
+        nvs_handle_t h;
+        esp_err_t err = nvs_open(ns, NVS_READONLY, &h);
+        if (err != ESP_OK) return err;
+        size_t required = len;
+        err = nvs_get_str(h, key, out, &required);
+        nvs_close(h);
+        return err;
+    }
+
+    const settings_snapshot_t *snap = settings_snapshot_acquire();
+    const char *value = settings_snapshot_get_str(snap, ns, key);
+    esp_err_t err = ESP_ERR_NVS_NOT_FOUND;
+    if (value) {
+        if (strlen(value) < len) {
+            strcpy(out, value);
+            err = ESP_OK;
+        } else {
+            err = ESP_ERR_NVS_INVALID_LENGTH;
+        }
+    }
+    settings_snapshot_release(snap);
+    return err;
+}
+
+esp_err_t settings_get_i32(const char *ns, const char *key, int32_t *out)
+{
+    if (!ns || !key || !out) return ESP_ERR_INVALID_ARG;
+
+    if (settings_ns_index(ns) < 0 || !s_current) {
+        nvs_handle_t h;
+        esp_err_t err = nvs_open(ns, NVS_READONLY, &h);
+        if (err != ESP_OK) return err;
+        err = nvs_get_i32(h, key, out);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            // settings_save_u8 stores a u8, which NVS keeps apart from an i32 of the same key
+            uint8_t value = 0;
+            err = nvs_get_u8(h, key, &value);
+            if (err == ESP_OK) *out = value;
+        }
+        nvs_close(h);
+        return err;
+    }
+
+    const settings_snapshot_t *snap = settings_snapshot_acquire();
+    esp_err_t err = settings_snapshot_get_i32(snap, ns, key, out);
+    settings_snapshot_release(snap);
+    return err;
+}
+
+esp_err_t settings_get_u8(const char *ns, const char *key, uint8_t *out)
+{
+    if (!out) return ESP_ERR_INVALID_ARG;
+    int32_t value = 0;
+    esp_err_t err = settings_get_i32(ns, key, &value);
+    if (err == ESP_OK) *out = (uint8_t)value;
     return err;
 }
+
+const settings_snapshot_t *settings_snapshot_acquire(void)
+{
+    taskENTER_CRITICAL(&s_lock);
+    settings_snapshot_t *snap = s_current;
+    if (snap) snap->refs++;
+    taskEXIT_CRITICAL(&s_lock);
+    return snap;
+}
+
+void settings_snapshot_release(const settings_snapshot_t *snap)
+{
+    if (!snap) return;
+
+    settings_snapshot_t *s = (settings_snapshot_t *)snap;
+    taskENTER_CRITICAL(&s_lock);
+    const bool last = --s->refs == 0;
+    taskEXIT_CRITICAL(&s_lock);
+    if (last) free(s);
+}
+
+uint32_t settings_snapshot_generation(const settings_snapshot_t *snap)
+{
+    return snap ? snap->generation : 0;
+}
+
+const char *settings_snapshot_get_str(const settings_snapshot_t *snap, const char *ns, const char *key)
+{
+    if (!ns || !key) return NULL;
+    const settings_entry_t *e = settings_find(snap, settings_ns_index(ns), key);
+    return (e && e->type == NVS_TYPE_STR) ? e->str : NULL;
+}
+
+esp_err_t settings_snapshot_get_i32(const settings_snapshot_t *snap, const char *ns, const char *key, int32_t *out)
+{
+    if (!ns || !key || !out) return ESP_ERR_INVALID_ARG;
+    const settings_entry_t *e = settings_find(snap, settings_ns_index(ns), key);
+    if (!e || e->type == NVS_TYPE_STR) return ESP_ERR_NVS_NOT_FOUND;
+    *out = e->value;
+    return ESP_OK;
+}
+
+esp_err_t settings_subscribe(const char *ns, const char *key, settings_change_cb_t cb, void *arg)
+{
+    if (!ns || !cb || (key && strlen(key) >= NVS_KEY_NAME_MAX_SIZE)) return ESP_ERR_INVALID_ARG;
+
+    const int idx = settings_ns_index(ns);
+    if (idx < 0) return ESP_ERR_NOT_SUPPORTED;  // only RAM-backed namespaces can notify
+    if (!s_write_mutex) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t err = ESP_ERR_NO_MEM;
+    xSemaphoreTake(s_write_mutex, portMAX_DELAY);
+    if (s_subscriber_count < SETTINGS_SUBSCRIBERS_MAX) {
+        settings_subscriber_t *sub = &s_subscribers[s_subscriber_count++];
+        sub->cb = cb;
+        sub->arg = arg;
+        sub->ns = (uint8_t)idx;
+        strlcpy(sub->key, key ? key : "", sizeof(sub->key));
+        err = ESP_OK;
+    }
+    xSemaphoreGive(s_write_mutex);
+    return err;
+}
+
+esp_err_t settings_flush(void)
+{
+    if (!s_write_mutex) return ESP_OK;
+
+    xSemaphoreTake(s_write_mutex, portMAX_DELAY);
+    esp_err_t err = settings_flush_locked();
+    xSemaphoreGive(s_write_mutex);
+    return err;
+}
+
+void settings_get_stats(settings_stats_t *stats)
+{
+    if (!stats) return;
+
+    if (s_write_mutex) xSemaphoreTake(s_write_mutex, portMAX_DELAY);
+    *stats = s_stats;
+    if (s_write_mutex) xSemaphoreGive(s_write_mutex);
+}
+
+esp_err_t settings_stats_handler(httpd_req_t *req)
+{
+    settings_stats_t stats;
+    settings_get_stats(&stats);
+
+    const settings_snapshot_t *snap = settings_snapshot_acquire();
+    const uint32_t generation = settings_snapshot_generation(snap);
+    settings_snapshot_release(snap);
+
+    char response[512];
+    snprintf(response, sizeof(response),
+        "{\"status\":\"ok\","
+        "\"generation\":%lu,"
+        "\"writes\":%lu,"
+        "\"unchanged\":%lu,"
+        "\"coalesced\":%lu,"
+        "\"pending\":%lu,"
+        "\"commits\":%lu,"
+        "\"keys_written\":%lu,"
+        "\"bytes_written\":%lu,"
+        "\"page_erases_est\":%lu,"
+        "\"flush_failures\":%lu}",
+        (unsigned long)generation, (unsigned long)stats.writes, (unsigned long)stats.unchanged,
+        (unsigned long)stats.coalesced, (unsigned long)stats.pending, (unsigned long)stats.commits,
+        (unsigned long)stats.keys_written, (unsigned long)stats.bytes_written,
+        (unsigned long)stats.page_erases_est, (unsigned long)stats.flush_failures);
+
+    return http_reply_json(req, response);
+}
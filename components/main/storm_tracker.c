@@ -0,0 +1,309 @@
+/**
+ * @file storm_tracker.c
+ * @brief On-device storm state derived from lightning strikes
+ */
+
+#include "storm_tracker.h"
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_http_server.h"
+#include "freertos/FreeRTOS.h"
+#include "http_helpers.h"
+#include "app_mqtt.h"
+#include "event_pipeline.h"
+#include "ha_discovery.h"
+
+static const char *TAG = "storm_tracker";
+
+#define STORM_TRACKER_OUT_OF_RANGE  (0x3F)
+#define STORM_TRACKER_BUCKETS       (15)    // AS3935 distance estimates below out of range
+
+// distance estimates the AS3935 reports, km
+static const uint8_t g_distances[STORM_TRACKER_BUCKETS] = {
+    0x01, 0x05, 0x06, 0x08, 0x0A, 0x0C, 0x0E, 0x11, 0x14, 0x18, 0x1B, 0x1F, 0x22, 0x25, 0x28
+};
+
+typedef struct {
+    uint32_t t_ms;          // since g_t0_us
+    uint8_t  bucket;        // index into g_distances, STORM_TRACKER_BUCKETS when out of range
+} storm_strike_t;
+
+/**
+ * @brief Fields whose change triggers a publish
+ */
+typedef struct {
+    storm_tracker_state_t state;
+    storm_tracker_trend_t trend;
+    uint8_t min_km;
+    uint8_t median_km;
+} storm_tracker_key_t;
+
+static portMUX_TYPE g_lock = portMUX_INITIALIZER_UNLOCKED;  // everything below, strikes come from the formatter, ticks from esp_timer
+
+static storm_strike_t g_strikes[STORM_TRACKER_MAX_STRIKES];
+static uint32_t g_first = 0;        // oldest strike
+static uint32_t g_count = 0;
+static int64_t g_t0_us = 0;         // time base of the strikes in the window
+static int64_t g_last_strike_us = 0;
+
+// incremental statistics over the ranged strikes in the window, t in minutes
+static uint16_t g_buckets[STORM_TRACKER_BUCKETS];
+static uint32_t g_ranged = 0;
+static double g_sum_t = 0, g_sum_d = 0, g_sum_tt = 0, g_sum_td = 0;
+
+static storm_tracker_key_t g_published = { 0 };
+static bool g_announced = false;    // state published once since boot, clears a stale retained message
+static uint32_t g_updates = 0;
+static esp_timer_handle_t g_timer = NULL;
+static bool g_timer_running = false;
+
+static uint8_t storm_tracker_bucket(uint8_t distance_km) {
+    if (distance_km >= STORM_TRACKER_OUT_OF_RANGE) return STORM_TRACKER_BUCKETS;
+    uint8_t bucket = 0;
+    while (bucket < STORM_TRACKER_BUCKETS - 1 && g_distances[bucket] < distance_km) bucket++;
+    return bucket;
+}
+
+static void storm_tracker_account(const storm_strike_t *strike, int sign) {
+    if (strike->bucket >= STORM_TRACKER_BUCKETS) return;
+
+    const double t = strike->t_ms / 60000.0;
+    const double d = g_distances[strike->bucket];
+    g_buckets[strike->bucket] += sign;
+    g_ranged += sign;
+    if (g_ranged == 0) {
+        // start the next storm without the rounding left over from this one
+        g_sum_t = g_sum_d = g_sum_tt = g_sum_td = 0;
+        return;
+    }
+    g_sum_t += sign * t;
+    g_sum_d += sign * d;
+    g_sum_tt += sign * t * t;
+    g_sum_td += sign * t * d;
+}
+
+static void storm_tracker_drop_oldest(void) {
+    storm_tracker_account(&g_strikes[g_first], -1);
+    g_first = (g_first + 1) % STORM_TRACKER_MAX_STRIKES;
+    g_count--;
+}
+
+/**
+ * @brief Removes strikes older than the window; every strike leaves once, so O(1) amortised
+ */
+static void storm_tracker_expire(int64_t now_us) {
+    while (g_count) {
+        const int64_t age_us = now_us - (g_t0_us + (int64_t)g_strikes[g_first].t_ms * 1000);
+        if (age_us <= (int64_t)STORM_TRACKER_WINDOW_S * 1000000) break;
+        storm_tracker_drop_oldest();
+    }
+}
+
+static void storm_tracker_summarise(int64_t now_us, storm_tracker_summary_t *s) {
+    memset(s, 0, sizeof(*s));
+    s->strikes = g_count;
+    s->ranged = g_ranged;
+    s->last_strike_us = g_last_strike_us;
+    s->updates = g_updates;
+    if (g_count == 0) return;
+
+    s->state = STORM_TRACKER_ACTIVE;
+
+    // a full ring covers less than the window
+    int64_t span_us = (int64_t)STORM_TRACKER_WINDOW_S * 1000000;
+    if (g_count == STORM_TRACKER_MAX_STRIKES) {
+        span_us = now_us - (g_t0_us + (int64_t)g_strikes[g_first].t_ms * 1000);
+        if (span_us < 60000000) span_us = 60000000;
+    }
+    s->rate_per_min = (float)(g_count * 60000000.0 / span_us);
+
+    if (g_ranged == 0) return;
+
+    const uint32_t median_rank = (g_ranged - 1) / 2;
+    uint32_t seen = 0;
+    for (int b = 0; b < STORM_TRACKER_BUCKETS; b++) {
+        if (!g_buckets[b]) continue;
+        if (!s->min_km) s->min_km = g_distances[b];
+        seen += g_buckets[b];
+        if (seen > median_rank) {
+            s->median_km = g_distances[b];
+            break;
+        }
+    }
+    s->mean_km = (float)(g_sum_d / g_ranged);
+    if (s->min_km <= STORM_TRACKER_OVERHEAD_KM) s->state = STORM_TRACKER_OVERHEAD;
+
+    const double n = g_ranged;
+    const double denom = n * g_sum_tt - g_sum_t * g_sum_t;
+    if (g_ranged >= STORM_TRACKER_TREND_MIN && denom > 1e-6) {
+        s->slope_km_per_min = (float)((n * g_sum_td - g_sum_t * g_sum_d) / denom);
+        s->trend = s->slope_km_per_min <= -STORM_TRACKER_TREND_KM_MIN ? STORM_TRACKER_TREND_APPROACHING :
+                   s->slope_km_per_min >= STORM_TRACKER_TREND_KM_MIN ? STORM_TRACKER_TREND_RECEDING :
+                   STORM_TRACKER_TREND_STEADY;
+    }
+}
+
+static int storm_tracker_format(const storm_tracker_summary_t *s, char *buf, size_t len) {
+    char distances[96] = "\"min_km\":null,\"median_km\":null,\"mean_km\":null";
+    if (s->ranged) {
+        snprintf(distances, sizeof(distances), "\"min_km\":%u,\"median_km\":%u,\"mean_km\":%.1f",
+                 s->min_km, s->median_km, s->mean_km);
+    }
+    char slope[32] = "null";
+    if (s->trend != STORM_TRACKER_TREND_UNKNOWN) {
+        snprintf(slope, sizeof(slope), "%.2f", s->slope_km_per_min);
+    }
+
+    return snprintf(buf, len,
+        "{\"state\":\"%s\",\"trend\":\"%s\",\"strikes\":%lu,\"rate_per_min\":%.2f,%s,"
+        "\"slope_km_per_min\":%s,\"window_s\":%d,\"last_strike_epoch_us\":%lld}",
+        storm_tracker_state_name(s->state), storm_tracker_trend_name(s->trend),
+        (unsigned long)s->strikes, s->rate_per_min, distances, slope, STORM_TRACKER_WINDOW_S,
+        (long long)(s->last_strike_us ? event_pipeline_timestamp_to_epoch_us(s->last_strike_us) : 0));
+}
+
+/**
+ * @brief Publishes the state if its key changed, then starts or stops the ageing timer
+ * @note Call with g_lock held; the lock is released before publishing
+ */
+static void storm_tracker_update_locked(int64_t now_us) {
+    storm_tracker_summary_t summary;
+    storm_tracker_summarise(now_us, &summary);
+
+    const storm_tracker_key_t key = {
+        .state = summary.state, .trend = summary.trend, .min_km = summary.min_km, .median_km = summary.median_km,
+    };
+    const bool connected = mqtt_is_connected();
+    bool publish = false;
+    const bool changed = key.state != g_published.state || key.trend != g_published.trend ||
+                         key.min_km != g_published.min_km || key.median_km != g_published.median_km;
+    if (changed || (!g_announced && connected)) {
+        g_published = key;
+        g_announced |= connected;
+        summary.updates = ++g_updates;
+        publish = true;
+    }
+
+    const bool run_timer = summary.state != STORM_TRACKER_CLEAR || !g_announced;
+    const bool start_timer = run_timer && !g_timer_running;
+    const bool stop_timer = !run_timer && g_timer_running;
+    g_timer_running = run_timer;
+    taskEXIT_CRITICAL(&g_lock);
+
+    if (start_timer) esp_timer_start_periodic(g_timer, (uint64_t)STORM_TRACKER_TICK_MS * 1000);
+    if (stop_timer) esp_timer_stop(g_timer);
+    if (!publish) return;
+
+    ha_discovery_storm(summary.state);
+    char payload[320];
+    storm_tracker_format(&summary, payload, sizeof(payload));
+    if (event_pipeline_publish("storm", "storm", payload, true) != ESP_OK) {
+        // publish again on the next update or tick
+        taskENTER_CRITICAL(&g_lock);
+        g_published.state = (storm_tracker_state_t)-1;
+        taskEXIT_CRITICAL(&g_lock);
+        return;
+    }
+    ESP_LOGI(TAG, "Storm %s, trend %s, %lu strikes, nearest %u km",
+             storm_tracker_state_name(summary.state), storm_tracker_trend_name(summary.trend),
+             (unsigned long)summary.strikes, summary.min_km);
+}
+
+static void storm_tracker_tick(void *arg) {
+    const int64_t now_us = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&g_lock);
+    storm_tracker_expire(now_us);
+    storm_tracker_update_locked(now_us);
+}
+
+esp_err_t storm_tracker_init(void) {
+    if (g_timer) return ESP_OK;
+
+    const esp_timer_create_args_t args = {
+        .callback = storm_tracker_tick,
+        .name = "storm_tick",
+    };
+    esp_err_t err = esp_timer_create(&args, &g_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create storm timer: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // keep ticking until the boot state has replaced whatever the broker retained
+    g_timer_running = true;
+    return esp_timer_start_periodic(g_timer, (uint64_t)STORM_TRACKER_TICK_MS * 1000);
+}
+
+void storm_tracker_add_strike(int64_t timestamp_us, uint8_t distance_km) {
+    if (!g_timer) return;
+
+    taskENTER_CRITICAL(&g_lock);
+    storm_tracker_expire(timestamp_us);
+    if (g_count == 0) g_t0_us = timestamp_us;
+    if (g_count == STORM_TRACKER_MAX_STRIKES) storm_tracker_drop_oldest();
+
+    storm_strike_t *strike = &g_strikes[(g_first + g_count) % STORM_TRACKER_MAX_STRIKES];
+    strike->t_ms = timestamp_us > g_t0_us ? (uint32_t)((timestamp_us - g_t0_us) / 1000) : 0;
+    strike->bucket = storm_tracker_bucket(distance_km);
+    storm_tracker_account(strike, 1);
+    g_count++;
+    g_last_strike_us = timestamp_us;
+
+    storm_tracker_update_locked(timestamp_us);
+}
+
+void storm_tracker_get_summary(storm_tracker_summary_t *summary) {
+    if (!summary) return;
+
+    const int64_t now_us = esp_timer_get_time();
+    taskENTER_CRITICAL(&g_lock);
+    storm_tracker_expire(now_us);
+    storm_tracker_summarise(now_us, summary);
+    taskEXIT_CRITICAL(&g_lock);
+}
+
+const char *storm_tracker_state_name(storm_tracker_state_t state) {
+    switch (state) {
+        case STORM_TRACKER_CLEAR:
+            return "clear";
+        case STORM_TRACKER_ACTIVE:
+            return "active";
+        case STORM_TRACKER_OVERHEAD:
+            return "overhead";
+        default:
+            return "unknown";
+    }
+}
+
+const char *storm_tracker_trend_name(storm_tracker_trend_t trend) {
+    switch (trend) {
+        case STORM_TRACKER_TREND_APPROACHING:
+            return "approaching";
+        case STORM_TRACKER_TREND_STEADY:
+            return "steady";
+        case STORM_TRACKER_TREND_RECEDING:
+            return "receding";
+        default:
+            return "unknown";
+    }
+}
+
+/**
+ * @brief GET /api/storm - current storm state, same fields as the published message
+ */
+esp_err_t storm_tracker_handler(httpd_req_t *req) {
+    storm_tracker_summary_t summary;
+    storm_tracker_get_summary(&summary);
+
+    char state[320];
+    storm_tracker_format(&summary, state, sizeof(state));
+
+    // splice the status and counters into the published object
+    char response[400];
+    snprintf(response, sizeof(response), "{\"status\":\"ok\",\"ranged\":%lu,\"updates\":%lu,%s",
+             (unsigned long)summary.ranged, (unsigned long)summary.updates, state + 1);
+    return http_reply_json(req, response);
+}
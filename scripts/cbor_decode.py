@@ -0,0 +1,288 @@
+"""Decoder and size/throughput benchmark for the CBOR event payload.
+
+With "cbor": true saved through /api/mqtt/save, the device publishes every
+sensor event a second time, CBOR encoded, on <base>/cbor (e.g. as3935/cbor)
+next to the JSON message on the event topic.  Decode captured payloads with:
+    mosquitto_sub -h broker -t as3935/cbor -F %x | python scripts/cbor_decode.py -
+    python scripts/cbor_decode.py --hex a500010103020103191388074424220107
+
+and compare both encodings with:
+    python scripts/cbor_decode.py --bench
+
+The payload is a CBOR map with unsigned integer keys, defined in
+components/main/include/event_pipeline.h (EVENT_PIPELINE_CBOR_KEY_*).  Keys are
+never renumbered; keys this decoder does not know are ignored, so newer
+firmware stays readable.
+"""
+import argparse
+import json
+import random
+import struct
+import sys
+import time
+
+VERSION = 1
+
+KEY_VERSION = 0
+KEY_TYPE = 1
+KEY_SEQ = 2
+KEY_IRQ_US = 3
+KEY_EPOCH_US = 4
+KEY_DISTANCE = 5
+KEY_ENERGY = 6
+KEY_REGS = 7
+KEY_EVENT_ID = 8
+
+TYPE_NAMES = ['unknown', 'lightning', 'disturber', 'noise']
+TYPE_LIGHTNING = 1
+
+# AS3935 interrupt states, for the JSON payload of unknown events
+EVENT_IDS = {1: 0x08, 2: 0x04, 3: 0x01}
+
+
+def decode_item(buf: bytes, pos: int = 0):
+    """Decode one CBOR data item, return (value, new_pos).
+
+    Supports the definite-length items the device writes plus floats.
+    Raises ValueError on truncated or unsupported input.
+    """
+    if pos >= len(buf):
+        raise ValueError('truncated item')
+    initial = buf[pos]
+    pos += 1
+    major, info = initial >> 5, initial & 0x1F
+
+    if major == 7 and info in (25, 26, 27):
+        size, fmt = {25: (2, '>e'), 26: (4, '>f'), 27: (8, '>d')}[info]
+        if pos + size > len(buf):
+            raise ValueError('truncated float')
+        return struct.unpack_from(fmt, buf, pos)[0], pos + size
+
+    if info < 24:
+        arg = info
+    elif info <= 27:
+        size = 1 << (info - 24)
+        if pos + size > len(buf):
+            raise ValueError('truncated argument')
+        arg = int.from_bytes(buf[pos:pos + size], 'big')
+        pos += size
+    else:
+        raise ValueError(f'unsupported additional info {info}')
+
+    if major == 0:
+        return arg, pos
+    if major == 1:
+        return -1 - arg, pos
+    if major in (2, 3):
+        if pos + arg > len(buf):
+            raise ValueError('truncated string')
+        data = bytes(buf[pos:pos + arg])
+        return (data if major == 2 else data.decode('utf-8')), pos + arg
+    if major == 4:
+        items = []
+        for _ in range(arg):
+            item, pos = decode_item(buf, pos)
+            items.append(item)
+        return items, pos
+    if major == 5:
+        items = {}
+        for _ in range(arg):
+            key, pos = decode_item(buf, pos)
+            items[key], pos = decode_item(buf, pos)
+        return items, pos
+    if major == 6:
+        return decode_item(buf, pos)  # tags carry no meaning here
+    simple = {20: False, 21: True, 22: None}
+    if info in simple:
+        return simple[info], pos
+    raise ValueError(f'unsupported simple value {info}')
+
+
+def _head(major: int, arg: int) -> bytes:
+    if arg < 24:
+        return bytes([major << 5 | arg])
+    for info, size in ((24, 1), (25, 2), (26, 4), (27, 8)):
+        if arg < 1 << (8 * size):
+            return bytes([major << 5 | info]) + arg.to_bytes(size, 'big')
+    raise ValueError('integer too large')
+
+
+def encode_item(value) -> bytes:
+    """Encode ints, bytes, str, list, dict, bool and None like the device encoder."""
+    if value is None:
+        return b'\xf6'
+    if isinstance(value, bool):
+        return b'\xf5' if value else b'\xf4'
+    if isinstance(value, int):
+        return _head(0, value) if value >= 0 else _head(1, -1 - value)
+    if isinstance(value, bytes):
+        return _head(2, len(value)) + value
+    if isinstance(value, str):
+        data = value.encode('utf-8')
+        return _head(3, len(data)) + data
+    if isinstance(value, list):
+        return _head(4, len(value)) + b''.join(encode_item(v) for v in value)
+    if isinstance(value, dict):
+        return _head(5, len(value)) + b''.join(encode_item(k) + encode_item(v) for k, v in value.items())
+    raise TypeError(f'cannot encode {type(value).__name__}')
+
+
+def decode_event(payload: bytes) -> dict:
+    """Decode one <base>/cbor payload into the fields of the JSON payload.
+
+    Raises ValueError if the payload is not an event map.
+    """
+    items, end = decode_item(payload)
+    if end != len(payload):
+        raise ValueError('trailing bytes after the event')
+    if not isinstance(items, dict) or KEY_TYPE not in items or KEY_IRQ_US not in items:
+        raise ValueError('not an event payload')
+
+    type_ = items[KEY_TYPE]
+    regs = items.get(KEY_REGS, b'\x00\x00\x00\x00')
+    if len(regs) != 4:
+        raise ValueError('register snapshot must be 4 bytes')
+
+    event = {
+        'event': TYPE_NAMES[type_] if type_ < len(TYPE_NAMES) else 'unknown',
+        'seq': items.get(KEY_SEQ, 0),
+        'irq_timestamp_us': items[KEY_IRQ_US],
+        'epoch_us': items.get(KEY_EPOCH_US, 0),
+        'r0': regs[0],
+        'r1': regs[1],
+        'r3': regs[2],
+        'r8': regs[3],
+    }
+    if type_ == TYPE_LIGHTNING:
+        event['distance_km'] = items.get(KEY_DISTANCE, 0x3F)
+        event['energy'] = items.get(KEY_ENERGY, 0)
+    if KEY_EVENT_ID in items:
+        event['event_id'] = items[KEY_EVENT_ID]
+    return event
+
+
+def encode_event(event: dict) -> bytes:
+    """Encode a decoded event (see decode_event) exactly like the device does."""
+    type_ = TYPE_NAMES.index(event['event']) if event['event'] in TYPE_NAMES else 0
+    items = {KEY_VERSION: VERSION, KEY_TYPE: type_, KEY_SEQ: event['seq'], KEY_IRQ_US: event['irq_timestamp_us']}
+    if event.get('epoch_us'):
+        items[KEY_EPOCH_US] = event['epoch_us']
+    if type_ == TYPE_LIGHTNING:
+        items[KEY_DISTANCE] = event['distance_km']
+        items[KEY_ENERGY] = event['energy']
+    items[KEY_REGS] = bytes([event['r0'], event['r1'], event['r3'], event['r8']])
+    if type_ == 0:
+        items[KEY_EVENT_ID] = event.get('event_id', 0)
+    return encode_item(items)
+
+
+def format_json(event: dict) -> bytes:
+    """Build the JSON payload the device publishes for the same event (for --bench)."""
+    regs = {k: f"0x{event[k]:02x}" for k in ('r0', 'r1', 'r3', 'r8')}
+    times = {'timestamp': event['irq_timestamp_us'] // 1000,
+             'irq_timestamp_us': event['irq_timestamp_us'], 'epoch_us': event.get('epoch_us', 0)}
+    if event['event'] == 'lightning':
+        d, e = event['distance_km'], event['energy']
+        body = {
+            'event': 'lightning', 'description': 'Lightning Strike Detected', 'distance_km': d,
+            'distance_description': ('Very Far (>40km)' if d > 40 else 'Far (20-40km)' if d > 20 else
+                                     'Moderate (10-20km)' if d > 10 else 'Close (5-10km)' if d > 5 else
+                                     'Very Close (<5km)'),
+            'energy': e,
+            'energy_description': ('Very Strong (>1000)' if e > 1000 else 'Strong (500-1000)' if e > 500 else
+                                   'Moderate (200-500)' if e > 200 else 'Weak (<200)'),
+        }
+    elif event['event'] == 'disturber':
+        body = {'event': 'disturber', 'description': 'Disturber Detected (non-lightning noise)'}
+    else:
+        body = {'event': 'noise', 'description': 'Noise Level Too High'}
+    return json.dumps({**body, **regs, **times}, separators=(',', ':')).encode()
+
+
+def sample_events(count: int, seed: int = 1) -> list:
+    """Storm-like mix of events: mostly lightning, some disturbers and noise."""
+    rng = random.Random(seed)
+    events = []
+    now_us = 3_600_000_000
+    for seq in range(1, count + 1):
+        now_us += rng.randint(200_000, 20_000_000)
+        name = rng.choices(['lightning', 'disturber', 'noise'], [6, 3, 1])[0]
+        event = {'event': name, 'seq': seq, 'irq_timestamp_us': now_us,
+                 'epoch_us': 1_717_171_717_000_000 + now_us,
+                 'r0': 0x24, 'r1': 0x22, 'r3': EVENT_IDS[TYPE_NAMES.index(name)], 'r8': 0x07}
+        if name == 'lightning':
+            event['distance_km'] = rng.choice([1, 5, 6, 8, 10, 12, 14, 17, 20, 24, 27, 31, 34, 37, 40, 63])
+            event['energy'] = rng.randint(0, 0x1FFFFF)
+        events.append(event)
+    return events
+
+
+def bench(count: int) -> dict:
+    """Compare payload sizes and host encode/decode rates of JSON and CBOR."""
+    events = sample_events(count)
+
+    start = time.perf_counter()
+    json_payloads = [format_json(e) for e in events]
+    json_encode_s = time.perf_counter() - start
+    start = time.perf_counter()
+    for p in json_payloads:
+        json.loads(p)
+    json_decode_s = time.perf_counter() - start
+
+    start = time.perf_counter()
+    cbor_payloads = [encode_event(e) for e in events]
+    cbor_encode_s = time.perf_counter() - start
+    start = time.perf_counter()
+    for p in cbor_payloads:
+        decode_event(p)
+    cbor_decode_s = time.perf_counter() - start
+
+    json_bytes = sum(len(p) for p in json_payloads)
+    cbor_bytes = sum(len(p) for p in cbor_payloads)
+    return {
+        'events': count,
+        'json_bytes_per_event': json_bytes / count,
+        'cbor_bytes_per_event': cbor_bytes / count,
+        'size_ratio': json_bytes / cbor_bytes,
+        'json_encode_per_s': count / json_encode_s,
+        'json_decode_per_s': count / json_decode_s,
+        'cbor_encode_per_s': count / cbor_encode_s,
+        'cbor_decode_per_s': count / cbor_decode_s,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode CBOR event payloads to NDJSON')
+    parser.add_argument('file', nargs='?', help="hex payloads, one per line; '-' for stdin")
+    parser.add_argument('--hex', action='append', default=[], help='decode one hex payload')
+    parser.add_argument('--bench', action='store_true', help='compare JSON and CBOR size and speed')
+    parser.add_argument('--count', type=int, default=20000, help='events for --bench')
+    args = parser.parse_args()
+
+    if args.bench:
+        r = bench(args.count)
+        print(f"{r['events']} events")
+        print(f"{'':8}{'bytes/event':>12}{'encode/s':>12}{'decode/s':>12}")
+        print(f"{'json':8}{r['json_bytes_per_event']:12.1f}{r['json_encode_per_s']:12.0f}{r['json_decode_per_s']:12.0f}")
+        print(f"{'cbor':8}{r['cbor_bytes_per_event']:12.1f}{r['cbor_encode_per_s']:12.0f}{r['cbor_decode_per_s']:12.0f}")
+        print(f"CBOR payloads are {r['size_ratio']:.1f}x smaller")
+        return
+
+    lines = list(args.hex)
+    if args.file == '-':
+        lines += sys.stdin.read().split()
+    elif args.file:
+        with open(args.file) as f:
+            lines += f.read().split()
+    if not lines:
+        parser.error('nothing to decode')
+
+    for line in lines:
+        try:
+            print(json.dumps(decode_event(bytes.fromhex(line)), separators=(',', ':')))
+        except ValueError as e:
+            print(f'skipped payload: {e}', file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
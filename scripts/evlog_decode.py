@@ -0,0 +1,261 @@
+"""Decoder for binary event log exports.
+
+Download the stored blocks with:
+    curl "http://192.168.4.1/api/events/log?format=bin" -o events.bin
+
+and convert them to NDJSON (one event per line, same fields as the device's
+NDJSON export):
+    python scripts/evlog_decode.py events.bin
+    python scripts/evlog_decode.py events.bin --since 1200
+
+The stream is a sequence of blocks exactly as stored in the "evlog" flash
+partition: a 16-byte little-endian header (magic 0xB10C, record count, format,
+payload length, flags, first lsn, CRC-32 of the header fields and payload)
+followed by the payload.  Format 0 is an array of 16-byte records, format 1 the
+delta/varint encoding written by components/main/event_log.c.  Blocks with a
+bad CRC are skipped.
+"""
+import argparse
+import json
+import struct
+import sys
+import zlib
+
+BLOCK_MAGIC = 0xB10C
+BLOCK_HEADER = struct.Struct('<HBBHHII')
+RAW_RECORD = struct.Struct('<qIBBBB')
+
+FORMAT_RAW = 0
+FORMAT_DELTA = 1
+FLAG_EPOCH = 1 << 0
+
+HEAD_DISTANCE = 0x0F
+HEAD_TYPE_SHIFT = 4
+HEAD_REGS = 1 << 6
+HEAD_EXT = 1 << 7
+EXT_ENERGY = 1 << 0
+EXT_DISTANCE = 1 << 1
+EXT_BACKWARDS = 1 << 2
+TICK_SHIFT = 4  # delta format stores timestamps in 16 us ticks
+
+TYPE_NAMES = ['unknown', 'lightning', 'disturber', 'noise']
+TYPE_LIGHTNING = 1
+
+# AS3935 distance estimates in km, as stored as a 4-bit index
+DISTANCES = [0x01, 0x05, 0x06, 0x08, 0x0A, 0x0C, 0x0E, 0x11,
+             0x14, 0x18, 0x1B, 0x1F, 0x22, 0x25, 0x28, 0x3F]
+
+# REG0x03 interrupt bits per type; r3 is stored XORed with them
+TYPE_INT_BITS = [0x00, 0x08, 0x04, 0x01]
+
+
+def read_varint(buf: bytes, pos: int):
+    """Read an unsigned LEB128 varint, return (value, new_pos).
+
+    Raises ValueError if the buffer ends inside the varint.
+    """
+    value = 0
+    shift = 0
+    while pos < len(buf) and shift < 64:
+        b = buf[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return value, pos
+        shift += 7
+    raise ValueError('truncated varint')
+
+
+def write_varint(value: int) -> bytes:
+    """Encode an unsigned integer as a LEB128 varint."""
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+    return bytes(out)
+
+
+def _record(timestamp_us, type_, distance_km, energy, regs):
+    return {
+        'timestamp_us': timestamp_us,
+        'type': type_,
+        'distance_km': distance_km,
+        'energy': energy,
+        'r0': regs[0],
+        'r1': regs[1],
+        'r3': regs[2],
+        'r8': regs[3],
+    }
+
+
+def decode_payload(fmt: int, payload: bytes, count: int) -> list:
+    """Decode the records of one block payload.
+
+    Returns a list of dicts with timestamp_us, type (0-3), distance_km, energy,
+    r0, r1, r3 and r8.  Delta format timestamps have 16 us resolution.
+    Raises ValueError on malformed data.
+    """
+    records = []
+    if fmt == FORMAT_RAW:
+        for i in range(count):
+            off = i * RAW_RECORD.size
+            if off + RAW_RECORD.size > len(payload):
+                raise ValueError('truncated raw record')
+            ts, bits, r0, r1, r3, r8 = RAW_RECORD.unpack_from(payload, off)
+            records.append(_record(ts, (bits >> 21) & 0x7, bits >> 24, bits & 0x1FFFFF,
+                                   (r0, r1, r3, r8)))
+        return records
+    if fmt != FORMAT_DELTA:
+        raise ValueError(f'unknown block format {fmt}')
+
+    pos = 0
+    prev_ticks = 0
+    regs = [0, 0, 0, 0]
+    for _ in range(count):
+        if pos >= len(payload):
+            raise ValueError('truncated delta record')
+        head = payload[pos]
+        pos += 1
+        ext = 0
+        if head & HEAD_EXT:
+            ext = payload[pos]
+            pos += 1
+        type_ = (head >> HEAD_TYPE_SHIFT) & 0x3
+        delta, pos = read_varint(payload, pos)
+        prev_ticks += -delta if ext & EXT_BACKWARDS else delta
+        energy = 0
+        if type_ == TYPE_LIGHTNING or ext & EXT_ENERGY:
+            energy, pos = read_varint(payload, pos)
+        if ext & EXT_DISTANCE:
+            distance = payload[pos]
+            pos += 1
+        else:
+            distance = DISTANCES[head & HEAD_DISTANCE]
+        if head & HEAD_REGS:
+            if pos + 4 > len(payload):
+                raise ValueError('truncated register snapshot')
+            regs = list(payload[pos:pos + 4])
+            pos += 4
+        records.append(_record(prev_ticks << TICK_SHIFT, type_, distance, energy,
+                               (regs[0], regs[1], regs[2] ^ TYPE_INT_BITS[type_], regs[3])))
+    return records
+
+
+def encode_delta(records: list) -> bytes:
+    """Encode records (dicts as returned by decode_payload) like the device does."""
+    out = bytearray()
+    prev_ticks = 0
+    prev_regs = None
+    for rec in records:
+        type_ = rec['type'] & 0x3
+        regs = [rec['r0'], rec['r1'], rec['r3'] ^ TYPE_INT_BITS[type_], rec['r8']]
+        head = type_ << HEAD_TYPE_SHIFT
+        ext = 0
+        if rec['distance_km'] in DISTANCES:
+            head |= DISTANCES.index(rec['distance_km'])
+        else:
+            ext |= EXT_DISTANCE
+        if type_ != TYPE_LIGHTNING and rec['energy']:
+            ext |= EXT_ENERGY
+        ticks = rec['timestamp_us'] >> TICK_SHIFT
+        delta = ticks - prev_ticks
+        if delta < 0:
+            ext |= EXT_BACKWARDS
+        if ext:
+            head |= HEAD_EXT
+        if regs != prev_regs:
+            head |= HEAD_REGS
+
+        out.append(head)
+        if ext:
+            out.append(ext)
+        out += write_varint(abs(delta))
+        if type_ == TYPE_LIGHTNING or ext & EXT_ENERGY:
+            out += write_varint(rec['energy'])
+        if ext & EXT_DISTANCE:
+            out.append(rec['distance_km'])
+        if head & HEAD_REGS:
+            out += bytes(regs)
+            prev_regs = regs
+        prev_ticks = ticks
+    return bytes(out)
+
+
+def encode_block(first_lsn: int, records: list, flags: int = 0, fmt: int = FORMAT_DELTA) -> bytes:
+    """Build one stored block (header and payload) for the given records."""
+    if fmt == FORMAT_RAW:
+        payload = b''.join(
+            RAW_RECORD.pack(r['timestamp_us'],
+                            (r['energy'] & 0x1FFFFF) | (r['type'] & 0x7) << 21 | r['distance_km'] << 24,
+                            r['r0'], r['r1'], r['r3'], r['r8'])
+            for r in records)
+    else:
+        payload = encode_delta(records)
+    fields = struct.pack('<HBBHHI', BLOCK_MAGIC, len(records), fmt, len(payload), flags, first_lsn)
+    crc = zlib.crc32(payload, zlib.crc32(fields))
+    return fields + struct.pack('<I', crc) + payload
+
+
+def iter_blocks(data: bytes):
+    """Yield (header dict, payload) for every block with a valid CRC.
+
+    Stops at the first header that is not a block (e.g. trailing garbage).
+    """
+    pos = 0
+    while pos + BLOCK_HEADER.size <= len(data):
+        magic, count, fmt, length, flags, first_lsn, crc = BLOCK_HEADER.unpack_from(data, pos)
+        if magic != BLOCK_MAGIC or pos + BLOCK_HEADER.size + length > len(data):
+            return
+        payload = data[pos + BLOCK_HEADER.size:pos + BLOCK_HEADER.size + length]
+        pos += BLOCK_HEADER.size + length
+        if zlib.crc32(payload, zlib.crc32(data[pos - length - BLOCK_HEADER.size:pos - length - 4])) != crc:
+            continue
+        yield {'count': count, 'format': fmt, 'flags': flags, 'first_lsn': first_lsn}, payload
+
+
+def decode_stream(data: bytes, since: int = 0) -> list:
+    """Decode a binary export into NDJSON-ready dicts, skipping lsn <= since."""
+    events = []
+    for hdr, payload in iter_blocks(data):
+        try:
+            records = decode_payload(hdr['format'], payload, hdr['count'])
+        except ValueError:
+            continue
+        ts_key = 'epoch_us' if hdr['flags'] & FLAG_EPOCH else 'uptime_us'
+        for i, rec in enumerate(records):
+            lsn = hdr['first_lsn'] + i
+            if lsn <= since:
+                continue
+            events.append({
+                'lsn': lsn,
+                ts_key: rec['timestamp_us'],
+                'type': TYPE_NAMES[rec['type']] if rec['type'] < len(TYPE_NAMES) else 'unknown',
+                'distance_km': rec['distance_km'],
+                'energy': rec['energy'],
+                'r0': rec['r0'],
+                'r1': rec['r1'],
+                'r3': rec['r3'],
+                'r8': rec['r8'],
+            })
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode a binary event log export to NDJSON')
+    parser.add_argument('file', help="file saved from /api/events/log?format=bin, '-' for stdin")
+    parser.add_argument('--since', type=int, default=0, help='skip records up to this lsn')
+    args = parser.parse_args()
+
+    if args.file == '-':
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.file, 'rb') as f:
+            data = f.read()
+
+    for event in decode_stream(data, args.since):
+        print(json.dumps(event, separators=(',', ':')))
+
+
+if __name__ == '__main__':
+    main()
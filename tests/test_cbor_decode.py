@@ -0,0 +1,65 @@
+import unittest
+from scripts import cbor_decode
+
+
+# Encoded by event_pipeline_format_cbor() in components/main/event_pipeline.c
+GOLDEN = {
+    'a80001010102182a031a4ead9a00041b000619c23237ad80050c061a000255aa074424220807': {
+        'event': 'lightning', 'seq': 42, 'irq_timestamp_us': 1320000000, 'epoch_us': 1717171717123456,
+        'r0': 0x24, 'r1': 0x22, 'r3': 0x08, 'r8': 0x07, 'distance_km': 12, 'energy': 153002,
+    },
+    'a60001010202182b031a4e9e57c0041b000619c232286b40074424220407': {
+        'event': 'disturber', 'seq': 43, 'irq_timestamp_us': 1319000000, 'epoch_us': 1717171716123456,
+        'r0': 0x24, 'r1': 0x22, 'r3': 0x04, 'r8': 0x07,
+    },
+    # clock not set yet: no epoch_us key
+    'a500010103020103191388074424220107': {
+        'event': 'noise', 'seq': 1, 'irq_timestamp_us': 5000, 'epoch_us': 0,
+        'r0': 0x24, 'r1': 0x22, 'r3': 0x01, 'r8': 0x07,
+    },
+    'a6000101000202031913880744242200070818c8': {
+        'event': 'unknown', 'seq': 2, 'irq_timestamp_us': 5000, 'epoch_us': 0,
+        'r0': 0x24, 'r1': 0x22, 'r3': 0x00, 'r8': 0x07, 'event_id': 200,
+    },
+}
+
+
+class TestCborDecode(unittest.TestCase):
+    def test_golden_payloads_decode(self):
+        for payload, event in GOLDEN.items():
+            self.assertEqual(cbor_decode.decode_event(bytes.fromhex(payload)), event)
+
+    def test_encoder_matches_device(self):
+        for payload, event in GOLDEN.items():
+            self.assertEqual(cbor_decode.encode_event(event).hex(), payload)
+
+    def test_generic_items(self):
+        # from the device encoder: -1, -500, INT64_MIN, "a", true, null, array(2) head
+        data = bytes.fromhex('203901f33b7fffffffffffffff6161f5f6')
+        values, pos = [], 0
+        while pos < len(data):
+            value, pos = cbor_decode.decode_item(data, pos)
+            values.append(value)
+        self.assertEqual(values, [-1, -500, -2 ** 63, 'a', True, None])
+        self.assertEqual(b''.join(cbor_decode.encode_item(v) for v in values), data)
+
+    def test_unknown_keys_ignored(self):
+        event = GOLDEN['a500010103020103191388074424220107']
+        items, _ = cbor_decode.decode_item(cbor_decode.encode_event(event))
+        items[0] = 2
+        items[99] = 'future field'
+        self.assertEqual(cbor_decode.decode_event(cbor_decode.encode_item(items)), event)
+
+    def test_malformed_payloads(self):
+        for payload in ('', 'a5000101', '80', 'a100', 'a5000101030201031913880744242201'):
+            with self.assertRaises(ValueError):
+                cbor_decode.decode_event(bytes.fromhex(payload))
+
+    def test_bench_cbor_is_smaller(self):
+        result = cbor_decode.bench(200)
+        self.assertLess(result['cbor_bytes_per_event'], 50)
+        self.assertGreater(result['size_ratio'], 5)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,81 @@
+import unittest
+from scripts import evlog_decode
+
+
+def rec(ts, energy, type_, distance, r0=0x24, r1=0x22, r3=0x08, r8=0x07):
+    return {'timestamp_us': ts, 'type': type_, 'distance_km': distance, 'energy': energy,
+            'r0': r0, 'r1': r1, 'r3': r3, 'r8': r8}
+
+
+# Encoded by the device encoder in components/main/event_log.c
+GOLDEN_RECORDS = [
+    rec(1717171717123456, 153002, 1, 12, r3=0x08),
+    rec(1717171718000000, 0, 3, 0x3F, r3=0x01),
+    rec(1717171717998992, 5, 2, 0, r3=0x04),
+    rec(1717171720000000, 2000000, 1, 40, r1=0x23, r3=0x08),
+]
+GOLDEN_PAYLOAD = bytes.fromhex(
+    '55d8f58d99c2b318aaab09242200073f80ac03a0073f05005e87d10780897a24230007')
+
+
+class TestEvlogDecode(unittest.TestCase):
+    def test_varint_round_trip(self):
+        for value in (0, 1, 127, 128, 300, 0x1FFFFF, 2 ** 63):
+            encoded = evlog_decode.write_varint(value)
+            self.assertEqual(evlog_decode.read_varint(encoded, 0), (value, len(encoded)))
+
+    def test_varint_truncated(self):
+        with self.assertRaises(ValueError):
+            evlog_decode.read_varint(b'\x80\x80', 0)
+
+    def test_timestamps_have_16us_resolution(self):
+        records = [rec(1000007, 0, 3, 0x3F, r3=0x01), rec(999000, 0, 3, 0x3F, r3=0x01)]
+        decoded = evlog_decode.decode_payload(evlog_decode.FORMAT_DELTA, evlog_decode.encode_delta(records), 2)
+        self.assertEqual(decoded[0]['timestamp_us'], 1000000)
+        # clock stepped back between the two events
+        self.assertEqual(decoded[1]['timestamp_us'], 998992)
+
+    def test_golden_payload_decodes(self):
+        self.assertEqual(evlog_decode.decode_payload(evlog_decode.FORMAT_DELTA, GOLDEN_PAYLOAD, 4),
+                         GOLDEN_RECORDS)
+
+    def test_encoder_matches_device(self):
+        self.assertEqual(evlog_decode.encode_delta(GOLDEN_RECORDS), GOLDEN_PAYLOAD)
+
+    def test_raw_format(self):
+        block = evlog_decode.encode_block(7, GOLDEN_RECORDS, fmt=evlog_decode.FORMAT_RAW)
+        events = evlog_decode.decode_stream(block)
+        self.assertEqual([e['lsn'] for e in events], [7, 8, 9, 10])
+        self.assertEqual(events[3]['energy'], 2000000)
+        self.assertEqual(events[1]['type'], 'noise')
+
+    def test_stream_since_and_epoch_flag(self):
+        data = (evlog_decode.encode_block(1, GOLDEN_RECORDS[:2], flags=evlog_decode.FLAG_EPOCH) +
+                evlog_decode.encode_block(3, GOLDEN_RECORDS[2:]))
+        events = evlog_decode.decode_stream(data, since=2)
+        self.assertEqual([e['lsn'] for e in events], [3, 4])
+        self.assertIn('uptime_us', events[0])
+        self.assertIn('epoch_us', evlog_decode.decode_stream(data)[0])
+
+    def test_bad_crc_block_skipped(self):
+        good = evlog_decode.encode_block(1, GOLDEN_RECORDS[:1])
+        bad = bytearray(evlog_decode.encode_block(2, GOLDEN_RECORDS[1:2]))
+        bad[-1] ^= 0xFF
+        events = evlog_decode.decode_stream(bytes(bad) + good)
+        self.assertEqual([e['lsn'] for e in events], [1])
+
+    def test_stops_at_erased_flash(self):
+        data = evlog_decode.encode_block(1, GOLDEN_RECORDS) + b'\xff' * 64
+        self.assertEqual(len(evlog_decode.decode_stream(data)), 4)
+
+    def test_noise_flood_fits_4x_more_records_per_page(self):
+        payload_max = 256 - evlog_decode.BLOCK_HEADER.size
+        raw_per_page = payload_max // evlog_decode.RAW_RECORD.size
+        records = [rec(1717171717000000 + i * 250000, 0, 3, 0x3F, r3=0x01) for i in range(255)]
+        fits = max(n for n in range(1, len(records) + 1)
+                   if len(evlog_decode.encode_delta(records[:n])) <= payload_max)
+        self.assertGreaterEqual(fits, 4 * raw_per_page)
+
+
+if __name__ == '__main__':
+    unittest.main()